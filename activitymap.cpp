@@ -0,0 +1,211 @@
+#include <QAtomicInt>
+#include <QDirIterator>
+#include <QFuture>
+#include <QIODevice>
+#include <QMutex>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#include "activitymap.h"
+#include "nbt/nbtprojection.h"
+#include "regionfile.h"
+
+// generation steps since 1.18, index + STATUS_FIRST is the stored status
+static const char *STATUS_NAMES[] = {
+  "empty", "structure_starts", "structure_references", "biomes", "noise",
+  "surface", "carvers", "liquid_carvers", "features", "initialize_light",
+  "light", "spawn", "heightmaps", "full"
+};
+static const int STATUS_COUNT = sizeof(STATUS_NAMES) / sizeof(STATUS_NAMES[0]);
+
+static quint8 statusFromName(QString name) {
+  if (name.startsWith("minecraft:"))
+    name.remove(0, 10);
+  // finished Chunks of 1.14 to 1.17
+  if ((name == "postprocessed") || (name == "fullchunk"))
+    name = "full";
+  for (int i = 0; i < STATUS_COUNT; i++)
+    if (name == QLatin1String(STATUS_NAMES[i]))
+      return ActivityMap::STATUS_FIRST + i;
+  return ActivityMap::STATUS_UNKNOWN;
+}
+
+static quint32 saturate(qint64 value) {
+  return static_cast<quint32>(qBound<qint64>(0, value, 0xffffffffLL));
+}
+
+
+ActivityMap::ActivityMap(const QString &path)
+  : path(path)
+{}
+
+QString ActivityMap::statusName(quint8 status) {
+  if (status == STATUS_NONE)
+    return QString();
+  if ((status < STATUS_FIRST) || (status >= STATUS_FIRST + STATUS_COUNT))
+    return "unknown";
+  return STATUS_NAMES[status - STATUS_FIRST];
+}
+
+void ActivityMap::scan(const ProgressFunction &progress) {
+  // all region files of this dimension: "r.X.Z.mca"
+  QList<RegionID> files;
+  QDirIterator it(path + "/region", QStringList() << "*.mca");
+  while (it.hasNext()) {
+    it.next();
+    const QStringList nameParts = it.fileName().split(".");
+    if ((nameParts.length() != 4) || (it.fileInfo().size() == 0))
+      continue;
+    files.append(RegionID(nameParts[1].toInt(), nameParts[2].toInt()));
+  }
+
+  QMutex mutex;
+  QAtomicInt done(0);
+  const int total = files.size();
+
+  // one task per region file, each reads its Chunks in file order
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+  QList<QFuture<void>> tasks;
+  for (const RegionID &id : files) {
+    tasks.append(QtConcurrent::run(&pool, [&, id]() {
+      QSharedPointer<Region> region =
+          scanRegion(RegionFile::filename(path, "region", id.first, id.second));
+      if (region) {
+        QMutexLocker guard(&mutex);
+        regionMap.insert(id, region);
+      }
+      if (progress)
+        progress(done.fetchAndAddRelaxed(1) + 1, total);
+    }));
+  }
+  for (auto &task : tasks)
+    task.waitForFinished();
+}
+
+QSharedPointer<ActivityMap::Region> ActivityMap::scanRegion(const QString &filename) {
+  RegionFile file(filename);
+  if (!file.exists())
+    return QSharedPointer<Region>();
+
+  // fields moved out of "Level" with 1.18
+  NBTProjection projection;
+  const int inhabitedField  = projection.addField({"InhabitedTime", "Level/InhabitedTime"});
+  const int lastUpdateField = projection.addField({"LastUpdate", "Level/LastUpdate"});
+  const int statusField     = projection.addField({"Status", "Level/Status"});
+
+  QSharedPointer<Region> region(new Region);
+  region->chunks.resize(32 * 32);
+  region->image = QImage(32, 32, QImage::Format_ARGB32);
+  region->image.fill(Qt::transparent);
+
+  bool any = false;
+  for (int z = 0; z < 32; z++) {
+    for (int x = 0; x < 32; x++) {
+      if (!file.scan(x, z, projection))
+        continue;
+      ChunkActivity &chunk = region->chunks[x + z * 32];
+      chunk.inhabitedTime = saturate(projection.toLong(inhabitedField));
+      chunk.lastUpdate    = saturate(projection.toLong(lastUpdateField));
+      chunk.status        = projection.has(statusField)
+                          ? statusFromName(projection.toString(statusField))
+                          : STATUS_UNKNOWN;
+      region->image.setPixel(x, z, color(chunk));
+      any = true;
+    }
+  }
+  return any ? region : QSharedPointer<Region>();
+}
+
+
+QList<ActivityMap::RegionID> ActivityMap::regions() const {
+  QList<RegionID> ids = regionMap.keys();
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+ActivityMap::ChunkActivity ActivityMap::at(int cx, int cz) const {
+  QSharedPointer<Region> region = regionMap.value(RegionID(cx >> 5, cz >> 5));
+  if (!region)
+    return ChunkActivity();
+  return region->chunks[(cx & 31) + (cz & 31) * 32];
+}
+
+QImage ActivityMap::regionImage(int rx, int rz) const {
+  QSharedPointer<Region> region = regionMap.value(RegionID(rx, rz));
+  return region ? region->image : QImage();
+}
+
+// same color ramp as regional difficulty in ChunkRenderer:
+// blue -> cyan -> green -> yellow -> red -> purple, unfinished Chunks are gray
+QRgb ActivityMap::color(const ChunkActivity &chunk) {
+  if (chunk.status == STATUS_NONE)
+    return qRgba(0, 0, 0, 0);
+  if ((chunk.status != STATUS_UNKNOWN) && (chunk.status != STATUS_FIRST + STATUS_COUNT - 1))
+    return qRgba(128, 128, 128, 128);
+
+  const double difficulty = 6.0 * std::min<double>(chunk.inhabitedTime, FULL_DIFFICULTY) / FULL_DIFFICULTY;
+  const int    step = static_cast<int>(difficulty);
+  const int    rd   = static_cast<int>(255 * (difficulty - step));
+  switch (step) {
+    case 0:  return qRgba(0, 0, rd, 160);  // black -> blue
+    case 1:  return qRgba(0, rd, 255, 160);  // blue -> cyan
+    case 2:  return qRgba(0, 255, 255 - rd, 160);  // cyan -> green
+    case 3:  return qRgba(rd, 255, 0, 160);  // green -> yellow
+    case 4:  return qRgba(255, 255 - rd, 0, 160);  // yellow -> red
+    case 5:  return qRgba(255, 0, rd, 160);  // red -> purple
+    default: return qRgba(255, 0, 255, 160);  // saturated at purple
+  }
+}
+
+
+bool ActivityMap::writeCsv(QIODevice *out, qint64 maxInhabited, bool wholeRegions) const {
+  QTextStream stream(out);
+  if (wholeRegions) {
+    // Regions where every stored Chunk is a candidate
+    stream << "rx,rz,chunks,max_inhabited_time\n";
+    for (const RegionID &id : regions()) {
+      const Region &region = *regionMap.value(id);
+      int     count = 0;
+      quint32 maximum = 0;
+      for (const ChunkActivity &chunk : region.chunks) {
+        if (chunk.status == STATUS_NONE)
+          continue;
+        count++;
+        maximum = std::max(maximum, chunk.inhabitedTime);
+      }
+      if (maximum <= maxInhabited)
+        stream << id.first << "," << id.second << "," << count << "," << maximum << "\n";
+    }
+  } else {
+    stream << "x,z,inhabited_time,last_update,status\n";
+    for (const RegionID &id : regions()) {
+      const Region &region = *regionMap.value(id);
+      for (int i = 0; i < region.chunks.size(); i++) {
+        const ChunkActivity &chunk = region.chunks[i];
+        if ((chunk.status == STATUS_NONE) || (chunk.inhabitedTime > maxInhabited))
+          continue;
+        stream << (id.first * 32 + (i & 31)) << "," << (id.second * 32 + (i >> 5)) << ","
+               << chunk.inhabitedTime << "," << chunk.lastUpdate << ","
+               << statusName(chunk.status) << "\n";
+      }
+    }
+  }
+  stream.flush();
+  return (stream.status() == QTextStream::Ok);
+}
+
+
+ActivityScan::ActivityScan(QSharedPointer<ActivityMap> map)
+  : map(map)
+{}
+
+void ActivityScan::run() {
+  emit progress(tr("Scanning Chunk activity"), 0.0);
+  map->scan([this](int done, int total) {
+    emit progress(tr("Scanning Chunk activity"), double(done) / total);
+  });
+  emit finished();
+}
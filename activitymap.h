@@ -0,0 +1,89 @@
+#ifndef ACTIVITYMAP_H_
+#define ACTIVITYMAP_H_
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QIODevice;
+
+// Activity of all Chunks of one dimension, collected to plan world trimming:
+// InhabitedTime, LastUpdate and generation Status of every Chunk.
+//
+// scan() reads only these fields with an NBTProjection, no Section is decoded
+// and one task per region file runs on all cores. The result is kept as a
+// compact raster of 32x32 Chunks per Region, shown as map overlay
+// (regionImage) and exported as list of trim candidates (writeCsv).
+// The map is filled by scan() and read only afterwards.
+class ActivityMap {
+ public:
+  typedef QPair<int, int> RegionID;
+
+  struct ChunkActivity {
+    quint32 inhabitedTime = 0;  // ticks players spent nearby, saturated
+    quint32 lastUpdate    = 0;  // game tick of last save, saturated
+    quint8  status        = STATUS_NONE;
+  };
+
+  // generation status, in order of generation steps
+  static const quint8 STATUS_NONE    = 0;  // no Chunk stored
+  static const quint8 STATUS_UNKNOWN = 1;  // Chunk without (known) Status
+  static const quint8 STATUS_FIRST   = 2;  // first named step, see statusName()
+
+  explicit ActivityMap(const QString &path);  // folder of the dimension
+
+  // progress(done, total) is called after each region file from the worker threads
+  typedef std::function<void(int done, int total)> ProgressFunction;
+  void scan(const ProgressFunction &progress = ProgressFunction());
+
+  const QString &  getPath() const { return path; }
+  QList<RegionID>  regions() const;
+  ChunkActivity    at(int cx, int cz) const;
+  QImage           regionImage(int rx, int rz) const;  // 32x32 pixel, null when no Region
+
+  // Chunks with at most maxInhabited ticks, or Regions containing only such Chunks
+  bool writeCsv(QIODevice *out, qint64 maxInhabited, bool wholeRegions) const;
+
+  static QString statusName(quint8 status);
+  static QRgb    color(const ChunkActivity &chunk);
+
+  static const quint32 FULL_DIFFICULTY = 3600000;  // regional difficulty is capped here
+
+ private:
+  struct Region {
+    QVector<ChunkActivity> chunks;  // 32*32, x fastest
+    QImage image;
+  };
+
+  static QSharedPointer<Region> scanRegion(const QString &filename);
+
+  QString path;
+  QHash<RegionID, QSharedPointer<Region>> regionMap;
+};
+
+
+// runs ActivityMap::scan() as background job with progress reporting
+class ActivityScan : public QObject, public QRunnable {
+  Q_OBJECT
+
+ public:
+  explicit ActivityScan(QSharedPointer<ActivityMap> map);
+
+  void run() override;
+
+ signals:
+  void progress(QString status, double value);
+  void finished();
+
+ private:
+  QSharedPointer<ActivityMap> map;
+};
+
+#endif  // ACTIVITYMAP_H_
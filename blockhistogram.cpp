@@ -0,0 +1,194 @@
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTextStream>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <numeric>
+
+#include "blockhistogram.h"
+#include "chunk.h"
+#include "identifier/blockidentifier.h"
+
+
+BlockHistogram::BlockHistogram(int minY, int maxY)
+  : minY(std::min(minY, maxY))
+  , maxY(std::max(minY, maxY))
+  , height(this->maxY - this->minY + 1)
+  , chunks(0)
+  , airHid(qHash(QString("minecraft:air")))
+{}
+
+void BlockHistogram::clear() {
+  chunks = 0;
+  hids.clear();
+  types.clear();
+  counts.clear();
+  legacyType.clear();
+}
+
+int BlockHistogram::typeIndex(quint32 hid) {
+  auto it = types.constFind(hid);
+  if (it != types.constEnd())
+    return it.value();
+
+  const int type = hids.size();
+  hids.append(hid);
+  types.insert(hid, type);
+  counts.resize(counts.size() + height);  // new row initialized with 0
+  return type;
+}
+
+void BlockHistogram::addChunk(const Chunk &chunk) {
+  chunks++;
+  for (int sy = (minY >> 4); sy <= (maxY >> 4); sy++) {
+    const int y_start = std::max(minY, sy * 16);
+    const int y_stop  = std::min(maxY, sy * 16 + 15);
+    const ChunkSection *section = chunk.getSectionByIdx(sy);
+    if (section && (section->blockPaletteLength > 0)) {
+      addSection(section, y_start, y_stop);
+    } else {
+      const int air = typeIndex(airHid);
+      for (int y = y_start; y <= y_stop; y++)
+        add(air, y, 16*16);
+    }
+  }
+}
+
+void BlockHistogram::addSection(const ChunkSection *section, int y_start, int y_stop) {
+  // uniform Section: the palette tells everything
+  if (section->blockPaletteLength == 1) {
+    const int type = typeIndex(section->blockPalette[0].hid);
+    for (int y = y_start; y <= y_stop; y++)
+      add(type, y, 16*16);
+    return;
+  }
+
+  // shared palette of converted Chunks is too large for counting per index
+  if (section->blockPaletteIsShared) {
+    if (legacyType.size() < size_t(section->blockPaletteLength))
+      legacyType.assign(section->blockPaletteLength, -1);
+    for (int y = y_start; y <= y_stop; y++) {
+      const quint16 *blocks = section->blocks + ((y & 0x0f) << 8);
+      for (int offset = 0; offset < 16*16; offset++) {
+        const int index = (blocks[offset] < section->blockPaletteLength) ? blocks[offset] : 0;
+        int &type = legacyType[index];
+        if (type < 0)
+          type = typeIndex(section->blockPalette[index].hid);
+        add(type, y, 1);
+      }
+    }
+    return;
+  }
+
+  // count palette indices per Y level, then add the used ones
+  const int length = section->blockPaletteLength;
+  QVarLengthArray<int, 256>     type(length);
+  QVarLengthArray<quint16, 256> local(length);
+  std::fill(type.begin(), type.end(), -1);
+  for (int y = y_start; y <= y_stop; y++) {
+    std::fill(local.begin(), local.end(), 0);
+    const quint16 *blocks = section->blocks + ((y & 0x0f) << 8);
+    for (int offset = 0; offset < 16*16; offset++)
+      local[(blocks[offset] < length) ? blocks[offset] : 0]++;
+
+    for (int index = 0; index < length; index++) {
+      if (local[index] == 0)
+        continue;
+      if (type[index] < 0)
+        type[index] = typeIndex(section->blockPalette[index].hid);
+      add(type[index], y, local[index]);
+    }
+  }
+}
+
+void BlockHistogram::merge(const BlockHistogram &other) {
+  chunks += other.chunks;
+  // Y ranges of both are the same when used as intended, clip otherwise
+  const int y_start = std::max(minY, other.minY);
+  const int y_stop  = std::min(maxY, other.maxY);
+  for (int otherType = 0; otherType < other.hids.size(); otherType++) {
+    const int type = typeIndex(other.hids[otherType]);
+    const qint64 *src = other.counts.constData() + otherType * other.height;
+    for (int y = y_start; y <= y_stop; y++)
+      add(type, y, src[y - other.minY]);
+  }
+}
+
+QList<quint32> BlockHistogram::getBlockIds() const {
+  QList<quint32> list;
+  for (quint32 hid : hids)
+    list.append(hid);
+  return list;
+}
+
+qint64 BlockHistogram::count(quint32 hid, int y) const {
+  auto it = types.constFind(hid);
+  if ((it == types.constEnd()) || (y < minY) || (y > maxY))
+    return 0;
+  return counts[it.value() * height + (y - minY)];
+}
+
+qint64 BlockHistogram::count(quint32 hid) const {
+  auto it = types.constFind(hid);
+  if (it == types.constEnd())
+    return 0;
+  const qint64 *row = counts.constData() + it.value() * height;
+  return std::accumulate(row, row + height, qint64(0));
+}
+
+
+// sum up hids with the same name (variants) for the exports
+static QMap<QString, QVector<qint64>> distributionByName(const BlockHistogram &histogram) {
+  const int height = histogram.getMaxY() - histogram.getMinY() + 1;
+  QMap<QString, QVector<qint64>> result;
+  for (quint32 hid : histogram.getBlockIds()) {
+    QString name = BlockIdentifier::Instance().getBlockInfo(hid).getName();
+    QVector<qint64> &row = result[name];
+    row.resize(height);
+    for (int y = histogram.getMinY(); y <= histogram.getMaxY(); y++)
+      row[y - histogram.getMinY()] += histogram.count(hid, y);
+  }
+  return result;
+}
+
+bool BlockHistogram::writeCsv(QIODevice *device) const {
+  const QMap<QString, QVector<qint64>> distribution = distributionByName(*this);
+
+  QTextStream out(device);
+  // same layout as the single block statistic: header, Y levels top down
+  out << "Y";
+  for (auto it = distribution.constBegin(); it != distribution.constEnd(); ++it)
+    out << ";" << it.key();
+  out << "\n";
+  for (int y = maxY; y >= minY; y--) {
+    out << y;
+    for (auto it = distribution.constBegin(); it != distribution.constEnd(); ++it)
+      out << ";" << it.value()[y - minY];
+    out << "\n";
+  }
+  out.flush();
+  return (out.status() == QTextStream::Ok);
+}
+
+bool BlockHistogram::writeJson(QIODevice *device) const {
+  const QMap<QString, QVector<qint64>> distribution = distributionByName(*this);
+
+  QJsonObject blocks;
+  for (auto it = distribution.constBegin(); it != distribution.constEnd(); ++it) {
+    QJsonArray row;
+    for (qint64 value : it.value())
+      row.append(static_cast<double>(value));
+    blocks[it.key()] = row;
+  }
+  QJsonObject root;
+  root["minY"]   = minY;
+  root["maxY"]   = maxY;
+  root["chunks"] = chunks;
+  root["blocks"] = blocks;  // counts per Y level, from minY upwards
+
+  const QByteArray data = QJsonDocument(root).toJson();
+  return (device->write(data) == data.size());
+}
@@ -0,0 +1,54 @@
+#ifndef BLOCKHISTOGRAM_H_
+#define BLOCKHISTOGRAM_H_
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <vector>
+
+class Chunk;
+class ChunkSection;
+class QIODevice;
+
+// Number of Blocks per block type and Y level, for all block types at once.
+//
+// Counts are kept in one flat array (one row of Y levels per block type).
+// Sections are counted per palette index and only the used indices are
+// added, Sections with a single palette entry are added without scanning.
+// A histogram is filled by one thread only, use one per worker and merge()
+// them at the end.
+class BlockHistogram {
+ public:
+  BlockHistogram(int minY, int maxY);
+
+  void addChunk(const Chunk &chunk);
+  void merge(const BlockHistogram &other);
+  void clear();
+
+  int    getMinY() const   { return minY; }
+  int    getMaxY() const   { return maxY; }
+  int    getChunks() const { return chunks; }
+
+  QList<quint32> getBlockIds() const;   // hid of every counted block type
+  qint64 count(quint32 hid, int y) const;
+  qint64 count(quint32 hid) const;      // over all Y levels
+
+  // full distribution, one column (CSV) or array (JSON) per block name
+  bool writeCsv(QIODevice *device) const;
+  bool writeJson(QIODevice *device) const;
+
+ private:
+  int  typeIndex(quint32 hid);
+  void addSection(const ChunkSection *section, int y_start, int y_stop);
+  void add(int type, int y, qint64 value) { counts[type * height + (y - minY)] += value; }
+
+  int minY, maxY, height;
+  int chunks;
+  quint32 airHid;                  // missing Sections are counted as air
+  QVector<quint32>     hids;       // block type -> hid
+  QHash<quint32, int>  types;      // hid -> block type
+  QVector<qint64>      counts;     // [type * height + (y - minY)]
+  std::vector<int>     legacyType; // shared palette index -> block type (pre-1.13)
+};
+
+#endif  // BLOCKHISTOGRAM_H_
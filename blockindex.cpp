@@ -0,0 +1,202 @@
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <algorithm>
+#include <vector>
+
+#include "blockindex.h"
+#include "chunk.h"
+#include "chunkloader.h"
+#include "regionfile.h"
+
+static const quint32 indexMagic = 0x4d494458;  // "MIDX"
+
+
+BlockIndex::BlockIndex(const QString &path, int rx, int rz)
+  : path(path)
+  , rx(rx), rz(rz)
+  , modified(false)
+{}
+
+QString BlockIndex::filename(const QString &path, int rx, int rz) {
+  return path + "/.minutor-index/r." + QString::number(rx) + "." + QString::number(rz) + ".idx";
+}
+
+void BlockIndex::clear() {
+  entries = QVector<ChunkEntry>();
+  modified = false;
+}
+
+bool BlockIndex::load() {
+  QFile file(filename(path, rx, rz));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  const QByteArray data = qUncompress(file.readAll());
+  file.close();
+
+  QDataStream in(data);
+  quint32 magic = 0, hashCheck = 0;
+  quint16 version = 0;
+  in >> magic >> version >> hashCheck;
+  // hids are hashed block names, they must be the same as in this build
+  if ((magic != indexMagic) || (version != VERSION) ||
+      (hashCheck != quint32(qHash(QString("minecraft:stone")))))
+    return false;
+
+  QVector<ChunkEntry> loaded(32 * 32);
+  while (!in.atEnd()) {
+    quint16 index = 0;
+    quint32 timestamp = 0, count = 0;
+    in >> index >> timestamp >> count;
+    if ((in.status() != QDataStream::Ok) || (index >= loaded.size()))
+      return false;
+    // corrupted count, never allocate more than a Chunk or the file can hold
+    if ((count > quint32(MAX_POSTINGS)) ||
+        (qint64(count) * qint64(sizeof(quint32) + sizeof(qint8)) > in.device()->bytesAvailable()))
+      return false;
+    ChunkEntry &entry = loaded[index];
+    entry.indexed   = true;
+    entry.timestamp = timestamp;
+    entry.postings.resize(count);
+    for (Posting &posting : entry.postings)
+      in >> posting.hid >> posting.section;
+  }
+  if (in.status() != QDataStream::Ok)
+    return false;
+
+  entries = loaded;
+  modified = false;
+  return true;
+}
+
+bool BlockIndex::save() const {
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out << indexMagic << quint16(VERSION) << quint32(qHash(QString("minecraft:stone")));
+  for (int index = 0; index < entries.size(); index++) {
+    const ChunkEntry &entry = entries[index];
+    if (!entry.indexed)
+      continue;
+    out << quint16(index) << entry.timestamp << quint32(entry.postings.size());
+    for (const Posting &posting : entry.postings)
+      out << posting.hid << posting.section;
+  }
+
+  QDir().mkpath(path + "/.minutor-index");
+  QSaveFile file(filename(path, rx, rz));
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(qCompress(data));
+  return file.commit();
+}
+
+void BlockIndex::update(RegionFile &region, const QVector<ChunkID> &chunks) {
+  for (const ChunkID &id : refresh(region, chunks)) {
+    QSharedPointer<Chunk> chunk = QSharedPointer<Chunk>::create();
+    if (region.load(id.getX(), id.getZ(), chunk, ChunkLoader::MAIN_MAP_DATA, 0))  // Block states only
+      record(id, indexChunk(*chunk));
+    else
+      record(id, Postings());
+  }
+}
+
+QVector<ChunkID> BlockIndex::refresh(RegionFile &region, const QVector<ChunkID> &chunks) {
+  if (entries.isEmpty())
+    entries.resize(32 * 32);
+
+  QVector<ChunkID> stale;
+  for (const ChunkID &id : chunks) {
+    ChunkEntry &entry = entries[localIndex(id)];
+
+    if (!region.contains(id.getX(), id.getZ())) {
+      if (!entry.indexed || (entry.timestamp != 0) || !entry.postings.isEmpty()) {
+        entry = ChunkEntry();
+        entry.indexed = true;
+        modified = true;
+      }
+      continue;
+    }
+
+    const quint32 timestamp = region.timestamp(id.getX(), id.getZ());
+    if (timestamp == 0) {
+      // changes can not be detected, never trust an index for this Chunk
+      if (entry.indexed) {
+        entry = ChunkEntry();
+        modified = true;
+      }
+      continue;
+    }
+    if (entry.indexed && (entry.timestamp == timestamp))
+      continue;
+
+    // matches everything until record()
+    entry = ChunkEntry();
+    entry.timestamp = timestamp;
+    stale.append(id);
+  }
+  return stale;
+}
+
+void BlockIndex::record(const ChunkID &id, const Postings &postings) {
+  if (entries.isEmpty())
+    return;
+  ChunkEntry &entry = entries[localIndex(id)];
+  if (entry.indexed || (entry.timestamp == 0))
+    return;  // not returned by refresh()
+  entry.postings = postings;
+  entry.indexed  = true;
+  modified = true;
+}
+
+BlockIndex::Postings BlockIndex::indexChunk(const Chunk &chunk) {
+  Postings postings;
+  if (chunk.getLowest() > chunk.getHighest())
+    return postings;
+
+  std::vector<char> used;
+  for (int sy = (chunk.getLowest() >> 4); sy <= (chunk.getHighest() >> 4); sy++) {
+    const ChunkSection *section = chunk.getSectionByIdx(sy);
+    if (!section || (section->blockPaletteLength == 0))
+      continue;
+
+    if (section->blockPaletteIsShared) {
+      // shared palette of converted Chunks: only the used entries
+      used.assign(section->blockPaletteLength, 0);
+      for (int i = 0; i < 16*16*16; i++)
+        if (section->blocks[i] < section->blockPaletteLength)
+          used[section->blocks[i]] = 1;
+      for (int i = 0; i < section->blockPaletteLength; i++)
+        if (used[i])
+          postings.append({section->blockPalette[i].hid, qint8(sy)});
+    } else {
+      for (int i = 0; i < section->blockPaletteLength; i++)
+        postings.append({section->blockPalette[i].hid, qint8(sy)});
+    }
+  }
+
+  std::sort(postings.begin(), postings.end(), [](const Posting &a, const Posting &b) {
+    return (a.hid < b.hid) || ((a.hid == b.hid) && (a.section < b.section));
+  });
+  postings.erase(std::unique(postings.begin(), postings.end(), [](const Posting &a, const Posting &b) {
+    return (a.hid == b.hid) && (a.section == b.section);
+  }), postings.end());
+  return postings;
+}
+
+bool BlockIndex::mayContain(const ChunkID &id, const std::set<quint32> &hids,
+                            int minSection, int maxSection) const {
+  if (entries.isEmpty())
+    return true;
+  const ChunkEntry &entry = entries[localIndex(id)];
+  if (!entry.indexed)
+    return true;
+
+  for (const Posting &posting : entry.postings) {
+    if ((posting.section >= minSection) && (posting.section <= maxSection) &&
+        (hids.count(posting.hid) > 0))
+      return true;
+  }
+  return false;
+}
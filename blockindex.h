@@ -0,0 +1,74 @@
+#ifndef BLOCKINDEX_H_
+#define BLOCKINDEX_H_
+
+#include <QString>
+#include <QVector>
+#include <set>
+
+#include "chunkid.h"
+
+class Chunk;
+class RegionFile;
+
+// Persistent index of the Block states present in each Section of one Region.
+//
+// The index of "<dimension>/region/r.X.Z.mca" is stored compressed in
+// "<dimension>/.minutor-index/r.X.Z.idx". For every Chunk it keeps the
+// timestamp of the region file header, update() decodes only Chunks that
+// were changed since they were indexed. Block states are stored by their
+// hid, so a query is a lookup without decoding any Chunk.
+// A BlockIndex is used by one thread at a time.
+//
+// Searches index the Chunks they decode anyways: refresh() returns the
+// Chunks without valid entry, indexChunk() runs on the decoded Chunk in any
+// thread and record() merges the result.
+class BlockIndex {
+ public:
+  struct Posting {
+    quint32 hid;
+    qint8   section;
+  };
+  typedef QVector<Posting> Postings;  // sorted by hid
+
+  BlockIndex(const QString &path, int rx, int rz);
+
+  static QString filename(const QString &path, int rx, int rz);
+
+  bool load();        // false when missing or written by an incompatible version
+  bool save() const;
+  void clear();       // release memory
+
+  // (re)index the given Chunks of this Region when their timestamp changed
+  void update(RegionFile &region, const QVector<ChunkID> &chunks);
+  bool isModified() const { return modified; }
+
+  // update entries from the region header only,
+  // returns the Chunks to be indexed with record()
+  QVector<ChunkID> refresh(RegionFile &region, const QVector<ChunkID> &chunks);
+  void record(const ChunkID &id, const Postings &postings);
+  static Postings indexChunk(const Chunk &chunk);
+
+  // Chunk can contain one of the Blocks (by hid) inside the Section range,
+  // Chunks that could not be indexed always match
+  bool mayContain(const ChunkID &id, const std::set<quint32> &hids,
+                  int minSection, int maxSection) const;
+
+  static const int VERSION = 1;
+  static const int MAX_POSTINGS = 256 * 16*16*16;  // Sections * Block states per Section
+
+ private:
+  struct ChunkEntry {
+    bool     indexed   = false;  // Chunk without timestamp is never indexed
+    quint32  timestamp = 0;      // from region header, 0 = Chunk not present
+    Postings postings;
+  };
+
+  static int  localIndex(const ChunkID &id) { return (id.getX() & 31) + (id.getZ() & 31) * 32; }
+
+  QString path;
+  int     rx, rz;
+  bool    modified;
+  QVector<ChunkEntry> entries;  // 32*32 Chunks of this Region, empty until loaded or updated
+};
+
+#endif  // BLOCKINDEX_H_
@@ -1,6 +1,7 @@
 /** Copyright (c) 2013, Sean Kasun */
 
 #include <algorithm>    // std::max
+#include <iterator>     // std::next
 #include <typeinfo>     // typeid
 
 #include "chunk.h"
@@ -24,14 +25,19 @@ inline void* safeMemCpy(void* dest, const std::vector<ValueT>& srcVec, size_t le
 }
 
 Chunk::Chunk()
-  : version(0)
+  : chunkX(0)
+  , chunkZ(0)
+  , version(0)
   , highest(INT_MIN)
   , lowest(INT_MAX)
   , loaded(false)
   , rendering(false)
+  , decoded(0)
+  , upgrading(0)
   , inhabitedTime(0)
   , lowestSection(0)
   , isChunkLocked(false)
+  , entityState(ENTITIES_NONE)
 {}
 
 Chunk::~Chunk() {
@@ -65,9 +71,54 @@ void Chunk::findHighestBlock()
 }
 
 const Chunk::EntityMap &Chunk::getEntityMap() const {
+  static const EntityMap empty;
+  if (!hasEntities())
+    return empty;
   return entities;
 }
 
+const Chunk::EntityClusterMap &Chunk::getEntityClusters() const {
+  static const EntityClusterMap empty;
+  if (!hasEntities())
+    return empty;
+  return entityClusters;
+}
+
+bool Chunk::hasEntities() const {
+  return (entityState.loadAcquire() == ENTITIES_LOADED);
+}
+
+bool Chunk::requestEntities() {
+  return entityState.testAndSetOrdered(ENTITIES_NONE, ENTITIES_QUEUED);
+}
+
+void Chunk::setEntitiesLoaded() {
+  buildEntityClusters();
+  entityState.storeRelease(ENTITIES_LOADED);
+}
+
+void Chunk::buildEntityClusters() {
+  entityClusters.clear();
+  for (auto &type : entities.uniqueKeys()) {
+    auto range = entities.equal_range(type);
+    if (std::next(range.first) == range.second) {
+      // single Entity is its own cluster
+      entityClusters.insert(type, *range.first);
+      continue;
+    }
+    auto cluster = QSharedPointer<EntityCluster>::create(type, (*range.first)->color());
+    for (auto it = range.first; it != range.second; ++it)
+      cluster->add(*it);
+    entityClusters.insert(type, cluster);
+  }
+}
+
+GeneratedStructureList Chunk::takeStructures() {
+  GeneratedStructureList ret;
+  ret.swap(structures);
+  return ret;
+}
+
 //inline
 const ChunkSection *Chunk::getSectionByY(int y) const {
   if (y < -2048) return NULL;
@@ -121,9 +172,10 @@ int Chunk::getBiomeID(int x, int y, int z) const {
     offset = x_idx + 4*z_idx + 16*y_idx;
     int s_idx = (y >> 4);
     auto section = getSectionByIdx(s_idx);
-    if (section)
-      return section->getBiome(offset);
-    else {
+    if (section) {
+      const quint16 biome = section->getBiome(offset);
+      return (biome == ChunkSection::NO_BIOME) ? -1 : biome;
+    } else {
       #if defined(DEBUG) || defined(_DEBUG) || defined(QT_DEBUG)
       qWarning() << "Section not found for Biome lookup!";
       #endif
@@ -153,9 +205,10 @@ int Chunk::getBiomeID(int x, int y, int z) const {
 //-------------------------------------------------------------------------------------------------
 // this is where we load NBT data and parse it
 
-void Chunk::load(const NBT &nbt) {
+void Chunk::load(const NBT &nbt, int channels) {
   renderedAt = INT_MIN;  // impossible.
   renderedFlags = 0;  // no flags
+  decoded = channels;
   this->sections.clear();
 
   if (nbt.has("DataVersion"))
@@ -185,7 +238,8 @@ void Chunk::loadLevelTag(const Tag * level) {
   // load Biome data
   // Partially-generated chunks may have an empty Biomes tag.
   // Trying to extract the Biomes data in that case will cause a crash.
-  if (level->has("Biomes") && level->at("Biomes") && level->at("Biomes")->length()) {
+  if ((decoded & DECODE_BIOMES) &&
+      level->has("Biomes") && level->at("Biomes") && level->at("Biomes")->length()) {
     const Tag * biomesTag = level->at("Biomes");
     if (typeid(*biomesTag) == typeid(Tag_Int_Array)) {
       // Biomes is Tag_Int_Array
@@ -205,7 +259,7 @@ void Chunk::loadLevelTag(const Tag * level) {
         this->biomes[i] = rawBiomes[i];
       }
     }
-  } else {  // no Biome data present
+  } else {  // no Biome data present or not requested
     int len = sizeof(this->biomes) / sizeof(this->biomes[0]);
     for (int i=0; i<len; i++)
       this->biomes[i] = -1;
@@ -248,31 +302,14 @@ void Chunk::loadLevelTag(const Tag * level) {
   // parse Tile Entities in this Chunk
   if (level->has("TileEntities")) {
     auto nbtListBE = level->at("TileEntities");
-    auto belist    = GeneratedStructure::tryParseBlockEntites(nbtListBE);
-    for (auto it = belist.begin(); it != belist.end(); ++it) {
-      emit structureFound(*it);
-    }
+    structures.append(GeneratedStructure::tryParseBlockEntites(nbtListBE));
   }
 
   // parse Structures that start in this Chunk
   if (version >= 1519) {
     if (level->has("Structures")) {
       auto nbtListStructures = level->at("Structures");
-      auto structurelist     = GeneratedStructure::tryParseChunk(nbtListStructures);
-      for (auto it = structurelist.begin(); it != structurelist.end(); ++it) {
-        emit structureFound(*it);
-      }
-    }
-  }
-
-  // parse Entities
-  if (level->has("Entities")) {
-    auto entitylist = level->at("Entities");
-    int numEntities = entitylist->length();
-    for (int i = 0; i < numEntities; ++i) {
-      auto e = Entity::TryParse(entitylist->at(i));
-      if (e)
-        entities.insert(e->type(), e);
+      structures.append(GeneratedStructure::tryParseChunk(nbtListStructures));
     }
   }
 
@@ -327,19 +364,13 @@ void Chunk::loadCliffsCaves(const NBT &nbt) {
   // parse Block Entities in this Chunk
   if (nbt.has("block_entities")) {
     auto nbtListBE = nbt.at("block_entities");
-    auto belist    = GeneratedStructure::tryParseBlockEntites(nbtListBE);
-    for (auto it = belist.begin(); it != belist.end(); ++it) {
-      emit structureFound(*it);
-    }
+    structures.append(GeneratedStructure::tryParseBlockEntites(nbtListBE));
   }
 
   // parse Structures that start in this Chunk
   if (nbt.has("structures")) {
     auto nbtListStructures = nbt.at("structures");
-    auto structurelist     = GeneratedStructure::tryParseChunk(nbtListStructures);
-    for (auto it = structurelist.begin(); it != structurelist.end(); ++it) {
-      emit structureFound(*it);
-    }
+    structures.append(GeneratedStructure::tryParseChunk(nbtListStructures));
   }
 
   // check for the highest block in this chunk
@@ -351,25 +382,47 @@ void Chunk::loadCliffsCaves(const NBT &nbt) {
 
 
 void Chunk::loadEntities(const NBT &nbt) {
-  // parse Entities in extra folder (1.17+)
-  if (version >= 2681) {
-    if (nbt.has("Entities")) {
-      auto entitylist = nbt.at("Entities");
-      int numEntities = entitylist->length();
-      for (int i = 0; i < numEntities; ++i) {
-        auto entityNbt = entitylist->at(i);
-        auto e = Entity::TryParse(entityNbt);
-        if (e) {
-          entities.insert(e->type(), e);
-
-          // Check for ChunkLock-related entities:
-          loadCheckEntityChunkLock(entityNbt);
-        }
-      }
+  const Tag * entitylist = nullptr;
+  if (nbt.has("Level")) {
+    // Entities inside main map data (up to 1.16)
+    const Tag * level = nbt.at("Level");
+    if (level->has("Entities"))
+      entitylist = level->at("Entities");
+  } else if ((version >= 2681) && nbt.has("Entities")) {
+    // Entities in extra folder (1.17+)
+    entitylist = nbt.at("Entities");
+  }
+  if (!entitylist)
+    return;
+
+  int numEntities = entitylist->length();
+  for (int i = 0; i < numEntities; ++i) {
+    auto entityNbt = entitylist->at(i);
+    auto e = Entity::TryParse(entityNbt);
+    if (e) {
+      entities.insert(e->type(), e);
+
+      // Check for ChunkLock-related entities:
+      loadCheckEntityChunkLock(entityNbt);
     }
   }
 }
 
+void Chunk::loadEntitiesOnly(const NBT &nbt) {
+  // entity region files have their own DataVersion and Position
+  if (nbt.has("DataVersion"))
+    this->version = nbt.at("DataVersion")->toInt();
+  if (nbt.has("Position")) {
+    const std::vector<qint32> &position = nbt.at("Position")->toIntArray();
+    if (position.size() >= 2) {
+      chunkX = position[0];
+      chunkZ = position[1];
+    }
+  }
+
+  loadEntities(nbt);
+}
+
 void Chunk::loadCheckEntityChunkLock(const Tag * entityNbt)
 {
   /* ChunkLock uses a "minecraft:marker" entity to store the state:
@@ -455,7 +508,10 @@ bool Chunk::loadSection1343(ChunkSection *cs, const Tag *section) {
   quint8 data[2048];
   safeMemCpy(blocks, section->at("Blocks")->toByteArray(), 4096);
   safeMemCpy(data,   section->at("Data")->toByteArray(),   2048);
-  safeMemCpy(cs->blockLight, section->at("BlockLight")->toByteArray(), 2048);
+  if (decoded & DECODE_BLOCKLIGHT)
+    safeMemCpy(cs->blockLight, section->at("BlockLight")->toByteArray(), 2048);
+  else
+    memset(cs->blockLight, 0, sizeof(cs->blockLight));
 
   // convert old BlockID + data into virtual ID
   for (int i = 0; i < 4096; i++) {
@@ -513,11 +569,13 @@ bool Chunk::loadSection1519(ChunkSection *cs, const Tag *section) {
 //  if (section->has("SkyLight")) {
 //    safeMemCpy(cs->skyLight, section->at("SkyLight")->toByteArray(), 2048);
 //  }
-  if (section->has("BlockLight")) {
+  // a lit Section contains data, even when its light is not requested
+  if (section->has("BlockLight") && (decoded & DECODE_BLOCKLIGHT)) {
     safeMemCpy(cs->blockLight, section->at("BlockLight")->toByteArray(), 2048);
     sectionContainsData = true;
   } else {
     memset(cs->blockLight, 0, sizeof(cs->blockLight));
+    sectionContainsData |= section->has("BlockLight");
   }
 
   return sectionContainsData;
@@ -547,7 +605,10 @@ bool Chunk::loadSection2844(ChunkSection * cs, const Tag * section) {
 
   // decode Biomes-Palette to be able to map Biome
   if (section->has("biomes") && section->at("biomes")->has("palette")) {
-    loadSection_decodeBiomePalette(cs, section->at("biomes"));
+    if (decoded & DECODE_BIOMES)
+      loadSection_decodeBiomePalette(cs, section->at("biomes"));
+    else
+      std::fill_n(cs->biomes, sizeof(cs->biomes) / sizeof(cs->biomes[0]), quint16(ChunkSection::NO_BIOME));
   } else {
     // observed for unused Y == 20 section
     // probably we should create some default Biome in this case
@@ -558,11 +619,13 @@ bool Chunk::loadSection2844(ChunkSection * cs, const Tag * section) {
 //  if (section->has("SkyLight")) {
 //    safeMemCpy(cs->skyLight, section->at("SkyLight")->toByteArray(), 2048);
 //  }
-  if (section->has("BlockLight")) {
+  // a lit Section contains data, even when its light is not requested
+  if (section->has("BlockLight") && (decoded & DECODE_BLOCKLIGHT)) {
     safeMemCpy(cs->blockLight, section->at("BlockLight")->toByteArray(), 2048);
     sectionContainsData = true;
   } else {
     memset(cs->blockLight, 0, sizeof(cs->blockLight));
+    sectionContainsData |= section->has("BlockLight");
   }
 
   return sectionContainsData;
@@ -8,6 +8,7 @@
 
 #include "nbt/nbt.h"
 #include "overlay/entity.h"
+#include "overlay/entitycluster.h"
 #include "overlay/generatedstructure.h"
 #include "paletteentry.h"
 
@@ -36,27 +37,40 @@ class ChunkSection {
 
   quint16 blocks[16*16*16];       // index into blockPalette for each Block
   quint16 biomes[4*4*4];          // key into BiomeIdentifer for each 4x4x4 volume of Blocks defining the Biome
+  static const quint16 NO_BIOME = 0xffff;  // Biomes not decoded, read as -1 like Chunk Biomes
 //quint8  skyLight[16*16*16/2];   // not needed in Minutor
   quint8  blockLight[16*16*16/2]; // light value for each Block
 };
 
 
-class Chunk : public QObject {
-  Q_OBJECT
-
+class Chunk {
  public:
   Chunk();
   ~Chunk();
-  void load(const NBT &nbt);
+
+  // optional data channels, Block states are always decoded
+  enum DECODE_CHANNELS {
+    DECODE_BLOCKLIGHT = 0x01,  // Block light of each Section
+    DECODE_BIOMES     = 0x02,  // Biomes of Sections or Chunk
+    DECODE_ALL        = 0x03
+  };
+
+  void load(const NBT &nbt, int channels = DECODE_ALL);
   void loadEntities(const NBT &nbt);
+  void loadEntitiesOnly(const NBT &nbt);  // entity region file (1.17+), Chunk stays without Block data
 
   // public getters to read-only access internal data
   int getChunkX() const { return chunkX; }
   int getChunkZ() const { return chunkZ; }
+  int getVersion() const { return version; }  // DataVersion
   const uchar * getImage() const { return image; }
   int  getHighest() const { return highest; }
   int  getLowest() const  { return lowest; }
 
+  // channels decoded by load(), skipped ones read as no light and Biome -1 (unknown)
+  int  getDecodedChannels() const { return decoded; }
+  bool hasChannels(int channels) const { return (decoded & channels) == channels; }
+
   const ChunkSection* getSectionByY(int y) const;
   const ChunkSection* getSectionByIdx(qint8 y) const;
 
@@ -64,17 +78,28 @@ class Chunk : public QObject {
   qint32 getBiomeID(int x, int y, int z) const;
 
   typedef QMultiMap<QString, QSharedPointer<OverlayItem>> EntityMap;
-  const EntityMap& getEntityMap() const;
+  const EntityMap& getEntityMap() const;  // empty until Entities are loaded
 
-  /** Returns whether the chunk is locked by the ChunkLock resourcepack. */
-  bool getIsChunkLocked() const { return isChunkLocked; }
+  // one item per Entity type summarizing all Entities of that type,
+  // used to draw dense Entity overlays when zoomed out
+  typedef QMap<QString, QSharedPointer<OverlayItem>> EntityClusterMap;
+  const EntityClusterMap& getEntityClusters() const;
+
+  /** Returns whether the Entities of this chunk are loaded.
+  Entities are loaded on demand only, see ChunkCache::setEntitiesNeeded(). */
+  bool hasEntities() const;
+
+  /** Returns whether the chunk is locked by the ChunkLock resourcepack.
+  The lock state is stored in an Entity, thus always false until Entities are loaded. */
+  bool getIsChunkLocked() const { return hasEntities() && isChunkLocked; }
 
   /** Returns the name of the item needed for unlocking the ChunkLock.
   Only valid if getIsChunkLocked() returns true. */
   const QString & getChunkLockItemName() const { return chunkLockItemName; }
 
- signals:
-  void structureFound(QSharedPointer<GeneratedStructure> structure);
+ /** Returns the structures and block entities discovered while loading and
+  releases them from the Chunk, so that they can be handed over as one batch. */
+  GeneratedStructureList takeStructures();
 
  protected:
   bool loadSection1343(ChunkSection * cs, const Tag * section);
@@ -90,6 +115,8 @@ class Chunk : public QObject {
   int  renderedFlags;
   bool loaded;
   bool rendering;
+  int  decoded;               // DECODE_CHANNELS present
+  QAtomicInt upgrading;       // UpgradeState of a reload with more channels
   long long inhabitedTime;
 
   QVector<ChunkSection*> sections;
@@ -98,6 +125,26 @@ class Chunk : public QObject {
   uchar  image[16 * 16 * 4];  // cached render: RGBA for 16*16 Blocks
   short  depth[16 * 16];      // cached depth map to create shadow
   EntityMap entities;
+  EntityClusterMap entityClusters;
+  GeneratedStructureList structures;  // discovered during load, until taken
+
+  // on demand loading of Entities
+  enum EntityState {
+    ENTITIES_NONE   = 0,  // not requested yet
+    ENTITIES_QUEUED = 1,  // a load is scheduled or running
+    ENTITIES_LOADED = 2   // entities map is valid
+  };
+  QAtomicInt entityState;
+  QMutex     entityMutex;     // held while Entities are parsed
+  bool requestEntities();     // returns true if caller is responsible for loading
+  void setEntitiesLoaded();
+
+  // reload with channels missing for drawing
+  enum UpgradeState {
+    UPGRADE_NONE   = 0,  // not requested yet
+    UPGRADE_QUEUED = 1,  // a reload is scheduled or running
+    UPGRADE_FAILED = 2   // reload failed, draw with the decoded channels
+  };
 
   // ChunkLocked feature:
   bool    isChunkLocked;      // flag specifies whether the chunk is locked by the ChunkLock resourcepack
@@ -109,9 +156,13 @@ class Chunk : public QObject {
   friend class MapView;
   friend class ChunkRenderer;
   friend class ChunkCache;
+  friend class ChunkLoader;
 
  private:
+  Q_DISABLE_COPY(Chunk)
+
   void findHighestBlock();
+  void buildEntityClusters();
   void setSectionByIdx(qint8 y, ChunkSection *cs);
   void loadLevelTag(const Tag * levelTag);  // nested structure with Level tag (up to 1.17)
   void loadCliffsCaves(const NBT &nbt);     // flat structure without Level tag (1.18+)
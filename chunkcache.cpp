@@ -1,7 +1,29 @@
 /** Copyright (c) 2013, Sean Kasun */
 
+/*
+ Two tiers of cached Chunks:
+ - the main Cache holds everything needed for drawing the map
+ - the small probation Cache receives Chunks loaded by bulk scans
+   (search, statistic), so a scan over thousands of Chunks never evicts
+   the Chunks of the current view.  A Chunk in probation that is
+   requested again for drawing is promoted into the main Cache.
+
+ Requests for Chunks without data on disk (void, not generated, missing
+ region file) are answered from a presence bitmap per Region, built once
+ from the region header, without creating an entry or a loader.
+
+ MapView prefetches Chunks ahead of panning and zooming, these loaders run
+ with lower priority than the ones for visible Chunks.
+
+ Chunks are decoded with the channels (Block light, Biomes) needed by the
+ current view flags, bulk scans decode only what they evaluate.  A cached
+ Chunk lacking a channel needed for drawing is reloaded in background and
+ replaces the cached entry when done.
+ */
+
 #include "chunkcache.h"
 #include "chunkloader.h"
+#include "regionfile.h"
 
 
 #if defined(__unix__) || defined(__unix) || defined(unix)
@@ -13,7 +35,10 @@
 #include <sys/sysctl.h>
 #endif
 
-ChunkCache::ChunkCache() {
+ChunkCache::ChunkCache()
+  : entitiesNeeded(false)
+  , decodeChannels(Chunk::DECODE_ALL)
+{
   const int sizeChunkMax     = sizeof(Chunk) + 16 * sizeof(ChunkSection);  // all sections contain Blocks
   const int sizeChunkTypical = sizeof(Chunk) + 6 * sizeof(ChunkSection);   // world generation is average Y=64..128
 
@@ -46,13 +71,14 @@ ChunkCache::ChunkCache() {
 #endif
   // we start the Cache based on worst case calculation
   cache.setMaxCost(chunks);
+  probation.setMaxCost(std::max<int>(PROBATION_MIN, chunks / PROBATION_FRACTION));
 
   // determain optimal thread pool size for "loading"
   // as this contains disk access, use less than number of cores
   int tmax = loaderThreadPool.maxThreadCount();
   loaderThreadPool.setMaxThreadCount(tmax / 2);
 
-  qRegisterMetaType<QSharedPointer<GeneratedStructure>>("QSharedPointer<GeneratedStructure>");
+  qRegisterMetaType<GeneratedStructureList>("GeneratedStructureList");
 }
 
 ChunkCache::~ChunkCache() {
@@ -67,8 +93,18 @@ ChunkCache& ChunkCache::Instance() {
 void ChunkCache::clear() {
   QThreadPool::globalInstance()->waitForDone();
 
-  QMutexLocker guard(&mutex);
-  cache.clear();
+  {
+    QMutexLocker guard(&mutex);
+    cache.clear();
+    probation.clear();
+    mainStatistics      = TierStatistics();
+    probationStatistics = TierStatistics();
+  }
+  advisedRegions.clear();
+  // Minecraft may have stored new Chunks meanwhile
+  QMutexLocker guard(&presenceMutex);
+  presence.clear();
+  absentRequests = 0;
 }
 
 void ChunkCache::setPath(QString path) {
@@ -92,6 +128,59 @@ int ChunkCache::getMemoryMax() const {
   return maxcache;
 }
 
+QString ChunkCache::getStatistics() const {
+  quint64 absent;
+  {
+    QMutexLocker guard(&presenceMutex);
+    absent = absentRequests;
+  }
+  QMutexLocker guard(&mutex);
+  return QString("Cache:%1/%2 (hit:%3 miss:%4) Probation:%5/%6 (hit:%7 miss:%8) Absent:%9")
+      .arg(cache.totalCost()).arg(cache.maxCost())
+      .arg(mainStatistics.hits).arg(mainStatistics.misses)
+      .arg(probation.totalCost()).arg(probation.maxCost())
+      .arg(probationStatistics.hits).arg(probationStatistics.misses)
+      .arg(absent);
+}
+
+void ChunkCache::setEntitiesNeeded(bool needed) {
+  entitiesNeeded = needed;
+}
+
+bool ChunkCache::getEntitiesNeeded() const {
+  return entitiesNeeded;
+}
+
+void ChunkCache::fetchEntities(int cx, int cz, const QSharedPointer<Chunk> &chunk) {
+  if (!chunk || !chunk->requestEntities())
+    return;  // not loaded yet, or Entities are loaded or queued already
+
+  // Block data is present, load Entities in background
+  ChunkLoader *loader = new ChunkLoader(path, cx, cz, ChunkLoader::JOB_ENTITIES);
+  connect(loader, SIGNAL(entitiesLoaded(int, int)),
+          this,   SLOT(gotEntities(int, int)));
+  loaderThreadPool.start(loader);
+}
+
+void ChunkCache::setDecodeChannels(int channels) {
+  decodeChannels = channels;
+}
+
+int ChunkCache::getDecodeChannels() const {
+  return decodeChannels;
+}
+
+void ChunkCache::replace(const ChunkID &id, const QSharedPointer<Chunk> &old,
+                         const QSharedPointer<Chunk> &chunk) {
+  QMutexLocker guard(&mutex);
+  QSharedPointer<Chunk> * p_chunk = cache.object(id);
+  if (!p_chunk)
+    p_chunk = probation.object(id);
+  // evicted or replaced meanwhile -> drop it
+  if (p_chunk && (*p_chunk == old))
+    *p_chunk = chunk;
+}
+
 QSharedPointer<Chunk> ChunkCache::fetchCached(int cx, int cz) {
   // try to get Chunk from Cache
   ChunkID id(cx, cz);
@@ -107,23 +196,81 @@ CacheState ChunkCache::getCached(const ChunkID &id, QSharedPointer<Chunk> &chunk
   return getCached_intern(id, chunk_out);
 }
 
+CacheState ChunkCache::stateOf(const QSharedPointer<Chunk> &chunk)
+{
+  if (!chunk)
+    return CacheState::cached; // cached - but not existing and thus empty
+
+  if (!chunk->loaded)
+    return CacheState::uncached_loading;
+
+  return CacheState::cached;
+}
+
 CacheState ChunkCache::getCached_intern(const ChunkID &id, QSharedPointer<Chunk> &chunk_out)
 {
   QSharedPointer<Chunk> * p_chunk = cache[id];   // const operation
-  if (!p_chunk)
+  if (p_chunk)
   {
-    return CacheState::uncached;
+    mainStatistics.hits++;
+    chunk_out = (*p_chunk);
+    return stateOf(chunk_out);
   }
+  mainStatistics.misses++;
 
-  chunk_out = (*p_chunk);
+  // second request of a Chunk seen by a bulk scan -> promote into main Cache
+  p_chunk = probation.take(id);
+  if (p_chunk)
+  {
+    probationStatistics.hits++;
+    chunk_out = (*p_chunk);
+    cache.insert(id, p_chunk);
+    return stateOf(chunk_out);
+  }
+  probationStatistics.misses++;
 
-  if (!chunk_out)
-    return CacheState::cached; // cached - but not existing and thus empty
+  return CacheState::uncached;
+}
 
-  if (!chunk_out->loaded)
-    return CacheState::uncached_loading;
+// lookup for bulk scans, without changing the tier of a Chunk
+CacheState ChunkCache::getScanned_intern(const ChunkID &id, QSharedPointer<Chunk> &chunk_out)
+{
+  QSharedPointer<Chunk> * p_chunk = cache[id];
+  if (p_chunk)
+  {
+    mainStatistics.hits++;
+    chunk_out = (*p_chunk);
+    return stateOf(chunk_out);
+  }
+  mainStatistics.misses++;
 
-  return CacheState::cached;
+  p_chunk = probation[id];
+  if (p_chunk)
+  {
+    probationStatistics.hits++;
+    chunk_out = (*p_chunk);
+    return stateOf(chunk_out);
+  }
+  probationStatistics.misses++;
+
+  return CacheState::uncached;
+}
+
+// Chunk has data on disk, the header of each Region is read only once
+bool ChunkCache::isPresent(const ChunkID &id)
+{
+  const QPair<int, int> region(id.getX() >> 5, id.getZ() >> 5);
+  QMutexLocker guard(&presenceMutex);
+  auto it = presence.constFind(region);
+  if (it == presence.constEnd()) {
+    RegionFile file(RegionFile::filename(path, "region", region.first, region.second));
+    it = presence.insert(region, file.presence());
+  }
+
+  if (!it.value().isEmpty() && it.value().testBit((id.getX() & 31) + (id.getZ() & 31) * 32))
+    return true;
+  absentRequests++;
+  return false;
 }
 
 QSharedPointer<Chunk> ChunkCache::fetch(int cx, int cz) {
@@ -131,28 +278,90 @@ QSharedPointer<Chunk> ChunkCache::fetch(int cx, int cz) {
   ChunkID id(cx, cz);
   QSharedPointer<Chunk> chunk;
   const CacheState state = getCached(id, chunk);
-  if (state == CacheState::cached)
+  if ((state == CacheState::uncached) && !isPresent(id))
+    return chunk;  // nothing on disk, no need to start a loader
+
+  if (state == CacheState::cached) {
+    if (chunk && !chunk->hasChannels(decodeChannels) && chunk->upgrading.testAndSetOrdered(Chunk::UPGRADE_NONE, Chunk::UPGRADE_QUEUED)) {
+      // decoded for other flags or by a scan, reload with the missing channels
+      ChunkLoader *loader = new ChunkLoader(path, cx, cz, ChunkLoader::JOB_UPGRADE,
+                                            chunk->getDecodedChannels() | decodeChannels);
+      connect(loader, SIGNAL(loaded(int, int)),
+              this,   SLOT(gotChunk(int, int)));
+      loaderThreadPool.start(loader);
+    }
+    if (entitiesNeeded)
+      fetchEntities(cx, cz, chunk);
     return chunk;
-  else if (state == CacheState::uncached_loading)
+  } else if (state == CacheState::uncached_loading)
     return QSharedPointer<Chunk>(); // already loading, return nullptr
 
   // launch background process to load this chunk
+  startLoader(id, 0);
+  return QSharedPointer<Chunk>(NULL);
+}
+
+// insert an empty entry and load the Chunk in background
+void ChunkCache::startLoader(const ChunkID &id, int priority) {
   QSharedPointer<Chunk> * p_chunk = new QSharedPointer<Chunk>(new Chunk());
-  connect(p_chunk->data(), SIGNAL(structureFound(QSharedPointer<GeneratedStructure>)),
-          this,            SLOT  (routeStructure(QSharedPointer<GeneratedStructure>)));
 
   {
     QMutexLocker guard(&mutex);
     cache.insert(id, p_chunk);    // non-const operation !
   }
-  ChunkLoader *loader = new ChunkLoader(path, cx, cz);
+  ChunkLoader *loader = new ChunkLoader(path, id.getX(), id.getZ(),
+                                        entitiesNeeded ? ChunkLoader::JOB_MAP_DATA_AND_ENTITIES
+                                                       : ChunkLoader::JOB_MAP_DATA,
+                                        decodeChannels);
   connect(loader, SIGNAL(loaded(int, int)),
           this,   SLOT(gotChunk(int, int)));
-  loaderThreadPool.start(loader);
-  return QSharedPointer<Chunk>(NULL);
+  connect(loader, SIGNAL(structuresFound(GeneratedStructureList)),
+          this,   SLOT(routeStructures(GeneratedStructureList)));
+  loaderThreadPool.start(loader, priority);
+}
+
+bool ChunkCache::prefetch(int cx, int cz) {
+  ChunkID id(cx, cz);
+  {
+    QMutexLocker guard(&mutex);
+    if (cache.contains(id) || probation.contains(id))
+      return false;
+  }
+  if (!isPresent(id))
+    return false;
+
+  // hint the OS to read the region file ahead, once per Region
+  const QPair<int, int> region(cx >> 5, cz >> 5);
+  if (!advisedRegions.contains(region)) {
+    advisedRegions.insert(region);
+    RegionFile(RegionFile::filename(path, "region", region.first, region.second)).willNeed();
+  }
+
+  startLoader(id, PREFETCH_PRIORITY);
+  return true;
+}
+
+bool ChunkCache::isCached(const ChunkID &id) const {
+  QMutexLocker guard(&mutex);
+  return cache.contains(id) || probation.contains(id);
+}
+
+QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(const ChunkID& id, bool withEntities, CachePolicy policy,
+                                                        int channels)
+{
+  if (!isPresent(id))
+    return QSharedPointer<Chunk>();  // avoids opening the region files
+
+  const int rx = id.getX() >> 5;
+  const int rz = id.getZ() >> 5;
+  RegionFile region(RegionFile::filename(path, "region", rx, rz));
+  RegionFile entityRegion(RegionFile::filename(path, "entities", rx, rz));
+  return getChunkSynchronously(id, withEntities, policy, region, entityRegion, channels);
 }
 
-QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(const ChunkID& id)
+QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(const ChunkID& id, bool withEntities, CachePolicy policy,
+                                                        RegionFile &region, RegionFile &entityRegion,
+                                                        int channels)
 {
   QSharedPointer<Chunk> chunk;
   bool hasFreeSpaceInCache = false;
@@ -160,20 +369,55 @@ QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(const ChunkID& id)
     QMutexLocker guard(&mutex);
     hasFreeSpaceInCache = (cache.totalCost() < cache.maxCost() * 0.9);
 
-    const CacheState state = getCached_intern(id, chunk);
-    if (state == CacheState::cached)
+    const CacheState state = (policy == CachePolicy::scan) ? getScanned_intern(id, chunk)
+                                                           : getCached_intern(id, chunk);
+    if ((state == CacheState::cached) && chunk && !chunk->hasChannels(channels)) {
+      guard.unlock();
+      // decoded with fewer channels, reload and replace the cached entry
+      QSharedPointer<Chunk> upgraded = QSharedPointer<Chunk>::create();
+      if (!ChunkLoader::loadNbt(region, entityRegion, id.getX(), id.getZ(), upgraded,
+                                withEntities || chunk->hasEntities(),
+                                chunk->getDecodedChannels() | channels))
+        return QSharedPointer<Chunk>();
+      upgraded->takeStructures();  // already reported by the first load
+      replace(id, chunk, upgraded);
+      return upgraded;
+    }
+    if (state == CacheState::cached) {
+      if (chunk && withEntities && !chunk->hasEntities()) {
+        guard.unlock();
+        // Block data is cached, add missing Entities
+        // (waits in case a background load is running)
+        chunk->requestEntities();
+        ChunkLoader::loadEntities(path, id.getX(), id.getZ(), chunk);
+      }
       return chunk;
+    }
   }
 
   // sychronously load
+  // Chunks for the main Cache also get the channels needed for drawing
   chunk = QSharedPointer<Chunk>::create();
+  if (policy != CachePolicy::scan)
+    channels |= decodeChannels;
 
-  if (!ChunkLoader::loadNbt(path, id.getX(), id.getZ(), chunk))
+  if (!ChunkLoader::loadNbt(region, entityRegion, id.getX(), id.getZ(), chunk, withEntities, channels))
   {
     return QSharedPointer<Chunk>();
   }
 
-  if (hasFreeSpaceInCache && chunk->loaded) // only cache in case of lot of memory to not degrade drawing performance
+  // bulk scans would flood the overlays with every structure they pass
+  GeneratedStructureList structures = chunk->takeStructures();
+  if (!structures.isEmpty() && (policy == CachePolicy::normal))
+    emit structuresFound(structures);
+
+  if (chunk->loaded && (policy == CachePolicy::scan)) // scans never evict Chunks from main Cache
+  {
+    QMutexLocker guard(&mutex);
+    if (!cache.contains(id))
+      probation.insert(id, new QSharedPointer<Chunk>(chunk));
+  }
+  else if (hasFreeSpaceInCache && chunk->loaded) // only cache in case of lot of memory to not degrade drawing performance
   {
     QMutexLocker guard(&mutex);
     cache.insert(id, new QSharedPointer<Chunk>(chunk));
@@ -182,16 +426,50 @@ QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(const ChunkID& id)
   return chunk;
 }
 
+QSharedPointer<Chunk> ChunkCache::getEntitiesSynchronously(const ChunkID& id, CachePolicy policy,
+                                                           RegionFile &region, RegionFile &entityRegion)
+{
+  QSharedPointer<Chunk> chunk;
+  {
+    QMutexLocker guard(&mutex);
+    const CacheState state = (policy == CachePolicy::scan) ? getScanned_intern(id, chunk)
+                                                           : getCached_intern(id, chunk);
+    if ((state == CacheState::cached) && (!chunk || chunk->hasEntities()))
+      return chunk;
+  }
+
+  // sychronously load Entities only
+  // such a Chunk is never cached, as it has no Block data for drawing
+  chunk = QSharedPointer<Chunk>::create();
+
+  if (!ChunkLoader::loadEntitiesOnly(region, entityRegion, id.getX(), id.getZ(), chunk))
+  {
+    return QSharedPointer<Chunk>();
+  }
+
+  // bulk scans would flood the overlays with every structure they pass
+  GeneratedStructureList structures = chunk->takeStructures();
+  if (!structures.isEmpty() && (policy == CachePolicy::normal))
+    emit structuresFound(structures);
+
+  return chunk;
+}
+
 void ChunkCache::gotChunk(int cx, int cz) {
   emit chunkLoaded(cx, cz);
 }
 
-void ChunkCache::routeStructure(QSharedPointer<GeneratedStructure> structure) {
-  emit structureFound(structure);
+void ChunkCache::gotEntities(int cx, int cz) {
+  emit entitiesLoaded(cx, cz);
+}
+
+void ChunkCache::routeStructures(GeneratedStructureList structures) {
+  emit structuresFound(structures);
 }
 
 void ChunkCache::setCacheMaxSize(int chunks) {
   QMutexLocker guard(&mutex);
   // we never decrease Cache size, and never exceed physical memory
   cache.setMaxCost(std::max<int>(cache.maxCost(), std::min<int>(chunks, maxcache)));
+  probation.setMaxCost(std::max<int>(PROBATION_MIN, cache.maxCost() / PROBATION_FRACTION));
 }
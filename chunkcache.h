@@ -3,16 +3,28 @@
 #define CHUNKCACHE_H_
 
 #include <QObject>
+#include <QBitArray>
 #include <QCache>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 #include "chunk.h"
 #include "chunkid.h"
 
+class RegionFile;
+
 enum class CacheState {
   uncached,
   uncached_loading,
   cached // still can be nullptr when empty
 };
 
+// admission of Chunks loaded by getChunkSynchronously()
+enum class CachePolicy {
+  normal,  // main Cache, while it has free space
+  scan     // bulk scans (search, statistic): small probation Cache only
+};
+
 class ChunkCache : public QObject {
   Q_OBJECT
 
@@ -32,31 +44,75 @@ class ChunkCache : public QObject {
   QString getPath() const;
   QSharedPointer<Chunk> fetch(int cx, int cz);         // fetch Chunk and load when not found
   QSharedPointer<Chunk> fetchCached(int cx, int cz);   // fetch Chunk only if cached
+  bool prefetch(int cx, int cz);                       // load at low priority when not cached, true if started
+  bool isCached(const ChunkID& id) const;              // entry exists (without statistics or promotion)
   CacheState getCached(const ChunkID& id, QSharedPointer<Chunk>& chunk_out);    // fetch Chunk only if cached, can tell if just not loaded or empty
-  QSharedPointer<Chunk> getChunkSynchronously(const ChunkID& id);         // get chunk if cached directly, or load it in a synchronous blocking way
+  QSharedPointer<Chunk> getChunkSynchronously(const ChunkID& id, bool withEntities = false,
+                                              CachePolicy policy = CachePolicy::normal,
+                                              int channels = Chunk::DECODE_ALL);  // get chunk if cached directly, or load it in a synchronous blocking way
+  QSharedPointer<Chunk> getChunkSynchronously(const ChunkID& id, bool withEntities, CachePolicy policy,
+                                              RegionFile &region, RegionFile &entityRegion,
+                                              int channels = Chunk::DECODE_ALL);  // same, using already opened region files
+  QSharedPointer<Chunk> getEntitiesSynchronously(const ChunkID& id, CachePolicy policy,
+                                                 RegionFile &region, RegionFile &entityRegion);  // Chunk with Entities, Block data only when cached
+  void setEntitiesNeeded(bool needed);                 // when set, fetch() also loads Entities
+  void fetchEntities(int cx, int cz, const QSharedPointer<Chunk>& chunk);  // load Entities of a cached Chunk in background
+  bool getEntitiesNeeded() const;
+  void setDecodeChannels(int channels);                // Chunk::DECODE_CHANNELS needed for drawing
+  int  getDecodeChannels() const;
+  void replace(const ChunkID& id, const QSharedPointer<Chunk>& old,
+               const QSharedPointer<Chunk>& chunk);    // exchange entry when it still holds old
   int getCacheUsage() const;
   int getCacheMax() const;
   int getMemoryMax() const;
+  QString getStatistics() const;                       // usage, hits and misses per tier
+
+  static const int PROBATION_MIN      = 1024;  // Chunks at least in probation Cache
+  static const int PROBATION_FRACTION = 16;    // probation size relative to main Cache
+  static const int PREFETCH_PRIORITY  = -1;    // loaders of visible Chunks use 0
 
  signals:
   void chunkLoaded(int cx, int cz);
-  void structureFound(QSharedPointer<GeneratedStructure> structure);
+  void entitiesLoaded(int cx, int cz);
+  void structuresFound(GeneratedStructureList structures);
 
  public slots:
   void setCacheMaxSize(int chunks);
 
  private slots:
   void gotChunk(int cx, int cz);
-  void routeStructure(QSharedPointer<GeneratedStructure> structure);
+  void gotEntities(int cx, int cz);
+  void routeStructures(GeneratedStructureList structures);
 
  private:
   QString path;                                   // path to folder with region files
   QCache<ChunkID, QSharedPointer<Chunk>> cache;   // real Cache
-  QMutex mutex;                                   // Mutex for accessing the Cache
+  QCache<ChunkID, QSharedPointer<Chunk>> probation;  // Chunks seen by bulk scans only once
+  mutable QMutex mutex;                           // Mutex for accessing the Caches
   int maxcache;                                   // number of Chunks that fit into memory
   QThreadPool loaderThreadPool;                   // extra thread pool for loading
+  bool entitiesNeeded;                            // Entities are loaded on demand only
+  int  decodeChannels;                            // optional Chunk data needed for drawing
+
+  // Chunks stored on disk: region header summarized on first use, empty for missing files
+  QHash<QPair<int, int>, QBitArray> presence;
+  mutable QMutex presenceMutex;                   // Mutex for presence and absentRequests
+  quint64 absentRequests = 0;                     // requests answered without loading
+  bool isPresent(const ChunkID& id);
+
+  QSet<QPair<int, int>> advisedRegions;           // region files hinted for read ahead
+  void startLoader(const ChunkID& id, int priority);
+
+  struct TierStatistics {
+    quint64 hits   = 0;
+    quint64 misses = 0;
+  };
+  TierStatistics mainStatistics;
+  TierStatistics probationStatistics;
 
   CacheState getCached_intern(const ChunkID& id, QSharedPointer<Chunk>& chunk_out);
+  CacheState getScanned_intern(const ChunkID& id, QSharedPointer<Chunk>& chunk_out);
+  static CacheState stateOf(const QSharedPointer<Chunk>& chunk);
 };
 
 #endif  // CHUNKCACHE_H_
@@ -3,11 +3,15 @@
 #include "chunkloader.h"
 #include "chunkcache.h"
 #include "chunk.h"
+#include "regionfile.h"
+#include "nbt/nbtprojection.h"
 
 
-ChunkLoader::ChunkLoader(QString path, int cx, int cz)
+ChunkLoader::ChunkLoader(QString path, int cx, int cz, int job, int channels)
   : path(path)
   , cx(cx), cz(cz)
+  , job(job)
+  , channels(channels)
   , cache(ChunkCache::Instance())
 {}
 
@@ -17,112 +21,147 @@ ChunkLoader::~ChunkLoader()
 void ChunkLoader::run() {
   // get existing Chunk entry from Cache
   QSharedPointer<Chunk> chunk(cache.fetchCached(cx, cz));
+
+  if (job == JOB_ENTITIES) {
+    // Block data is already present
+    if (loadEntities(path, cx, cz, chunk))
+      emit entitiesLoaded(cx, cz);
+    return;
+  }
+
+  if (job == JOB_UPGRADE) {
+    // decode into a new Chunk, the cached one stays readable meanwhile
+    QSharedPointer<Chunk> upgraded = QSharedPointer<Chunk>::create();
+    if (chunk && loadNbt(path, cx, cz, upgraded, chunk->hasEntities(), channels)) {
+      upgraded->takeStructures();  // already reported by the first load
+      cache.replace(ChunkID(cx, cz), chunk, upgraded);
+    } else if (chunk) {
+      // not retried, the Chunk is rendered with the channels it has
+      chunk->upgrading.storeRelease(Chunk::UPGRADE_FAILED);
+    }
+    emit loaded(cx, cz);
+    return;
+  }
+
   // load & parse NBT data
-  loadNbt(path, cx, cz, chunk);
+  if (loadNbt(path, cx, cz, chunk, (job == JOB_MAP_DATA_AND_ENTITIES), channels)) {
+    // hand over all structures of this Chunk at once
+    GeneratedStructureList structures = chunk->takeStructures();
+    if (!structures.isEmpty())
+      emit structuresFound(structures);
+  }
   emit loaded(cx, cz);
 }
 
-bool ChunkLoader::loadNbt(QString path, int cx, int cz, QSharedPointer<Chunk> chunk)
+int ChunkLoader::decodeChannels(int parts)
 {
-  // check if chunk is a valid storage
-  if (!chunk) {
-    return false;
-  }
+  return ((parts & PART_BLOCKLIGHT) ? Chunk::DECODE_BLOCKLIGHT : 0) |
+         ((parts & PART_BIOMES)     ? Chunk::DECODE_BIOMES     : 0);
+}
 
+bool ChunkLoader::loadNbt(QString path, int cx, int cz, QSharedPointer<Chunk> chunk, bool withEntities,
+                          int channels)
+{
   // get coordinates of region file
   int rx = cx >> 5;
   int rz = cz >> 5;
 
-  QString filename;
+  RegionFile region(RegionFile::filename(path, "region", rx, rz));
+  RegionFile entityRegion(RegionFile::filename(path, "entities", rx, rz));
+  return loadNbt(region, entityRegion, cx, cz, chunk, withEntities, channels);
+}
 
-  filename = path + "/region/r." + QString::number(rx) + "." + QString::number(rz) + ".mca";
-  bool result = loadNbtHelper(filename, cx, cz, chunk, ChunkLoader::MAIN_MAP_DATA);
+bool ChunkLoader::loadNbt(RegionFile &region, RegionFile &entityRegion,
+                          int cx, int cz, QSharedPointer<Chunk> chunk, bool withEntities,
+                          int channels)
+{
+  // check if chunk is a valid storage
+  if (!chunk) {
+    return false;
+  }
+
+  if (!withEntities || !chunk->requestEntities())
+    return region.load(cx, cz, chunk, ChunkLoader::MAIN_MAP_DATA, channels);
 
-  filename = path + "/entities/r." + QString::number(rx) + "." + QString::number(rz) + ".mca";
-  loadNbtHelper(filename, cx, cz, chunk, ChunkLoader::SEPARATED_ENTITIES);
+  QMutexLocker guard(&chunk->entityMutex);
+  // up to 1.16 Entities are parsed from main map data in the same pass
+  bool result = region.load(cx, cz, chunk, ChunkLoader::MAIN_MAP_DATA_WITH_ENTITIES, channels);
+
+  if (chunk->version >= 2681) {
+    entityRegion.load(cx, cz, chunk, ChunkLoader::ENTITY_DATA, channels);
+  }
+  chunk->setEntitiesLoaded();
 
   return result;
 }
 
-bool ChunkLoader::loadNbtHelper(QString filename, int cx, int cz, QSharedPointer<Chunk> chunk, int loadtype)
+bool ChunkLoader::loadEntities(QString path, int cx, int cz, QSharedPointer<Chunk> chunk)
 {
-  QFile f(filename);
-
-  if (!f.open(QIODevice::ReadOnly)) {
-    // no chunks in this region (region file not present at all)
+  // check if chunk is a valid storage
+  if (!chunk) {
     return false;
   }
 
-  const int headerSize = 4096;
-
-  if (f.size() < headerSize) {
-    // file header not yet fully written by minecraft
+  QMutexLocker guard(&chunk->entityMutex);
+  if (chunk->hasEntities()) {
+    // already loaded by another thread while we were waiting
     return false;
   }
 
-  // map header into memory
-  uchar *header = f.map(0, headerSize);
-  int offset = 4 * ((cx & 31) + (cz & 31) * 32);
-
-  int coffset = (header[offset] << 16) | (header[offset + 1] << 8) | header[offset + 2];
-  int numSectors = header[offset+3];
-  f.unmap(header);
+  // get coordinates of region file
+  int rx = cx >> 5;
+  int rz = cz >> 5;
 
-  if (coffset == 0) {
-    // no Chunk information stored in region file
-    f.close();
-    return false;
-  }
+  // Entities are stored in an extra folder since 1.17, before inside main map data
+  QString folder = (chunk->version >= 2681) ? "/entities/r." : "/region/r.";
+  QString filename = path + folder + QString::number(rx) + "." + QString::number(rz) + ".mca";
+  loadNbtHelper(filename, cx, cz, chunk, ChunkLoader::ENTITY_DATA);
+  chunk->setEntitiesLoaded();
 
-  const int chunkStart = coffset * 4096;
-  const int chunkSize = numSectors * 4096;
+  return true;
+}
 
-  // Check if chunk header (5 bytes: 4 length + 1 compression) is readable
-  if (f.size() < chunkStart + 5) {
-    f.close();
+bool ChunkLoader::loadEntitiesOnly(RegionFile &region, RegionFile &entityRegion,
+                                   int cx, int cz, QSharedPointer<Chunk> chunk)
+{
+  // check if chunk is a valid storage
+  if (!chunk) {
     return false;
   }
 
-  // Read chunk header to get actual data length
-  f.seek(chunkStart);
-  char headerBuf[4];
-  if (f.read(headerBuf, 4) != 4) {
-    f.close();
-    return false;
+  if (!entityRegion.contains(cx, cz)) {
+    // no entity entry: 1.17+ stores none for Chunks without Entities,
+    // only Chunks not converted to 1.17+ yet have them inside main map data
+    NBTProjection projection;
+    const int versionField = projection.addField({"DataVersion"});
+    if (!region.scan(cx, cz, projection))
+      return false;
+    const int version = static_cast<int>(projection.toLong(versionField));
+    if (version < 2681)
+      return loadNbt(region, entityRegion, cx, cz, chunk, true);
+
+    if (!chunk->requestEntities())
+      return false;
+    QMutexLocker guard(&chunk->entityMutex);
+    chunk->version = version;
+    chunk->chunkX  = cx;
+    chunk->chunkZ  = cz;
+    chunk->setEntitiesLoaded();  // empty
+    return true;
   }
-  const uchar *hdr = reinterpret_cast<const uchar*>(headerBuf);
-  int actualLength = (hdr[0] << 24) | (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
 
-  // Sanity check: length must be positive and fit within allocated sectors
-  if (actualLength <= 0 || actualLength + 4 > chunkSize) {
-    f.close();
+  if (!chunk->requestEntities())
     return false;
-  }
 
-  // Check actual data fits in file (handles unpadded files like WorldTools exports)
-  if (f.size() < chunkStart + 4 + actualLength) {
-    f.close();
-    return false;
-  }
+  QMutexLocker guard(&chunk->entityMutex);
+  bool result = entityRegion.load(cx, cz, chunk, ChunkLoader::ENTITY_DATA_ONLY, 0);
+  chunk->setEntitiesLoaded();
 
-  uchar *raw = f.map(chunkStart, actualLength + 4);
-  if (raw == NULL) {
-    f.close();
-    return false;
-  }
-  // parse Chunk data
-  // Chunk will be flagged "loaded" in a thread save way
-  NBT nbt(raw);
-  switch (loadtype) {
-    case ChunkLoader::MAIN_MAP_DATA:
-      chunk->load(nbt);
-      Q_FALLTHROUGH();
-    case ChunkLoader::SEPARATED_ENTITIES:
-      chunk->loadEntities(nbt);
-  }
-  f.unmap(raw);
-  f.close();
+  return result;
+}
 
-  // if we reach this point, everything went well
-  return true;
+bool ChunkLoader::loadNbtHelper(QString filename, int cx, int cz, QSharedPointer<Chunk> chunk, int loadtype)
+{
+  RegionFile region(filename);
+  return region.load(cx, cz, chunk, loadtype, Chunk::DECODE_ALL);
 }
@@ -6,23 +6,56 @@
 #include <QRunnable>
 #include "chunkcache.h"
 
+class RegionFile;
+
 class ChunkLoader : public QObject, public QRunnable {
   Q_OBJECT
 
  public:
-  ChunkLoader(QString path, int cx, int cz);
+  enum LOADER_JOB {
+    JOB_MAP_DATA              = 0,  // Block data only
+    JOB_MAP_DATA_AND_ENTITIES = 1,  // Block data and Entities
+    JOB_ENTITIES              = 2,  // Entities for an already loaded Chunk
+    JOB_UPGRADE               = 3   // reload a cached Chunk with more channels
+  };
+
+  ChunkLoader(QString path, int cx, int cz, int job = JOB_MAP_DATA,
+              int channels = Chunk::DECODE_ALL);
   ~ChunkLoader();
 
   enum CHUNKLOAD_TYPE {
-    MAIN_MAP_DATA      = 0,
-    SEPARATED_ENTITIES = 1
+    MAIN_MAP_DATA               = 0,
+    MAIN_MAP_DATA_WITH_ENTITIES = 1,
+    ENTITY_DATA                 = 2,
+    ENTITY_DATA_ONLY            = 3   // Entities of a Chunk without Block data
+  };
+
+  // parts of a Chunk needed by a scan, everything else is not decoded
+  enum CHUNK_PARTS {
+    PART_BLOCKS     = 0x01,  // Sections with Block states
+    PART_ENTITIES   = 0x02,  // Entities
+    PART_BLOCKLIGHT = 0x04,  // Block light of Sections, together with PART_BLOCKS
+    PART_BIOMES     = 0x08   // Biomes, together with PART_BLOCKS
   };
+  static int decodeChannels(int parts);  // Chunk::DECODE_CHANNELS of CHUNK_PARTS
 
-  static bool loadNbt(QString path, int cx, int cz, QSharedPointer<Chunk> chunk);
+  static bool loadNbt(QString path, int cx, int cz, QSharedPointer<Chunk> chunk, bool withEntities = false,
+                      int channels = Chunk::DECODE_ALL);
+  // same with already opened region files, when loading many Chunks of one Region
+  static bool loadNbt(RegionFile &region, RegionFile &entityRegion,
+                      int cx, int cz, QSharedPointer<Chunk> chunk, bool withEntities = false,
+                      int channels = Chunk::DECODE_ALL);
+  static bool loadEntities(QString path, int cx, int cz, QSharedPointer<Chunk> chunk);
+  // Entities only, from the entity region file (1.17+), the main region file is
+  // read just for the DataVersion of Chunks without entity entry
+  static bool loadEntitiesOnly(RegionFile &region, RegionFile &entityRegion,
+                               int cx, int cz, QSharedPointer<Chunk> chunk);
   static bool loadNbtHelper(QString filename, int cx, int cz, QSharedPointer<Chunk> chunk, int loadtype);
 
  signals:
   void loaded(int cx, int cz);
+  void entitiesLoaded(int cx, int cz);
+  void structuresFound(GeneratedStructureList structures);
 
  protected:
   void run();
@@ -30,6 +63,8 @@ class ChunkLoader : public QObject, public QRunnable {
  private:
   QString path;
   int     cx, cz;
+  int     job;
+  int     channels;
   ChunkCache &cache;
 };
 
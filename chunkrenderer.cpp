@@ -3,7 +3,7 @@
 #include "chunk.h"
 #include "chunkrenderer.h"
 #include "chunkcache.h"
-#include "mapview.h"
+#include "renderflags.h"
 #include "identifier/blockidentifier.h"
 #include "identifier/biomeidentifier.h"
 #include "clamp.h"
@@ -26,6 +26,15 @@ const std::vector<double> precomputed_light_factors = [] {
     return table;
 }();
 
+int ChunkRenderer::decodeChannels(int flags) {
+  // Biomes tint grass, foliage and water in every mode,
+  // Block light is only shown with lighting or mob spawn detection
+  int channels = Chunk::DECODE_BIOMES;
+  if (flags & (RenderFlags::flgLighting | RenderFlags::flgMobSpawn))
+    channels |= Chunk::DECODE_BLOCKLIGHT;
+  return channels;
+}
+
 void ChunkRenderer::run() {
   // get existing Chunk entry from Cache
   QSharedPointer<Chunk> chunk(cache.fetchCached(cx, cz));
@@ -47,13 +56,13 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
   // adapt y loop start/stop value to render depth and available data in Chunk
   int startY = std::min(chunk->highest, this->depth);
   int stopY  = chunk->lowest;
-  if (this->flags & MapView::flgSingleLayer) {
+  if (this->flags & RenderFlags::flgSingleLayer) {
     startY = this->depth;
     stopY  = this->depth;
   }
 
   bool isSlimeChunk = false;
-  if (this->flags & MapView::flgSlimeChunks) {
+  if (this->flags & RenderFlags::flgSlimeChunks) {
     long long seed =
         ( WorldInfo::Instance().getSeed() +
           (int) (cx * cx * 0x4c1906) +
@@ -65,14 +74,14 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
   }
 
   float regionalDifficulty = 0.0;
-  if (this->flags & MapView::flgInhabitedTime) {
+  if (this->flags & RenderFlags::flgInhabitedTime) {
     // regional difficulty is max-capped at 3600000 ticks
     long long inhabitedTime = std::min<long long>(chunk->inhabitedTime, 3600000);
     regionalDifficulty = 6.0 * static_cast<double>(inhabitedTime) / 3600000.0;
   }
 
   // flag to enable skipping all rendering stuff when transparent block is detected
-  bool doFastTransparentSkip = !((this->flags & MapView::flgBiomeColors) && (this->flags & MapView::flgSingleLayer));
+  bool doFastTransparentSkip = !((this->flags & RenderFlags::flgBiomeColors) && (this->flags & RenderFlags::flgSingleLayer));
 
   // render loop
   for (int z = 0; z < 16; z++) {  // n->s
@@ -97,7 +106,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
         const BlockInfo &block = BlockIdentifier::Instance().getBlockInfo(section->getPaletteEntry(offset, y).hid);
         if ((block.alpha == 0.0) && doFastTransparentSkip) continue;
 
-        if (this->flags & MapView::flgSeaGround && block.isLiquid()) continue;
+        if (this->flags & RenderFlags::flgSeaGround && block.isLiquid()) continue;
 
         // get light value from one block above
         int light;
@@ -107,7 +116,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
         else // just as fallback
           light = std::max(0, section->getBlockLight(offset, y)-1);
         int light1 = light;
-        if (!(this->flags & MapView::flgLighting))
+        if (!(this->flags & RenderFlags::flgLighting))
           light = 13;
         // y gradient detection / edge highlight
         if ((alpha == 0.0) && (lasty != -9999)) {
@@ -141,7 +150,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
         quint32 colg = std::clamp( int(light_factor*blockcolor.green()), 0, 255 );
         quint32 colb = std::clamp( int(light_factor*blockcolor.blue()),  0, 255 );
 
-        if (this->flags & MapView::flgDepthShading) {
+        if (this->flags & RenderFlags::flgDepthShading) {
           // Use a table to define depth-relative shade:
           static const quint32 shadeTable[] = {
             0, 12, 18, 22, 24, 26, 28, 29, 30, 31, 32};
@@ -153,7 +162,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
           colb = colb - std::min(shade, colb);
         }
 
-        if (this->flags & MapView::flgMobSpawn) {
+        if (this->flags & RenderFlags::flgMobSpawn) {
           // get block info from 1 and 2 above and 1 below
           uint blid1(0), blid2(0), blidB(0);  // default to legacy air (todo: better handling of block above)
           const ChunkSection *section2 = chunk->getSectionByY(y+2);
@@ -206,7 +215,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
            }
         }
 
-        if (this->flags & MapView::flgBiomeColors) {
+        if (this->flags & RenderFlags::flgBiomeColors) {
           colr = biome.colors[light].red();
           colg = biome.colors[light].green();
           colb = biome.colors[light].blue();
@@ -216,7 +225,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
           colg = (colg + 255) / 2;
         }
 
-        if (this->flags & MapView::flgInhabitedTime) {
+        if (this->flags & RenderFlags::flgInhabitedTime) {
           // first reduce brightness
           colr = colr / 2;
           colg = colg / 2;
@@ -277,7 +286,7 @@ void ChunkRenderer::renderChunk(QSharedPointer<Chunk> chunk) {
       } // top -> down
 
       // finished to find color for current column, only continue for cave mode
-      if (this->flags & MapView::flgCaveMode) {
+      if (this->flags & RenderFlags::flgCaveMode) {
         float cave_factor = 1.0;
         int cave_test = 0;
         for (int y=highest-1; (y >= stopY) && (cave_test < CaveShade::CAVE_DEPTH); y--, cave_test++) {  // top->down
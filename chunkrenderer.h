@@ -19,6 +19,9 @@ class ChunkRenderer : public QObject, public QRunnable {
  public:  // public to allow usage from WorldSave
   void renderChunk(QSharedPointer<Chunk> chunk);
 
+  // Chunk::DECODE_CHANNELS read when rendering with these flags
+  static int decodeChannels(int flags);
+
  signals:
   void rendered(int cx, int cz);
 
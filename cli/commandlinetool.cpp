@@ -0,0 +1,541 @@
+#include <QAtomicInt>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFuture>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#include "cli/commandlinetool.h"
+#include "activitymap.h"
+#include "blockhistogram.h"
+#include "blockindex.h"
+#include "chunk.h"
+#include "chunkloader.h"
+#include "identifier/blockidentifier.h"
+#include "identifier/definitionloader.h"
+#include "imageencoder.h"
+#include "regionfile.h"
+#include "renderflags.h"
+#include "tileexport.h"
+#include "worldinfo.h"
+#include "worldsave.h"
+
+
+// run an export job on the global pool, progress is written to stderr
+template<class JobT>
+static void runJob(JobT *job) {
+  QAtomicInt lastPercent(-1);
+  QObject::connect(job, &JobT::progress, job,
+                   [&lastPercent](QString status, double value) {
+    const int percent = static_cast<int>(value * 100);
+    if (lastPercent.fetchAndStoreRelaxed(percent) != percent)
+      fprintf(stderr, "\r%s: %3d%%", qPrintable(status), percent);
+  }, Qt::DirectConnection);
+  job->setAutoDelete(false);
+  QThreadPool::globalInstance()->start(job);
+  QThreadPool::globalInstance()->waitForDone();
+  fprintf(stderr, "\n");
+  delete job;
+}
+
+
+CommandLineTool::CommandLineTool()
+  : top(0), left(0), bottom(0), right(0)
+  , hasBounds(false)
+{}
+
+int CommandLineTool::run(const QStringList &arguments) {
+  parser.setApplicationDescription("Minutor command line tool: render, search and "
+                                   "analyze Minecraft worlds without a display.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument("command", "export, merge, search, stats, index or activity");
+  addCommonOptions();
+
+  // first pass only to find the command, its options are added afterwards
+  parser.parse(arguments);
+  const QString command = parser.positionalArguments().value(0);
+  parser.clearPositionalArguments();
+  parser.addPositionalArgument(command.isEmpty() ? "command" : command, "", command);
+
+  if (command == "export") {
+    parser.addPositionalArgument("world", "world folder");
+    parser.addPositionalArgument("output", "image file (.png, .qoi or .raw)");
+    parser.addOptions({
+      {"depth", "Y level to render from (default: dimension specific)", "y"},
+      {"flags", "comma separated view flags, e.g. lighting,cavemode", "list"},
+      {"scale", "Blocks per pixel, power of two up to 64", "n", "1"},
+      {"compression", "PNG deflate level, 0 = store only", "level", "6"},
+      {"filter", "PNG row filter: none, sub, up, average, paeth, adaptive", "mode", "none"},
+      {"layer", "additional image from the same pass: file:depth:flags", "spec"},
+      {"tiles", "write a web tile pyramid into this folder instead", "folder"},
+      {"shard", "render only part i of n into a segment, see merge", "i/n"},
+      {"regionchecker", "checkerboard pattern on Regions"},
+      {"chunkchecker", "checkerboard pattern on Chunks"},
+    });
+  } else if (command == "merge") {
+    parser.addPositionalArgument("output", "image file the shards were exported for");
+    parser.addOption({"shards", "number of shards", "n"});
+  } else if (command == "search") {
+    parser.addPositionalArgument("world", "world folder");
+    parser.addOptions({
+      {"block", "comma separated block names, e.g. minecraft:diamond_ore", "names"},
+      {"entity", "comma separated entity names, e.g. villager", "names"},
+      {"ymin", "lowest Y level to search", "y"},
+      {"ymax", "highest Y level to search", "y"},
+      {"limit", "stop after this many results", "n", "0"},
+    });
+  } else if (command == "stats") {
+    parser.addPositionalArgument("world", "world folder");
+    parser.addOptions({
+      {"ymin", "lowest Y level to count", "y"},
+      {"ymax", "highest Y level to count", "y"},
+      {"format", "total: count per block, csv/json: count per block and Y level",
+       "format", "total"},
+    });
+  } else if (command == "index") {
+    parser.addPositionalArgument("world", "world folder");
+  } else if (command == "activity") {
+    parser.addPositionalArgument("world", "world folder");
+    parser.addOptions({
+      {"max-inhabited", "list Chunks inhabited at most this many ticks", "ticks", "1200"},
+      {"regions", "list only Regions where all Chunks are below the limit"},
+    });
+  }
+  parser.process(arguments);
+
+  if (command.isEmpty())
+    parser.showHelp(1);
+
+  if (parser.isSet("threads")) {
+    const int threads = parser.value("threads").toInt();
+    if (threads < 1)
+      return error("invalid thread count");
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+  }
+
+  // merging needs no world and no definitions
+  if (command == "merge")
+    return merge();
+
+  if (DefinitionLoader::loadInstalled() == 0)
+    return error("no definitions found");
+
+  const QStringList positional = parser.positionalArguments();
+  if (positional.size() < 2)
+    parser.showHelp(1);
+  if (!openWorld(positional[1]))
+    return 1;
+
+  if (command == "export")
+    return exportWorld();
+  if (command == "search")
+    return search();
+  if (command == "stats")
+    return statistics();
+  if (command == "index")
+    return buildIndex();
+  if (command == "activity")
+    return activity();
+  return error("unknown command: " + command);
+}
+
+void CommandLineTool::addCommonOptions() {
+  parser.addOptions({
+    {"threads", "number of worker threads", "n"},
+    {"dimension", "dimension to use, e.g. the_nether (default: overworld)", "name"},
+    {"bounds", "area in Block coordinates: top(Z),left(X),bottom(Z),right(X)", "area"},
+  });
+}
+
+int CommandLineTool::error(const QString &message) const {
+  fprintf(stderr, "minutor-cli: %s\n", qPrintable(message));
+  return 1;
+}
+
+
+bool CommandLineTool::openWorld(const QString &folder) {
+  QDir dir(folder);
+  WorldInfo &wi(WorldInfo::Instance());
+  if (!wi.parseWorldFolder(dir)) {
+    error("not a Minecraft world: " + folder);
+    return false;
+  }
+  wi.parseWorldInfo();
+
+  QString name = parser.isSet("dimension") ? parser.value("dimension") : "overworld";
+  if (!findDimension(name)) {
+    error("dimension not found: " + name);
+    return false;
+  }
+  worldPath = dir.absoluteFilePath(dimension.path);
+
+  if (parser.isSet("bounds")) {
+    QStringList values = parser.value("bounds").split(",");
+    if (values.size() != 4) {
+      error("bounds need four values: top,left,bottom,right");
+      return false;
+    }
+    // convert from Blocks to Chunks
+    top    = values[0].toInt() >> 4;
+    left   = values[1].toInt() >> 4;
+    bottom = values[2].toInt() >> 4;
+    right  = values[3].toInt() >> 4;
+    hasBounds = true;
+  } else if (!regionsInBounds().isEmpty()) {
+    WorldSave::findWorldBounds(worldPath, &top, &left, &bottom, &right);
+  }
+  return true;
+}
+
+// like the Dimension menu: first definition with matching id or name
+// and existing region folder, then the custom dimensions of the world
+bool CommandLineTool::findDimension(const QString &name) {
+  QString id = name;
+  if (!id.contains(":"))
+    id.insert(0, "minecraft:");
+
+  const QDir world(WorldInfo::Instance().getFolder());
+  for (int index = 0; ; index++) {
+    const DimensionInfo &dim = DimensionIdentifier::Instance().getDimensionInfo(index);
+    if (dim.name == "Dummy Dimension")
+      break;
+    if (!dim.enabled || dim.pathIsRegEx)
+      continue;
+    if ((dim.id == id || dim.name.trimmed() == name) && world.exists(dim.path + "/region")) {
+      dimension = dim;
+      return true;
+    }
+  }
+  for (auto &dim : WorldInfo::Instance().getDimensions()) {
+    if (dim.name == name || dim.id == id) {
+      dimension = dim;
+      return true;
+    }
+  }
+  return false;
+}
+
+// same defaults as the depth slider of the GUI
+int CommandLineTool::defaultDepth() const {
+  if (WorldInfo::Instance().getDataVersion() < 2800) {
+    // legacy versions before Cliffs & Caves (up to 1.17)
+    if (dimension.id == "minecraft:overworld")
+      return 127;
+    if (dimension.id == "minecraft:the_nether")
+      return 95;
+    return 255;
+  }
+  return dimension.defaultY;
+}
+
+
+int CommandLineTool::exportWorld() {
+  const QStringList positional = parser.positionalArguments();
+  const int depth = parser.isSet("depth") ? parser.value("depth").toInt() : defaultDepth();
+  const int flags = RenderFlags::fromString(parser.value("flags"));
+
+  if (parser.isSet("tiles")) {
+    runJob(new TileExport(parser.value("tiles"), worldPath, depth, flags));
+    return 0;
+  }
+
+  QList<WorldSave::Layer> layers;
+  if (positional.size() > 2)
+    layers.append(WorldSave::Layer(positional[2], depth, flags));
+  for (const QString &spec : parser.values("layer")) {
+    // split from the right, filenames may contain ':'
+    const int p2 = spec.lastIndexOf(':');
+    const int p1 = (p2 > 0) ? spec.lastIndexOf(':', p2 - 1) : -1;
+    if (p1 <= 0)
+      return error("invalid layer: " + spec);
+    layers.append(WorldSave::Layer(spec.left(p1), spec.mid(p1 + 1, p2 - p1 - 1).toInt(),
+                                   RenderFlags::fromString(spec.mid(p2 + 1))));
+  }
+  if (layers.isEmpty())
+    return error("no output file given");
+
+  int shardIndex = 0;
+  int shardCount = 1;
+  if (parser.isSet("shard")) {
+    const QStringList shard = parser.value("shard").split("/");
+    shardIndex = shard.value(0).toInt() - 1;
+    shardCount = shard.value(1).toInt();
+    if ((shard.size() != 2) || (shardIndex < 0) || (shardIndex >= shardCount))
+      return error("invalid shard, expected i/n with 1 <= i <= n");
+  }
+
+  ImageEncoder::Options encoding(qBound(0, parser.value("compression").toInt(), 9),
+                                 ImageEncoder::filterFromName(parser.value("filter")));
+  // WorldSave expects Blocks, all zero means complete world
+  WorldSave *save = new WorldSave(layers, worldPath,
+                                  parser.isSet("regionchecker"), parser.isSet("chunkchecker"),
+                                  hasBounds ? top * 16 : 0, hasBounds ? left * 16 : 0,
+                                  hasBounds ? bottom * 16 + 15 : 0,
+                                  hasBounds ? right * 16 + 15 : 0,
+                                  parser.value("scale").toInt(), encoding);
+  save->setShard(shardIndex, shardCount);
+  runJob(save);
+  return 0;
+}
+
+int CommandLineTool::merge() {
+  const QStringList positional = parser.positionalArguments();
+  const int shards = parser.value("shards").toInt();
+  if ((positional.size() < 2) || (shards < 1))
+    parser.showHelp(1);
+  QString message;
+  if (!WorldSave::mergeShards(positional[1], shards, &message))
+    return error(message);
+  return 0;
+}
+
+
+int CommandLineTool::search() {
+  QStringList blocks;
+  for (QString name : parser.value("block").split(",", Qt::SkipEmptyParts)) {
+    if (!name.contains(":"))
+      name.insert(0, "minecraft:");
+    blocks << name.trimmed();
+  }
+  const QStringList entities = parser.value("entity").split(",", Qt::SkipEmptyParts);
+  if (blocks.isEmpty() && entities.isEmpty())
+    return error("nothing to search for, use --block or --entity");
+
+  const int ymin  = parser.isSet("ymin") ? parser.value("ymin").toInt() : -2048;
+  const int ymax  = parser.isSet("ymax") ? parser.value("ymax").toInt() :  2047;
+  const int limit = parser.value("limit").toInt();
+  QAtomicInt found(0);
+
+  QMutex outputMutex;
+  QTextStream out(stdout);
+  out << "x,y,z,name\n";
+
+  const int parts = (blocks.isEmpty()   ? 0 : ChunkLoader::PART_BLOCKS) |
+                    (entities.isEmpty() ? 0 : ChunkLoader::PART_ENTITIES);
+  forEachChunk(parts, [&](const QSharedPointer<Chunk> &chunk) {
+    if ((limit > 0) && (found.loadAcquire() >= limit))
+      return;
+    QStringList lines;
+
+    // Entities by (partial) name
+    for (const auto &entity : chunk->getEntityMap()) {
+      for (const QString &name : entities) {
+        if (entity->display().contains(name.trimmed(), Qt::CaseInsensitive)) {
+          const OverlayItem::Point p = entity->midpoint();
+          lines << QString("%1,%2,%3,%4").arg(p.x).arg(p.y).arg(p.z).arg(entity->display());
+          break;
+        }
+      }
+    }
+
+    // Blocks by exact name
+    if (!blocks.isEmpty()) {
+      const int y1 = std::max(ymin, chunk->getLowest());
+      const int y2 = std::min(ymax, chunk->getHighest());
+      for (int sy = (y1 >> 4); sy <= (y2 >> 4); sy++) {
+        const ChunkSection *section = chunk->getSectionByIdx(sy);
+        if (!section)
+          continue;
+        // test the palette first, most sections contain none of the blocks
+        QVector<bool> match(section->blockPaletteLength, false);
+        bool any = false;
+        for (int i = 0; i < section->blockPaletteLength; i++) {
+          match[i] = blocks.contains(section->blockPalette[i].name);
+          any |= match[i];
+        }
+        if (!any)
+          continue;
+        for (int y = std::max(y1, sy * 16); y <= std::min(y2, sy * 16 + 15); y++) {
+          for (int offset = 0; offset < 256; offset++) {
+            const int index = section->blocks[offset + ((y & 0x0f) << 8)];
+            if ((index < match.size()) && match[index]) {
+              lines << QString("%1,%2,%3,%4")
+                       .arg(chunk->getChunkX() * 16 + (offset & 0x0f)).arg(y)
+                       .arg(chunk->getChunkZ() * 16 + (offset >> 4))
+                       .arg(section->blockPalette[index].name);
+            }
+          }
+        }
+      }
+    }
+
+    if (!lines.isEmpty()) {
+      QMutexLocker guard(&outputMutex);
+      for (const QString &line : lines) {
+        if ((limit > 0) && (found.fetchAndAddRelaxed(1) >= limit))
+          break;
+        out << line << "\n";
+      }
+      out.flush();
+    }
+  });
+  return 0;
+}
+
+
+int CommandLineTool::buildIndex() {
+  const QList<QPoint> regions = regionsInBounds();
+  QAtomicInt done(0);
+  QAtomicInt failed(0);
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+  QList<QFuture<void>> tasks;
+  for (const QPoint &region : regions) {
+    tasks.append(QtConcurrent::run(&pool, [&, region]() {
+      RegionFile file(RegionFile::filename(worldPath, "region", region.x(), region.y()));
+      BlockIndex index(worldPath, region.x(), region.y());
+      index.load();
+      QVector<ChunkID> chunks;
+      for (int cz = region.y() * 32; cz < (region.y() + 1) * 32; cz++)
+        for (int cx = region.x() * 32; cx < (region.x() + 1) * 32; cx++)
+          chunks.append(ChunkID(cx, cz));
+      index.update(file, chunks);
+      if (index.isModified() && !index.save())
+        failed.ref();
+      fprintf(stderr, "\rindexing regions: %d/%d",
+              done.fetchAndAddRelaxed(1) + 1, static_cast<int>(regions.size()));
+    }));
+  }
+  for (auto &task : tasks)
+    task.waitForFinished();
+  fprintf(stderr, "\n");
+
+  if (failed.loadAcquire() > 0)
+    return error(QString("could not write index of %1 regions").arg(failed.loadAcquire()));
+  return 0;
+}
+
+// trim candidates from InhabitedTime, without decoding any Chunk
+int CommandLineTool::activity() {
+  bool ok;
+  const qint64 maxInhabited = parser.value("max-inhabited").toLongLong(&ok);
+  if (!ok || (maxInhabited < 0))
+    return error("invalid tick count: " + parser.value("max-inhabited"));
+
+  ActivityMap map(worldPath);
+  map.scan([](int done, int total) {
+    fprintf(stderr, "\rscanning regions: %d/%d", done, total);
+  });
+  fprintf(stderr, "\n");
+
+  QFile out;
+  out.open(stdout, QIODevice::WriteOnly);
+  return map.writeCsv(&out, maxInhabited, parser.isSet("regions")) ? 0 : 1;
+}
+
+int CommandLineTool::statistics() {
+  const int ymin = parser.isSet("ymin") ? parser.value("ymin").toInt() : dimension.minY;
+  const int ymax = parser.isSet("ymax") ? parser.value("ymax").toInt() : dimension.maxY;
+  const QString format = parser.value("format");
+  if ((format != "total") && (format != "csv") && (format != "json"))
+    return error("unknown format: " + format);
+
+  // one histogram per worker thread, merged at the end
+  QMutex partialsMutex;
+  QHash<QThread*, QSharedPointer<BlockHistogram>> partials;
+
+  forEachChunk(ChunkLoader::PART_BLOCKS, [&](const QSharedPointer<Chunk> &chunk) {
+    QSharedPointer<BlockHistogram> partial;
+    {
+      QMutexLocker guard(&partialsMutex);
+      partial = partials.value(QThread::currentThread());
+      if (!partial) {
+        partial = QSharedPointer<BlockHistogram>::create(ymin, ymax);
+        partials.insert(QThread::currentThread(), partial);
+      }
+    }
+    partial->addChunk(*chunk);
+  });
+
+  BlockHistogram histogram(ymin, ymax);
+  for (const auto &partial : partials)
+    histogram.merge(*partial);
+
+  QFile out;
+  out.open(stdout, QIODevice::WriteOnly);
+  if (format == "csv")
+    return histogram.writeCsv(&out) ? 0 : 1;
+  if (format == "json")
+    return histogram.writeJson(&out) ? 0 : 1;
+
+  // total count per block name, most frequent first
+  QHash<QString, qint64> total;
+  for (quint32 hid : histogram.getBlockIds())
+    total[BlockIdentifier::Instance().getBlockInfo(hid).getName()] += histogram.count(hid);
+
+  QList<QPair<qint64, QString>> sorted;
+  for (auto it = total.constBegin(); it != total.constEnd(); ++it)
+    sorted.append(qMakePair(it.value(), it.key()));
+  std::sort(sorted.begin(), sorted.end(), std::greater<QPair<qint64, QString>>());
+
+  QTextStream stream(&out);
+  stream << "name,count\n";
+  for (auto &entry : sorted)
+    stream << entry.second << "," << entry.first << "\n";
+  return 0;
+}
+
+
+// all Regions with data that intersect the bounds
+QList<QPoint> CommandLineTool::regionsInBounds() const {
+  QList<QPoint> regions;
+  QDirIterator it(worldPath + "/region", QStringList() << "*.mca");
+  while (it.hasNext()) {
+    it.next();
+    // -> split filename into parts, we expect 4 of them: "r" "X" "Z" "mca"
+    QStringList nameParts = it.fileName().split(".");
+    if ((nameParts.length() != 4) || (it.fileInfo().size() == 0))
+      continue;
+    const int rx = nameParts[1].toInt();
+    const int rz = nameParts[2].toInt();
+    if (hasBounds && ((rx < (left >> 5)) || (rx > (right >> 5)) ||
+                      (rz < (top >> 5))  || (rz > (bottom >> 5))))
+      continue;
+    regions.append(QPoint(rx, rz));
+  }
+  return regions;
+}
+
+void CommandLineTool::forEachChunk(int parts, const ChunkFunction &fn) {
+  const QList<QPoint> regions = regionsInBounds();
+  QAtomicInt done(0);
+
+  // one task per Region, all Chunks of a Region are in the same file
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+  QList<QFuture<void>> tasks;
+  for (const QPoint &region : regions) {
+    tasks.append(QtConcurrent::run(&pool, [&, region]() {
+      RegionFile blocks(RegionFile::filename(worldPath, "region", region.x(), region.y()));
+      RegionFile entities(RegionFile::filename(worldPath, "entities", region.x(), region.y()));
+      for (int cz = region.y() * 32; cz < (region.y() + 1) * 32; cz++) {
+        for (int cx = region.x() * 32; cx < (region.x() + 1) * 32; cx++) {
+          if (hasBounds && ((cx < left) || (cx > right) || (cz < top) || (cz > bottom)))
+            continue;
+          // temporary Chunk, it is never cached
+          QSharedPointer<Chunk> chunk(new Chunk());
+          const bool ok = (parts & ChunkLoader::PART_BLOCKS)
+              ? ChunkLoader::loadNbt(blocks, entities, cx, cz, chunk, (parts & ChunkLoader::PART_ENTITIES),
+                                     ChunkLoader::decodeChannels(parts))
+              : ChunkLoader::loadEntitiesOnly(blocks, entities, cx, cz, chunk);
+          if (ok)
+            fn(chunk);
+        }
+      }
+      fprintf(stderr, "\rscanning regions: %d/%d",
+              done.fetchAndAddRelaxed(1) + 1, static_cast<int>(regions.size()));
+    }));
+  }
+  for (auto &task : tasks)
+    task.waitForFinished();
+  fprintf(stderr, "\n");
+}
@@ -0,0 +1,61 @@
+#ifndef COMMANDLINETOOL_H_
+#define COMMANDLINETOOL_H_
+
+#include <QCommandLineParser>
+#include <QList>
+#include <QPoint>
+#include <QSharedPointer>
+#include <QString>
+#include <functional>
+
+#include "identifier/dimensionidentifier.h"
+
+class Chunk;
+
+/*
+ minutor-cli: headless access to the core library.
+
+   minutor-cli [--threads <n>] export <world> <output> [options] [--shard <i/n>]
+   minutor-cli merge <output> --shards <n>
+   minutor-cli [--threads <n>] search <world> --block <names> | --entity <ids>
+   minutor-cli [--threads <n>] stats  <world> [--ymin <y>] [--ymax <y>] [--format <f>]
+   minutor-cli [--threads <n>] index  <world>
+   minutor-cli [--threads <n>] activity <world> [--max-inhabited <ticks>] [--regions]
+
+ Results of search, stats and activity are written as CSV to stdout,
+ progress and errors go to stderr.
+ */
+class CommandLineTool {
+ public:
+  CommandLineTool();
+
+  int run(const QStringList &arguments);
+
+ private:
+  int exportWorld();
+  int merge();
+  int search();
+  int statistics();
+  int buildIndex();
+  int activity();
+
+  void addCommonOptions();
+  bool openWorld(const QString &folder);
+  bool findDimension(const QString &name);
+  int  defaultDepth() const;
+
+  // call fn for every existing Chunk inside the bounds, in parallel per Region
+  typedef std::function<void(const QSharedPointer<Chunk> &chunk)> ChunkFunction;
+  void forEachChunk(int parts, const ChunkFunction &fn);  // parts: ChunkLoader::CHUNK_PARTS
+  QList<QPoint> regionsInBounds() const;
+
+  int  error(const QString &message) const;
+
+  QCommandLineParser parser;
+  QString       worldPath;  // folder of the selected dimension
+  DimensionInfo dimension;
+  int top, left, bottom, right;  // bounds in Chunks
+  bool hasBounds;
+};
+
+#endif  // COMMANDLINETOOL_H_
@@ -0,0 +1,16 @@
+#include <QCoreApplication>
+
+#include "cli/commandlinetool.h"
+
+int main(int argc, char *argv[]) {
+  // headless: rendering uses QImage and QPainter on QImage only,
+  // no platform plugin or display is needed
+  QCoreApplication app(argc, argv);
+
+  // same names as the GUI, so installed definitions are found
+  app.setApplicationName("Minutor");
+  app.setApplicationVersion("26.1");
+  app.setOrganizationName("seancode");
+
+  return CommandLineTool().run(app.arguments());
+}
@@ -0,0 +1,20 @@
+TEMPLATE = app
+TARGET = minutor-cli
+CONFIG += c++14 console
+CONFIG -= app_bundle
+QT = core gui concurrent
+greaterThan(QT_MAJOR_VERSION, 5) QT += core5compat
+
+# Input
+HEADERS += \
+    commandlinetool.h
+SOURCES += \
+    commandlinetool.cpp \
+    main.cpp
+# built-in definitions
+RESOURCES = ../minutor.qrc
+
+include(../minutor-core.pri)
+
+target.path = /usr/bin
+INSTALLS += target
@@ -0,0 +1,41 @@
+#ifndef DIMENSIONMENU_H
+#define DIMENSIONMENU_H
+
+#include <QObject>
+#include <QDir>
+#include <QList>
+
+#include "identifier/dimensionidentifier.h"
+
+class QAction;
+class QActionGroup;
+class QMenu;
+
+
+// Dimension view menu, filled with all Dimensions found in the current world
+class DimensionMenu : public QObject
+{
+  Q_OBJECT
+
+ public:
+  explicit DimensionMenu(QObject *parent = NULL);
+  ~DimensionMenu();
+
+  void clearDimensionsMenu(QMenu *menu);
+  void getDimensionsInWorld(QDir path, QMenu *menu, QObject *parent);
+
+ signals:
+  void dimensionChanged(const DimensionInfo &dim);    // dimension changed in menu
+
+ private slots:
+  void changeViewToDimension();                       // dimension changed in menu
+
+ private:
+  void addDimensionToMenu(QDir path, QString dir, QString name, QObject *parent);
+
+  QList<QAction *> currentMenuActions;
+  QActionGroup *   menuActionGroup;
+  QList<QString>   foundDimensionDirs;  // all directories where we already found a Dimension
+};
+
+#endif // DIMENSIONMENU_H
@@ -1,7 +1,6 @@
 /** Copyright (c) 2013, Sean Kasun */
 
 #include <QDebug>
-#include <QtWidgets/QMessageBox>
 #include <assert.h>
 #include <cmath>
 
@@ -297,10 +296,8 @@ void BlockIdentifier::parseDefinition(QJsonObject b, BlockInfo *parent,
   if (blocks.contains(hid)) {
     // this will only trigger during development of vanilla_blocks.json
     // and prevents generating a wrong definition file
-    QMessageBox::warning((QWidget*)(NULL),
-                         "Error loading Block definition: " + name,
-                         "Failed to add Block from definition file, as it might be a duplicate\nor generates the same hash as an already existing Block." ,
-                         QMessageBox::Cancel, QMessageBox::Cancel);
+    qWarning() << "Error loading Block definition:" << name
+               << "- it might be a duplicate or generates the same hash as an already existing Block";
   }
   blocks.insert(hid, block);
   packs[pack].append(block);
@@ -0,0 +1,133 @@
+#include <QDirIterator>
+#include <QFile>
+#include <QSettings>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include "definitionloader.h"
+#include "biomeidentifier.h"
+#include "blockidentifier.h"
+#include "dimensionidentifier.h"
+#include "entityidentifier.h"
+#include "flatteningconverter.h"
+#include "zipreader.h"
+
+
+bool DefinitionLoader::load(const QString &path, Definition *def_out) {
+  // determine if we're loading a single json or a pack
+  if (path.endsWith(".json", Qt::CaseInsensitive)) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QJsonDocument json_doc = QJsonDocument::fromJson(f.readAll());
+    f.close();
+    if (json_doc.isNull()) {
+      return false;
+    }
+    QJsonObject def = json_doc.object();
+    Definition d;
+    d.name = def.value("name").toString();
+    d.version = def.value("version").toString();
+    d.path = path;
+    d.update = def.value("update").toString();
+    QString type = def.value("type").toString();
+    d.enabled = true;  // should look this up
+    if (type == "block") {
+      d.id = FlatteningConverter::Instance().addDefinitions(
+          def.value("data").toArray());
+      d.type = Definition::Converter;
+    } else if (type == "flatblock") {
+      d.id = BlockIdentifier::Instance().addDefinitions(
+          def.value("data").toArray());
+      d.type = Definition::Block;
+    } else if (type == "biome") {
+      d.id = BiomeIdentifier::Instance().addDefinitions(
+            def.value("data").toArray(),
+            def.value("data18").toArray());
+      d.type = Definition::Biome;
+    } else if (type == "dimension") {
+      d.id = DimensionIdentifier::Instance().addDefinitions(
+          def.value("data").toArray());
+      d.type = Definition::Dimension;
+    } else if (type == "entity") {
+      d.id = EntityIdentifier::Instance().addDefinitions(
+          def.value("data").toArray());
+      d.type = Definition::Entity;
+    } else {
+      return false; // unknown type
+    }
+    *def_out = d;
+  } else {
+    ZipReader zip(path);
+    if (!zip.open())
+      return false;
+    QJsonDocument json_doc = QJsonDocument::fromJson(zip.get("pack_info.json"));
+    if (json_doc.isNull()) {
+      zip.close();
+      return false;
+    }
+    QJsonObject info = json_doc.object();
+    Definition d;
+    d.name = info.value("name").toString();
+    d.version = info.value("version").toString();
+    d.update = info.value("update").toString();
+    d.path = path;
+    d.enabled = true;
+    d.id = 0;
+    d.type = Definition::Pack;
+    d.blockid = -1;
+    d.biomeid = -1;
+    d.dimensionid = -1;
+    d.entityid = -1;
+    for (int i = 0; i < info.value("data").toArray().size(); i++) {
+      QJsonDocument json_doc = QJsonDocument::fromJson(zip.get(info.value("data").toArray().at(i).toString()));
+      if (json_doc.isNull()) {
+        continue;
+      }
+      QJsonObject def = json_doc.object();
+      QString type = def.value("type").toString();
+      if (type == "block") {
+//        d.blockid = flatteningConverter->addDefinitions(
+//            def.value("data").toArray(), d.blockid);
+      } else if (type == "flatblock") {
+          d.blockid = BlockIdentifier::Instance().addDefinitions(
+              def.value("data").toArray(), d.blockid);
+      } else if (type == "biome") {
+        d.biomeid = BiomeIdentifier::Instance().addDefinitions(
+              def.value("data").toArray(),
+              def.value("data18").toArray(), d.biomeid);
+      } else if (type == "dimension") {
+        d.dimensionid = DimensionIdentifier::Instance().addDefinitions(
+            def.value("data").toArray(), d.dimensionid);
+      } else if (type == "entity") {
+        d.entityid = EntityIdentifier::Instance().addDefinitions(
+            def.value("data").toArray(), d.entityid);
+      }
+    }
+    *def_out = d;
+    zip.close();
+  }
+  return true;
+}
+
+int DefinitionLoader::loadInstalled() {
+  // we load the definitions in backwards order for priority
+  QSettings settings;
+  QStringList packs = settings.value("packs").toStringList();
+  int count = 0;
+  for (int i = packs.length() - 1; i >= 0; i--) {
+    Definition d;
+    if (load(packs[i], &d))
+      count++;
+  }
+
+  // nothing installed yet (Minutor was never started on this machine)
+  if (count == 0) {
+    QDirIterator build_in(":/definitions", QDir::Files | QDir::Readable);
+    while (build_in.hasNext()) {
+      Definition d;
+      if (load(build_in.next(), &d))
+        count++;
+    }
+  }
+  return count;
+}
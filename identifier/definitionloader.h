@@ -0,0 +1,30 @@
+#ifndef DEFINITIONLOADER_H_
+#define DEFINITIONLOADER_H_
+
+#include <QString>
+
+struct Definition {
+  QString name;
+  QString version;
+  QString path;
+  QString update;
+  enum {Block, Biome, Dimension, Entity, Pack, Converter} type;
+  int id;
+  bool enabled;
+  // for packs only
+  int blockid, biomeid, dimensionid, entityid;
+};
+
+// Loads definition files into the identifier singletons,
+// without any user interface (see DefinitionManager for that)
+class DefinitionLoader {
+ public:
+  // load a single json definition or a zipped pack
+  static bool load(const QString &path, Definition *def);
+
+  // load all definitions installed by DefinitionManager,
+  // falls back to the built-in definitions when nothing is installed
+  static int loadInstalled();
+};
+
+#endif  // DEFINITIONLOADER_H_
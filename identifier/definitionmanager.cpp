@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <zlib.h>
 #include "definitionmanager.h"
+#include "definitionloader.h"
 #include "biomeidentifier.h"
 #include "blockidentifier.h"
 #include "dimensionidentifier.h"
@@ -448,99 +449,11 @@ QSize DefinitionManager::sizeHint() const {
 }
 
 void DefinitionManager::loadDefinition(QString path) {
-  // determine if we're loading a single json or a pack
-  if (path.endsWith(".json", Qt::CaseInsensitive)) {
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly)) return;
-    QJsonDocument json_doc = QJsonDocument::fromJson(f.readAll());
-    f.close();
-    if (json_doc.isNull()) {
-      return;
-    }
-    QJsonObject def = json_doc.object();
-    Definition d;
-    d.name = def.value("name").toString();
-    d.version = def.value("version").toString();
-    d.path = path;
-    d.update = def.value("update").toString();
-    QString type = def.value("type").toString();
-    d.enabled = true;  // should look this up
-    if (type == "block") {
-      d.id = flatteningConverter.addDefinitions(
-          def.value("data").toArray());
-      d.type = Definition::Converter;
-    } else if (type == "flatblock") {
-      d.id = blockManager.addDefinitions(
-          def.value("data").toArray());
-      d.type = Definition::Block;
-    } else if (type == "biome") {
-      d.id = biomeManager.addDefinitions(
-            def.value("data").toArray(),
-            def.value("data18").toArray());
-      d.type = Definition::Biome;
-    } else if (type == "dimension") {
-      d.id = dimensionManager.addDefinitions(
-          def.value("data").toArray());
-      d.type = Definition::Dimension;
-    } else if (type == "entity") {
-      d.id = entityManager.addDefinitions(
-          def.value("data").toArray());
-      d.type = Definition::Entity;
-    } else {
-      return; // unknown type
-    }
+  Definition d;
+  if (DefinitionLoader::load(path, &d))
     definitions.insert(path, d);
-  } else {
-    ZipReader zip(path);
-    if (!zip.open())
-      return;
-    QJsonDocument json_doc = QJsonDocument::fromJson(zip.get("pack_info.json"));
-    if (json_doc.isNull()) {
-      zip.close();
-      return;
-    }
-    QJsonObject info = json_doc.object();
-    Definition d;
-    d.name = info.value("name").toString();
-    d.version = info.value("version").toString();
-    d.update = info.value("update").toString();
-    d.path = path;
-    d.enabled = true;
-    d.id = 0;
-    d.type = Definition::Pack;
-    d.blockid = -1;
-    d.biomeid = -1;
-    d.dimensionid = -1;
-    d.entityid = -1;
-    for (int i = 0; i < info.value("data").toArray().size(); i++) {
-      QJsonDocument json_doc = QJsonDocument::fromJson(zip.get(info.value("data").toArray().at(i).toString()));
-      if (json_doc.isNull()) {
-        continue;
-      }
-      QJsonObject def = json_doc.object();
-      QString type = def.value("type").toString();
-      if (type == "block") {
-//        d.blockid = flatteningConverter->addDefinitions(
-//            def.value("data").toArray(), d.blockid);
-      } else if (type == "flatblock") {
-          d.blockid = blockManager.addDefinitions(
-              def.value("data").toArray(), d.blockid);
-      } else if (type == "biome") {
-        d.biomeid = biomeManager.addDefinitions(
-              def.value("data").toArray(),
-              def.value("data18").toArray(), d.biomeid);
-      } else if (type == "dimension") {
-        d.dimensionid = dimensionManager.addDefinitions(
-            def.value("data").toArray(), d.dimensionid);
-      } else if (type == "entity") {
-        d.entityid = entityManager.addDefinitions(
-            def.value("data").toArray(), d.entityid);
-      }
-    }
-    definitions.insert(path, d);
-    zip.close();
-  }
 }
+
 void DefinitionManager::removeDefinition(QString path) {
   // find the definition and remove it from disk
   Definition &def = definitions[path];
@@ -7,6 +7,8 @@
 #include <QStringList>
 #include <QDateTime>
 
+#include "identifier/definitionloader.h"
+
 class QTableWidget;
 class QTableWidgetItem;
 class QCheckBox;
@@ -18,18 +20,6 @@ class FlatteningConverter;
 class MapView;
 class DefinitionUpdater;
 
-struct Definition {
-  QString name;
-  QString version;
-  QString path;
-  QString update;
-  enum {Block, Biome, Dimension, Entity, Pack, Converter} type;
-  int id;
-  bool enabled;
-  // for packs only
-  int blockid, biomeid, dimensionid, entityid;
-};
-
 class DefinitionManager : public QWidget {
   Q_OBJECT
 
@@ -0,0 +1,384 @@
+#include <zlib.h>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <cstdlib>
+#include <cstring>
+
+#include "imageencoder.h"
+
+
+ImageEncoder *ImageEncoder::create(const QString &filename, const Options &options) {
+  const QString suffix = QFileInfo(filename).suffix().toLower();
+  if (suffix == "qoi")
+    return new QoiEncoder();
+  if (suffix == "raw")
+    return new RawEncoder();
+  return new PngEncoder(options);
+}
+
+ImageEncoder::FilterMode ImageEncoder::filterFromName(const QString &name) {
+  const QString n = name.toLower();
+  if (n == "sub")      return FILTER_SUB;
+  if (n == "up")       return FILTER_UP;
+  if (n == "average")  return FILTER_AVERAGE;
+  if (n == "paeth")    return FILTER_PAETH;
+  if (n == "adaptive") return FILTER_ADAPTIVE;
+  return FILTER_NONE;
+}
+
+EncodedBand ImageEncoder::timedEncodeBand(const uchar *rgba, int width, int lines,
+                                          bool last) const {
+  QElapsedTimer timer;
+  timer.start();
+  EncodedBand band = encodeBand(rgba, width, lines, last);
+  nanoSecs.fetchAndAddRelaxed(timer.nsecsElapsed());
+  bytesIn.fetchAndAddRelaxed(qint64(width) * lines * 4);
+  return band;
+}
+
+void ImageEncoder::writeSegment(QFile *file, const EncodedBand &band) {
+  bytesOut += file->write(band.data);
+}
+
+double ImageEncoder::throughput() const {
+  const qint64 ns = nanoSecs.loadAcquire();
+  if (ns <= 0)
+    return 0.0;
+  return (inputBytes() / 1000000.0) / (ns / 1000000000.0);
+}
+
+QString ImageEncoder::statistics() const {
+  return QString("%1: %2 MB -> %3 MB, %4 MB/s")
+      .arg(name())
+      .arg(inputBytes()  / 1000000.0, 0, 'f', 1)
+      .arg(outputBytes() / 1000000.0, 0, 'f', 1)
+      .arg(throughput(), 0, 'f', 1);
+}
+
+
+static inline void write32(char *p, quint32 v) {
+  *p++ = v >> 24;
+  *p++ = (v >> 16) & 0xff;
+  *p++ = (v >> 8) & 0xff;
+  *p++ = v & 0xff;
+}
+
+
+// ------------------------------------------------------------------ PNG
+
+/*
+ Each band is compressed into an independent piece of raw deflate data,
+ ending on a byte boundary (like pigz does).  These pieces are written
+ in order into one zlib stream, the checksums are combined.
+ The first row of a band has no access to the row above it, so only
+ the filters None and Sub are used there.
+ */
+
+static qint64 writeChunk(QFile *f, const char *tag, const char *data,
+                         int len) {
+  char dword[4];
+  write32(dword, len);
+  f->write(dword, 4);
+  f->write(tag, 4);
+  if (len != 0)
+    f->write(data, len);
+  quint32 crc = crc32(0, Z_NULL, 0);
+  crc = crc32(crc, (const Bytef *)tag, 4);
+  if (len != 0)
+    crc = crc32(crc, (const Bytef *)data, len);
+  write32(dword, crc);
+  f->write(dword, 4);
+  return len + 12;
+}
+
+static inline uchar paeth(int a, int b, int c) {
+  const int p  = a + b - c;
+  const int pa = std::abs(p - a);
+  const int pb = std::abs(p - b);
+  const int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  if (pb <= pc) return b;
+  return c;
+}
+
+// apply one filter type, prev may be NULL for None and Sub
+static void applyFilter(int type, uchar *out, const uchar *row, const uchar *prev, int len) {
+  out[0] = type;
+  out++;
+  switch (type) {
+    case 1:  // Sub
+      for (int i = 0; i < len; i++)
+        out[i] = row[i] - ((i >= 4) ? row[i - 4] : 0);
+      break;
+    case 2:  // Up
+      for (int i = 0; i < len; i++)
+        out[i] = row[i] - prev[i];
+      break;
+    case 3:  // Average
+      for (int i = 0; i < len; i++)
+        out[i] = row[i] - ((((i >= 4) ? row[i - 4] : 0) + prev[i]) >> 1);
+      break;
+    case 4:  // Paeth
+      for (int i = 0; i < len; i++)
+        out[i] = row[i] - ((i >= 4) ? paeth(row[i - 4], prev[i], prev[i - 4])
+                                    : paeth(0, prev[i], 0));
+      break;
+    default:  // None
+      memcpy(out, row, len);
+  }
+}
+
+// heuristic from the PNG specification: minimum sum of absolute values
+static quint64 filterCost(const uchar *out, int len) {
+  quint64 sum = 0;
+  for (int i = 1; i <= len; i++)
+    sum += std::abs(static_cast<signed char>(out[i]));
+  return sum;
+}
+
+PngEncoder::PngEncoder(const Options &options)
+  : options(options)
+  , adler(adler32(0, Z_NULL, 0))
+{}
+
+void PngEncoder::filterRow(uchar *out, const uchar *row, const uchar *prev, int len) const {
+  int type = 0;
+  switch (options.filter) {
+    case FILTER_SUB:     type = 1; break;
+    case FILTER_UP:      type = prev ? 2 : 0; break;
+    case FILTER_AVERAGE: type = prev ? 3 : 1; break;
+    case FILTER_PAETH:   type = prev ? 4 : 1; break;
+    case FILTER_ADAPTIVE: {
+      QByteArray candidate(len + 1, 0);
+      uchar *c = reinterpret_cast<uchar *>(candidate.data());
+      quint64 best = ~quint64(0);
+      for (int t = 0; t < (prev ? 5 : 2); t++) {
+        applyFilter(t, c, row, prev, len);
+        const quint64 cost = filterCost(c, len);
+        if (cost < best) {
+          best = cost;
+          type = t;
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  applyFilter(type, out, row, prev, len);
+}
+
+void PngEncoder::begin(QFile *png, int width, int height) {
+  // output PNG signature
+  const char *sig = "\x89PNG\x0d\x0a\x1a\x0a";
+  png->write(sig, 8);
+  // output PNG header
+  const char *ihdrdata =  "\x00\x00\x00\x00"  // width
+                          "\x00\x00\x00\x00"  // height
+                          "\x08"              // bit depth
+                          "\x06"              // color type (rgba)
+                          "\x00"              // compresion method (deflate)
+                          "\x00"              // filter method (standard)
+                          "\x00";             // interlace method (none)
+  char ihdr[13];
+  memcpy(ihdr, ihdrdata, 13);
+  write32(ihdr, width);
+  write32(ihdr + 4, height);
+  bytesOut += 8 + writeChunk(png, "IHDR", ihdr, 13);
+
+  // zlib header: deflate with 32k window, check bits for the FLEVEL field
+  const int flevel = (options.level <= 1) ? 0 : (options.level < 6) ? 1 : (options.level == 6) ? 2 : 3;
+  const int flg = flevel << 6;
+  char zhdr[2] = { 0x78, static_cast<char>(flg + (31 - (0x78 * 256 + flg) % 31) % 31) };
+  bytesOut += writeChunk(png, "IDAT", zhdr, 2);
+  adler = adler32(0, Z_NULL, 0);
+}
+
+EncodedBand PngEncoder::encodeBand(const uchar *rgba, int width, int lines, bool last) const {
+  // filter all rows of this band
+  const int len = width * 4;
+  QByteArray filtered(lines * (len + 1), 0);
+  uchar *out = reinterpret_cast<uchar *>(filtered.data());
+  for (int y = 0; y < lines; y++) {
+    const uchar *row  = rgba + y * len;
+    const uchar *prev = (y > 0) ? row - len : NULL;
+    filterRow(out + y * (len + 1), row, prev, len);
+  }
+
+  EncodedBand band;
+  band.checksum = adler32(adler32(0, Z_NULL, 0), out, filtered.size());
+  band.length   = filtered.size();
+
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  // raw deflate without zlib header, header and trailer are written once
+  deflateInit2(&strm, options.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+  // the last piece terminates the deflate stream,
+  // all others are flushed to a byte boundary to allow concatenation
+  const int mode = last ? Z_FINISH : Z_SYNC_FLUSH;
+  int size = deflateBound(&strm, filtered.size()) + 16;
+  band.data.resize(size);
+  strm.avail_in = filtered.size();
+  strm.next_in = out;
+  strm.avail_out = size;
+  strm.next_out = reinterpret_cast<Bytef *>(band.data.data());
+  while (deflate(&strm, mode) == Z_OK && strm.avail_out == 0) {
+    // should not happen due to deflateBound, but be safe
+    band.data.resize(size * 2);
+    strm.avail_out = size;
+    strm.next_out = reinterpret_cast<Bytef *>(band.data.data()) + size;
+    size *= 2;
+  }
+  band.data.resize(size - strm.avail_out);
+  deflateEnd(&strm);
+
+  return band;
+}
+
+void PngEncoder::writeBand(QFile *png, const EncodedBand &band) {
+  adler = adler32_combine(adler, band.checksum, band.length);
+  bytesOut += writeChunk(png, "IDAT", band.data.constData(), band.data.size());
+}
+
+void PngEncoder::end(QFile *png) {
+  // zlib trailer
+  char trailer[4];
+  write32(trailer, adler);
+  bytesOut += writeChunk(png, "IDAT", trailer, 4);
+  bytesOut += writeChunk(png, "IEND", NULL, 0);
+}
+
+
+// ------------------------------------------------------------------ QOI
+
+/*
+ QOI keeps state (previous pixel, index of recent colors) across the
+ whole image.  To encode bands independently each band starts with a
+ full RGBA pixel and only references index slots it has written itself,
+ the decoder holds the same values in these slots.
+ */
+
+static inline int qoiHash(const uchar *px) {
+  return (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+}
+
+void QoiEncoder::begin(QFile *file, int width, int height) {
+  char header[14] = { 'q', 'o', 'i', 'f' };
+  write32(header + 4, width);
+  write32(header + 8, height);
+  header[12] = 4;  // channels: RGBA
+  header[13] = 0;  // sRGB with linear alpha
+  file->write(header, 14);
+  bytesOut += 14;
+}
+
+EncodedBand QoiEncoder::encodeBand(const uchar *rgba, int width, int lines, bool) const {
+  EncodedBand band;
+  band.checksum = 0;
+  band.length   = qint64(width) * lines * 4;
+  band.data.reserve(band.length / 2);
+
+  quint32 index[64];
+  bool    valid[64] = { false };
+  const uchar *prev = NULL;
+  int run = 0;
+
+  const int pixels = width * lines;
+  for (int i = 0; i < pixels; i++) {
+    const uchar *px = rgba + i * 4;
+    quint32 value;
+    memcpy(&value, px, 4);
+
+    if (prev && memcmp(px, prev, 4) == 0) {
+      run++;
+      if (run == 62) {
+        band.data.append(static_cast<char>(0xc0 | (run - 1)));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      band.data.append(static_cast<char>(0xc0 | (run - 1)));
+      run = 0;
+    }
+
+    const int h = qoiHash(px);
+    if (valid[h] && index[h] == value) {
+      band.data.append(static_cast<char>(h));  // QOI_OP_INDEX
+    } else {
+      index[h] = value;
+      valid[h] = true;
+      if (prev && px[3] == prev[3]) {
+        const signed char vr = px[0] - prev[0];
+        const signed char vg = px[1] - prev[1];
+        const signed char vb = px[2] - prev[2];
+        const signed char vg_r = vr - vg;
+        const signed char vg_b = vb - vg;
+        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+          band.data.append(static_cast<char>(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+        } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+          band.data.append(static_cast<char>(0x80 | (vg + 32)));
+          band.data.append(static_cast<char>((vg_r + 8) << 4 | (vg_b + 8)));
+        } else {
+          band.data.append(static_cast<char>(0xfe));
+          band.data.append(reinterpret_cast<const char *>(px), 3);
+        }
+      } else {
+        band.data.append(static_cast<char>(0xff));
+        band.data.append(reinterpret_cast<const char *>(px), 4);
+      }
+    }
+    prev = px;
+  }
+  // runs must not continue into the next band
+  if (run > 0)
+    band.data.append(static_cast<char>(0xc0 | (run - 1)));
+
+  return band;
+}
+
+void QoiEncoder::writeBand(QFile *file, const EncodedBand &band) {
+  file->write(band.data);
+  bytesOut += band.data.size();
+}
+
+void QoiEncoder::end(QFile *file) {
+  file->write("\0\0\0\0\0\0\0\1", 8);
+  bytesOut += 8;
+}
+
+
+// ------------------------------------------------------------------ raw
+
+/*
+ Header: "MNTRRGBA", width and height as big endian 32 bit values,
+ followed by all rows top to bottom with 4 bytes RGBA per pixel.
+ */
+
+void RawEncoder::begin(QFile *file, int width, int height) {
+  char header[16] = { 'M', 'N', 'T', 'R', 'R', 'G', 'B', 'A' };
+  write32(header + 8, width);
+  write32(header + 12, height);
+  file->write(header, 16);
+  bytesOut += 16;
+}
+
+EncodedBand RawEncoder::encodeBand(const uchar *rgba, int width, int lines, bool) const {
+  EncodedBand band;
+  band.length   = qint64(width) * lines * 4;
+  band.data     = QByteArray(reinterpret_cast<const char *>(rgba), band.length);
+  band.checksum = 0;
+  return band;
+}
+
+void RawEncoder::writeBand(QFile *file, const EncodedBand &band) {
+  file->write(band.data);
+  bytesOut += band.data.size();
+}
+
+void RawEncoder::end(QFile *) {
+}
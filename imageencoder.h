@@ -0,0 +1,118 @@
+#ifndef IMAGEENCODER_H_
+#define IMAGEENCODER_H_
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QString>
+
+class QFile;
+
+// encoded data of one band of scanlines
+struct EncodedBand {
+  QByteArray data;        // encoded bytes, written in band order
+  quint32    checksum;    // encoder specific checksum of the band
+  qint64     length;      // size of data the checksum was calculated on
+};
+
+/*
+ Base class of all image formats WorldSave can write.
+
+ The image is handed over in horizontal bands of RGBA scanlines.
+ encodeBand() is called from several threads in parallel and must
+ not depend on other bands, the results are written in order with
+ writeBand() from one thread.
+ */
+class ImageEncoder {
+ public:
+  enum FilterMode {
+    FILTER_NONE,
+    FILTER_SUB,
+    FILTER_UP,
+    FILTER_AVERAGE,
+    FILTER_PAETH,
+    FILTER_ADAPTIVE   // choose per row by minimum sum of absolute differences
+  };
+
+  struct Options {
+    Options(int level = 6, FilterMode filter = FILTER_NONE)
+      : level(level), filter(filter) {}
+    int        level;   // compression level, 0 = store only
+    FilterMode filter;  // PNG row filter
+  };
+
+  virtual ~ImageEncoder() {}
+
+  // encoder chosen by filename suffix: .png, .qoi or .raw
+  static ImageEncoder *create(const QString &filename, const Options &options);
+  static FilterMode filterFromName(const QString &name);
+
+  virtual QString name() const = 0;
+
+  virtual void       begin(QFile *file, int width, int height) = 0;
+  virtual EncodedBand encodeBand(const uchar *rgba, int width, int lines, bool last) const = 0;
+  virtual void       writeBand(QFile *file, const EncodedBand &band) = 0;
+  virtual void       end(QFile *file) = 0;
+
+  // write band data without any container framing (segments of sharded exports)
+  void writeSegment(QFile *file, const EncodedBand &band);
+
+  // throughput statistics
+  EncodedBand timedEncodeBand(const uchar *rgba, int width, int lines, bool last) const;
+  qint64 inputBytes() const  { return bytesIn.loadAcquire(); }
+  qint64 outputBytes() const { return bytesOut; }
+  double throughput() const;  // MB of raw image data per second of encoding time
+  QString statistics() const;
+
+ protected:
+  qint64 bytesOut = 0;
+
+ private:
+  mutable QAtomicInteger<qint64> bytesIn;
+  mutable QAtomicInteger<qint64> nanoSecs;
+};
+
+
+// PNG with configurable deflate level and row filters
+class PngEncoder : public ImageEncoder {
+ public:
+  explicit PngEncoder(const Options &options);
+
+  QString name() const { return (options.level == 0) ? "PNG (store)" : "PNG"; }
+
+  void        begin(QFile *file, int width, int height);
+  EncodedBand encodeBand(const uchar *rgba, int width, int lines, bool last) const;
+  void        writeBand(QFile *file, const EncodedBand &band);
+  void        end(QFile *file);
+
+ private:
+  void filterRow(uchar *out, const uchar *row, const uchar *prev, int len) const;
+
+  Options options;
+  quint32 adler;
+};
+
+
+// "Quite OK Image" format, very fast lossless compression
+class QoiEncoder : public ImageEncoder {
+ public:
+  QString name() const { return "QOI"; }
+
+  void        begin(QFile *file, int width, int height);
+  EncodedBand encodeBand(const uchar *rgba, int width, int lines, bool last) const;
+  void        writeBand(QFile *file, const EncodedBand &band);
+  void        end(QFile *file);
+};
+
+
+// uncompressed RGBA rows behind a small header, for downstream tooling
+class RawEncoder : public ImageEncoder {
+ public:
+  QString name() const { return "raw"; }
+
+  void        begin(QFile *file, int width, int height);
+  EncodedBand encodeBand(const uchar *rgba, int width, int lines, bool last) const;
+  void        writeBand(QFile *file, const EncodedBand &band);
+  void        end(QFile *file);
+};
+
+#endif  // IMAGEENCODER_H_
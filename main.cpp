@@ -4,6 +4,7 @@
 #include <QLocale>
 
 #include "minutor.h"
+#include "renderflags.h"
 
 int main(int argc, char *argv[]) {
   QApplication app(argc, argv);
@@ -29,6 +30,9 @@ int main(int argc, char *argv[]) {
   int ex_Zmax = 0;
   bool regionChecker = false;
   bool chunkChecker = false;
+  int scale = 1;
+  ImageEncoder::Options encoding;
+  QList<WorldSave::Layer> layers;
   for (int i = 0; i < numArgs; i++) {
     if (args[i].length() > 2) {
       // convert long variants to lower case
@@ -55,12 +59,42 @@ int main(int argc, char *argv[]) {
       i += 4;
       continue;
     }
+    if (args[i] == "--scale" && i + 1 < numArgs) {
+      // Blocks per pixel for following exports, power of two
+      scale = args[i + 1].toInt();
+      i += 1;
+      continue;
+    }
+    if (args[i] == "--compression" && i + 1 < numArgs) {
+      // deflate level for following PNG exports, 0 = store only
+      encoding.level = qBound(0, args[i + 1].toInt(), 9);
+      i += 1;
+      continue;
+    }
+    if (args[i] == "--filter" && i + 1 < numArgs) {
+      // PNG row filter: none, sub, up, average, paeth or adaptive
+      encoding.filter = ImageEncoder::filterFromName(args[i + 1]);
+      i += 1;
+      continue;
+    }
     if ((args[i] == "-s" || args[i] == "--savepng") && i + 1 < numArgs) {
       minutor.savePNG(args[i + 1], true, regionChecker, chunkChecker,
-                      ex_Zmin, ex_Xmin, ex_Zmax, ex_Xmax);
+                      ex_Zmin, ex_Xmin, ex_Zmax, ex_Xmax, scale, encoding);
+      i += 1;
+      continue;
+    }
+    if ((args[i] == "-t" || args[i] == "--savetiles") && i + 1 < numArgs) {
+      minutor.saveTiles(args[i + 1], true);
       i += 1;
       continue;
     }
+    if ((args[i] == "-ly" || args[i] == "--layer") && i + 3 < numArgs) {
+      // all layers are exported together after parsing all arguments
+      layers.append(WorldSave::Layer(args[i + 1], args[i + 2].toInt(),
+                                     RenderFlags::fromString(args[i + 3])));
+      i += 3;
+      continue;
+    }
     if ((args[i] == "-j" || args[i] == "--jump") && i + 2 < numArgs) {
       minutor.jumpToXZ(args[i + 1].toInt(), args[i + 2].toInt());
       i += 2;
@@ -120,6 +154,11 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (!layers.isEmpty()) {
+    minutor.savePNGLayers(layers, true, regionChecker, chunkChecker,
+                          ex_Zmin, ex_Xmin, ex_Zmax, ex_Xmax, scale, encoding);
+  }
+
   minutor.show();
   return app.exec();
 }
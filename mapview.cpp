@@ -2,27 +2,33 @@
 #include <QPainter>
 #include <QResizeEvent>
 #include <QMessageBox>
+#include <QTimer>
 #include <cmath>
 #include <assert.h>
 
 #include "mapview.h"
+#include "activitymap.h"
 #include "chunkcache.h"
 #include "chunkrenderer.h"
 #include "identifier/definitionmanager.h"
 #include "identifier/blockidentifier.h"
 #include "identifier/biomeidentifier.h"
 #include "clamp.h"
+#include "overlay/entitycluster.h"
 
 MapView::MapView(QWidget *parent)
   : QWidget(parent)
   , depth(255)
   , scale(1)      // overworld coordinate mapping
   , zoomLevel(0)  // 1:1
+  , flags(0)
   , cache(ChunkCache::Instance())
 {
   adjustZoom(0, false, false);
   connect(&cache, &ChunkCache::chunkLoaded,
           this,   &MapView::chunkUpdated);
+  connect(&cache, &ChunkCache::entitiesLoaded,
+          this,   &MapView::entitiesUpdated);
 
   setMouseTracking(true);
   setFocusPolicy(Qt::StrongFocus);
@@ -97,7 +103,9 @@ void MapView::setDimension(QString path, int scale) {
     this->z = 0;
   }
   clearOverlayItems();
+  activityMap.clear();
   cache.clear();
+  prefetched.clear();
   cache.setPath(path);
   redraw();
 }
@@ -109,6 +117,9 @@ void MapView::setDepth(int depth) {
 
 void MapView::setFlags(int flags) {
   this->flags = flags;
+  // cached Chunks lacking a channel are reloaded when drawn next
+  cache.setDecodeChannels(ChunkRenderer::decodeChannels(flags));
+  updateEntitiesNeeded();
 }
 
 int MapView::getFlags() const {
@@ -124,17 +135,48 @@ void MapView::chunkUpdated(int x, int z) {
   update();
 }
 
+void MapView::entitiesUpdated(int x, int z) {
+  // hover text shows the ChunkLock state, which is stored in an Entity
+  if ((x == (hoverX >> 4)) && (z == (hoverZ >> 4)))
+    getToolTip(hoverX, hoverZ);
+
+  // Entities of many Chunks arrive shortly after each other -> redraw once
+  if (entityRedrawPending || !cache.getEntitiesNeeded())
+    return;
+  entityRedrawPending = true;
+  QTimer::singleShot(50, this, [this]() {
+    entityRedrawPending = false;
+    redraw();
+  });
+}
+
+void MapView::updateEntitiesNeeded() {
+  // Entities are only loaded when they are displayed
+  bool needed = (flags & flgChunkLock);  // lock state is stored in an Entity
+  for (auto &type : overlayItemTypes) {
+    if (type.startsWith("Entity.")) {
+      needed = true;
+      break;
+    }
+  }
+  cache.setEntitiesNeeded(needed);
+}
+
 QString MapView::getWorldPath() {
   return cache.getPath();
 }
 
 void MapView::updateSearchResultPositions(const QVector<QSharedPointer<OverlayItem> > &searchResults)
 {
-  currentSearchResults = searchResults;
+  currentSearchResults.clear();
+  for (auto &item : searchResults) {
+    currentSearchResults.insert(item);
+  }
 }
 
 void MapView::clearCache() {
   cache.clear();
+  prefetched.clear();
   redraw();
 }
 
@@ -396,8 +438,11 @@ void MapView::redraw() {
   int blockstall = imageChunks.height() / chunksize + 3;
 
   for (int cz = startz; cz < startz + blockstall; cz++)
-    for (int cx = startx; cx < startx + blockswide; cx++)
+    for (int cx = startx; cx < startx + blockswide; cx++) {
+      if (!prefetched.isEmpty() && prefetched.remove(ChunkID(cx, cz)))
+        prefetchStatistics.hits++;
       drawChunk(cx, cz);
+    }
 
   // clear the overlay layer
   imageOverlays.fill(0);
@@ -411,14 +456,46 @@ void MapView::redraw() {
   double x2 = x + halfviewwidth;
   double z2 = z + halvviewheight;
 
+  // draw the activity raster, one pixel per Chunk
+  if (activityMap) {
+    for (int rz = startz >> 5; rz <= (startz + blockstall) >> 5; rz++) {
+      for (int rx = startx >> 5; rx <= (startx + blockswide) >> 5; rx++) {
+        const QImage image = activityMap->regionImage(rx, rz);
+        if (!image.isNull())
+          canvas.drawImage(QRectF((rx * 512 - x1) * zoom, (rz * 512 - z1) * zoom,
+                                  512 * zoom, 512 * zoom), image);
+      }
+    }
+  }
+
   // draw the entities
+  // when zoomed out, show one cluster per type and Chunk instead of each Entity
+  // when zoomed out even further, merge those clusters per type and Region
+  const bool drawClusters = (chunksize < CLUSTER_CHUNK_SIZE);
+  const bool mergeClusters = (chunksize < REGION_CLUSTER_CHUNK_SIZE);
+  QHash<QPair<int, int>, QHash<QString, QSharedPointer<EntityCluster>>> regionClusters;
   for (int cz = startz; cz < startz + blockstall; cz++) {
     for (int cx = startx; cx < startx + blockswide; cx++) {
       QSharedPointer<Chunk> chunk(cache.fetch(cx, cz));
       if (chunk) {
         // Entities from Chunks
         for (auto &type : overlayItemTypes) {
-          auto range = chunk->entities.equal_range(type);
+          if (drawClusters) {
+            auto cluster = chunk->getEntityClusters().value(type);
+            // don't show clusters completely above our depth
+            if (!cluster || (cluster->bounds().min.y >= depth + 1))
+              continue;
+            if (mergeClusters) {
+              auto &merged = regionClusters[qMakePair(cx >> 5, cz >> 5)][type];
+              if (!merged)
+                merged = QSharedPointer<EntityCluster>::create(type, cluster->color());
+              merged->add(cluster);
+            } else {
+              cluster->draw(x1, z1, zoom, &canvas);
+            }
+            continue;
+          }
+          auto range = chunk->getEntityMap().equal_range(type);
           for (auto it = range.first; it != range.second; ++it) {
             // don't show entities above our depth
             int entityY = (*it)->midpoint().y;
@@ -439,33 +516,98 @@ void MapView::redraw() {
       }
     }
   }
+  for (const auto &clusters : qAsConst(regionClusters)) {
+    for (const auto &cluster : clusters)
+      cluster->draw(x1, z1, zoom, &canvas);
+  }
 
   const OverlayItem::Cuboid viewingCuboid(OverlayItem::Point(x1 - 1, -4096, z1 - 1),
                                           OverlayItem::Point(x2 + 1, depth, z2 + 1));
 
   // draw the generated structures
   for (auto &type : overlayItemTypes) {
-    drawOverlayItems(overlayItems[type], viewingCuboid, x1, z1, canvas);
+    drawOverlayItems(overlayItems, type, viewingCuboid, x1, z1, canvas);
   }
 
-  drawOverlayItems(currentSearchResults, viewingCuboid, x1, z1, canvas);
+  for (auto &type : currentSearchResults.types()) {
+    drawOverlayItems(currentSearchResults, type, viewingCuboid, x1, z1, canvas);
+  }
 
   emit coordinatesChanged(x, depth, z);
 
   update();
-}
 
+  prefetch(startx, startz, blockswide, blockstall);
+}
+
+// estimate where the view moves to and load those Chunks at low priority,
+// so panning and zooming out reveal less placeholders
+void MapView::prefetch(int startx, int startz, int chunkswide, int chunkstall) {
+  // velocity in Blocks per second, smoothed over the last redraws
+  qint64 elapsed = PREFETCH_IDLE;
+  if (motionTimer.isValid())
+    elapsed = motionTimer.restart();
+  else
+    motionTimer.start();
+  if (elapsed >= PREFETCH_IDLE) {
+    velocityX = velocityZ = 0;
+  } else if ((elapsed > 0) && (zoom == lastZoom)) {
+    velocityX = 0.5 * velocityX + 0.5 * (x - lastX) * 1000.0 / elapsed;
+    velocityZ = 0.5 * velocityZ + 0.5 * (z - lastZ) * 1000.0 / elapsed;
+  }
+  const bool zoomingOut = (zoom < lastZoom);
+  lastX = x;
+  lastZ = z;
+  lastZoom = zoom;
+
+  // prefetched Chunks evicted before they were shown
+  for (auto it = prefetched.begin(); it != prefetched.end(); ) {
+    if (cache.isCached(*it)) {
+      ++it;
+    } else {
+      prefetchStatistics.wasted++;
+      it = prefetched.erase(it);
+    }
+  }
 
-template<typename ListT>
-void MapView::drawOverlayItems(const ListT &list, const OverlayItem::Cuboid& cuboid, double x1, double z1, QPainter& canvas)
-{
-  for (auto &item : list) {
-    if (item->intersects(cuboid)) {
-      item->draw(x1, z1, zoom, &canvas);
+  // margin in Chunks ahead of the motion, a ring around the view when zooming out,
+  // limited so that the Cache (twice the view) keeps all visible Chunks
+  const int aheadX = std::clamp(static_cast<int>(velocityX * PREFETCH_LOOKAHEAD / 1000 / 16),
+                                -chunkswide / 4, chunkswide / 4);
+  const int aheadZ = std::clamp(static_cast<int>(velocityZ * PREFETCH_LOOKAHEAD / 1000 / 16),
+                                -chunkstall / 4, chunkstall / 4);
+  const int ringX = zoomingOut ? std::max(1, chunkswide / 8) : 0;
+  const int ringZ = zoomingOut ? std::max(1, chunkstall / 8) : 0;
+  if ((aheadX == 0) && (aheadZ == 0) && !zoomingOut)
+    return;
+
+  int budget = cache.getCacheMax() - cache.getCacheUsage();
+  const int x1 = startx + std::min(0, aheadX) - ringX;
+  const int x2 = startx + chunkswide + std::max(0, aheadX) + ringX;
+  const int z1 = startz + std::min(0, aheadZ) - ringZ;
+  const int z2 = startz + chunkstall + std::max(0, aheadZ) + ringZ;
+  for (int cz = z1; (cz < z2) && (budget > 0); cz++) {
+    for (int cx = x1; (cx < x2) && (budget > 0); cx++) {
+      if ((cx >= startx) && (cx < startx + chunkswide) &&
+          (cz >= startz) && (cz < startz + chunkstall))
+        continue;  // visible, already requested
+      if (cache.prefetch(cx, cz)) {
+        prefetched.insert(ChunkID(cx, cz));
+        prefetchStatistics.issued++;
+        budget--;
+      }
     }
   }
 }
 
+
+void MapView::drawOverlayItems(const OverlayStore &store, const QString &type, const OverlayItem::Cuboid& cuboid, double x1, double z1, QPainter& canvas)
+{
+  store.forEach(type, cuboid, [&](const OverlayStore::ItemT &item) {
+    item->draw(x1, z1, zoom, &canvas);
+  });
+}
+
 void MapView::drawChunk(int x, int z) {
   if (!this->isEnabled())
     return;
@@ -476,8 +618,12 @@ void MapView::drawChunk(int x, int z) {
 
   if (chunk && chunk->rendering) return;
 
-  if (chunk && (chunk->renderedAt != depth ||
-                chunk->renderedFlags != flags)) {
+  // a reload with missing channels is running, keep showing the old image
+  const bool upgrading = chunk && !chunk->hasChannels(cache.getDecodeChannels()) &&
+                         (chunk->upgrading.loadAcquire() != Chunk::UPGRADE_FAILED);
+
+  if (chunk && !upgrading && (chunk->renderedAt != depth ||
+                              chunk->renderedFlags != flags)) {
     //renderChunk(chunk);
     chunk->rendering = true;
     ChunkRenderer *renderer = new ChunkRenderer(x, z, depth, flags);
@@ -506,7 +652,8 @@ void MapView::drawChunk(int x, int z) {
   centerx += (x - centerchunkx) * chunksize;
   centery += (z - centerchunkz) * chunksize;
 
-  const uchar* srcImageData = chunk ? chunk->getImage() : placeholder;
+  const bool rendered = chunk && (chunk->renderedAt != INT_MIN);
+  const uchar* srcImageData = rendered ? chunk->getImage() : placeholder;
   QImage srcImage(srcImageData, 16, 16, QImage::Format_RGB32);
 
   QRectF targetRect(centerx, centery, chunksize, chunksize);
@@ -532,6 +679,12 @@ void MapView::getToolTip(int x, int z) {
   int cx = floor(x / 16.0);
   int cz = floor(z / 16.0);
   QSharedPointer<Chunk> chunk(cache.fetch(cx, cz));
+  hoverX = x;
+  hoverZ = z;
+  // Entities of the hovered Chunk are loaded even when no overlay needs them,
+  // the hover text is updated when they arrive
+  if (chunk && chunk->loaded && !chunk->hasEntities())
+    cache.fetchEntities(cx, cz, chunk);
   int offset = (x & 0xf) + (z & 0xf) * 16;
   int y = 0;
 
@@ -619,11 +772,20 @@ void MapView::getToolTip(int x, int z) {
     hovertext += " (" + blockstate + ")";
   if (entityStr.length() > 0)
     hovertext += " - " + entityStr;
+  if (activityMap) {
+    const ActivityMap::ChunkActivity activity = activityMap->at(cx, cz);
+    if (activity.status != ActivityMap::STATUS_NONE)
+      hovertext += QString(" - inhabited %1 ticks (%2)")
+                   .arg(activity.inhabitedTime)
+                   .arg(ActivityMap::statusName(activity.status));
+  }
 
 #if defined(DEBUG) || defined(_DEBUG) || defined(QT_DEBUG)
-  hovertext += " [Cache:"
-            + QString().number(this->cache.getCacheUsage()) + "/"
-            + QString().number(this->cache.getCacheMax()) + "]";
+  hovertext += " [" + this->cache.getStatistics() + "]";
+  hovertext += QString(" Prefetch:%1 (hit:%2 waste:%3)")
+               .arg(prefetchStatistics.issued)
+               .arg(prefetchStatistics.hits)
+               .arg(prefetchStatistics.wasted);
   hovertext += " Zoom:" + QString().number(zoomLevel);
 #endif
 
@@ -634,15 +796,8 @@ void MapView::getToolTip(int x, int z) {
 }
 
 void MapView::addOverlayItem(QSharedPointer<OverlayItem> item) {
-  // test if item is already in list
-  for (auto &it: overlayItems[item->type()]) {
-    OverlayItem::Point p1 = it  ->midpoint();
-    OverlayItem::Point p2 = item->midpoint();
-    if ( (p1.x == p2.x) && (p1.y == p2.y) && (p1.z == p2.z) )
-      return;  // skip if already present
-  }
-  // otherwise add item
-  overlayItems[item->type()].push_back(item);
+  // add item, skipped by store if already present
+  overlayItems.insert(item);
 }
 
 void MapView::clearOverlayItems() {
@@ -651,6 +806,12 @@ void MapView::clearOverlayItems() {
 
 void MapView::setVisibleOverlayItemTypes(const QSet<QString>& itemTypes) {
   overlayItemTypes = itemTypes;
+  updateEntitiesNeeded();
+}
+
+void MapView::setActivityMap(QSharedPointer<const ActivityMap> map) {
+  activityMap = map;
+  redraw();
 }
 
 int MapView::getY(int x, int z) {
@@ -670,17 +831,13 @@ QList<QSharedPointer<OverlayItem>> MapView::getItems(int x, int y, int z) {
     double invzoom = 10.0 / zoom;
     for (auto &type : overlayItemTypes) {
       // generated structures
-      for (auto &item : overlayItems[type]) {
-        double ymin = chunk->lowest;
-        double ymax = depth;
-        if (item->intersects(OverlayItem::Point(x, ymin, z),
-                             OverlayItem::Point(x, ymax, z))) {
-          ret.append(item);
-        }
-      }
+      double ymin = chunk->lowest;
+      double ymax = depth;
+      ret.append(overlayItems.query(type, OverlayItem::Cuboid(OverlayItem::Point(x, ymin, z),
+                                                              OverlayItem::Point(x, ymax, z))));
 
       // entities
-      auto itemRange = chunk->entities.equal_range(type);
+      auto itemRange = chunk->getEntityMap().equal_range(type);
       for (auto itItem = itemRange.first; itItem != itemRange.second;
           ++itItem) {
         double ymin = y - 4;
@@ -3,32 +3,24 @@
 #define MAPVIEW_H_
 
 #include <QtWidgets/QWidget>
+#include <QElapsedTimer>
+#include <QSet>
 #include <QSharedPointer>
 #include "chunkcache.h"
+#include "renderflags.h"
+#include "overlay/overlaystore.h"
 
+class ActivityMap;
 class DefinitionManager;
 class BiomeIdentifier;
 class BlockIdentifier;
 class OverlayItem;
 
-class MapView : public QWidget {
+// view flags (MapView::flgLighting, ...) are inherited from RenderFlags
+class MapView : public QWidget, public RenderFlags {
   Q_OBJECT
 
  public:
-  /// Values for the individual flags
-  enum {
-    flgLighting       = 1 << 0,
-    flgMobSpawn       = 1 << 1,
-    flgCaveMode       = 1 << 2,
-    flgDepthShading   = 1 << 3,
-    flgBiomeColors    = 1 << 4,
-    flgSeaGround      = 1 << 5,
-    flgSingleLayer    = 1 << 6,
-    flgSlimeChunks    = 1 << 7,
-    flgInhabitedTime  = 1 << 8,
-    flgChunkLock      = 1 << 9,
-  };
-
   typedef struct struct_BlockLocation {
     float x, y, z;
     int scale;
@@ -54,6 +46,7 @@ class MapView : public QWidget {
   void addOverlayItem(QSharedPointer<OverlayItem> item);
   void clearOverlayItems();
   void setVisibleOverlayItemTypes(const QSet<QString>& itemTypes);
+  void setActivityMap(QSharedPointer<const ActivityMap> map);  // NULL to hide
 
   // public for saving the png
   QString getWorldPath();
@@ -64,6 +57,7 @@ class MapView : public QWidget {
  public slots:
   void setDepth(int depth);
   void chunkUpdated(int x, int z);
+  void entitiesUpdated(int x, int z);
   void redraw();
 
   // Clears the cache and redraws, causing all chunks to be re-loaded;
@@ -93,11 +87,16 @@ class MapView : public QWidget {
   int getY(int x, int z);
   QList<QSharedPointer<OverlayItem>> getItems(int x, int y, int z);
   void adjustZoom(double steps, bool allowZoomOut, bool cursorSource);
+  void updateEntitiesNeeded();
+  void prefetch(int startx, int startz, int chunkswide, int chunkstall);
 
-  template<typename ListT>
-  void drawOverlayItems(const ListT& list, const OverlayItem::Cuboid& cuboid, double x1, double z1, QPainter& canvas);
+  void drawOverlayItems(const OverlayStore& store, const QString& type, const OverlayItem::Cuboid& cuboid, double x1, double z1, QPainter& canvas);
 
   static const int CAVE_DEPTH = 16;  // maximum depth caves are searched in cave mode
+  static const int CLUSTER_CHUNK_SIZE = 32;  // Entities are clustered when Chunks are drawn smaller (in pixel)
+  static const int REGION_CLUSTER_CHUNK_SIZE = 4;  // clusters are merged per Region when Chunks are drawn smaller (in pixel)
+  static const int PREFETCH_LOOKAHEAD = 500;  // Chunks are prefetched where the view is in this time (ms)
+  static const int PREFETCH_IDLE      = 1000; // no motion when redraws are further apart (ms)
   float caveshade[CAVE_DEPTH];
 
   int depth;
@@ -107,16 +106,30 @@ class MapView : public QWidget {
   double zoom;
   int flags;
   int lastMouseX = -1, lastMouseY = -1;
+  int hoverX = 0, hoverZ = 0;  // Block of the current hover text
+  bool entityRedrawPending = false;  // coalesce redraws after Entities arrived
   ChunkCache &cache;
   QImage imageChunks;
   QImage imageOverlays;
   DefinitionManager *dm;
   uchar placeholder[16 * 16 * 4];  // no chunk found placeholder
   QSet<QString> overlayItemTypes;
-  QMap<QString, QList<QSharedPointer<OverlayItem>>> overlayItems;
+  OverlayStore overlayItems;
   BlockLocation currentLocation;
 
-  QVector<QSharedPointer<OverlayItem> > currentSearchResults;
+  OverlayStore currentSearchResults;
+  QSharedPointer<const ActivityMap> activityMap;  // raster of InhabitedTime below all overlays
+
+  // motion estimation for prefetching
+  QElapsedTimer motionTimer;
+  double lastX = 0, lastZ = 0, lastZoom = 0;
+  double velocityX = 0, velocityZ = 0;  // Blocks per second, smoothed over redraws
+  QSet<ChunkID> prefetched;             // prefetched Chunks not yet shown
+  struct {
+    quint64 issued = 0;
+    quint64 hits   = 0;  // shown later
+    quint64 wasted = 0;  // evicted before being shown
+  } prefetchStatistics;
 };
 
 #endif  // MAPVIEW_H_
@@ -0,0 +1,114 @@
+# Core of Minutor without any widgets:
+# world parsing, Chunk loading, rendering and image export.
+# Included by minutor.pro (GUI) and cli/minutor-cli.pro (command line).
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+unix:LIBS += -lz
+
+HEADERS += \
+    $$PWD/activitymap.h \
+    $$PWD/blockhistogram.h \
+    $$PWD/blockindex.h \
+    $$PWD/chunk.h \
+    $$PWD/chunkcache.h \
+    $$PWD/chunkid.h \
+    $$PWD/chunkloader.h \
+    $$PWD/chunkrenderer.h \
+    $$PWD/clamp.h \
+    $$PWD/identifier/biomeidentifier.h \
+    $$PWD/identifier/blockidentifier.h \
+    $$PWD/identifier/definitionloader.h \
+    $$PWD/identifier/dimensionidentifier.h \
+    $$PWD/identifier/entityidentifier.h \
+    $$PWD/identifier/flatteningconverter.h \
+    $$PWD/imageencoder.h \
+    $$PWD/java.h \
+    $$PWD/lz4/lz4.h \
+    $$PWD/lz4/xxhash.h \
+    $$PWD/nbt/nbt.h \
+    $$PWD/nbt/nbtprojection.h \
+    $$PWD/nbt/tag.h \
+    $$PWD/nbt/tagdatastream.h \
+    $$PWD/nbt/tagpath.h \
+    $$PWD/overlay/entity.h \
+    $$PWD/overlay/entitycluster.h \
+    $$PWD/overlay/generatedstructure.h \
+    $$PWD/overlay/overlayitem.h \
+    $$PWD/overlay/overlaystore.h \
+    $$PWD/overlay/village.h \
+    $$PWD/paletteentry.h \
+    $$PWD/regionfile.h \
+    $$PWD/renderflags.h \
+    $$PWD/tileexport.h \
+    $$PWD/worldinfo.h \
+    $$PWD/worldsave.h \
+    $$PWD/zipreader.h
+SOURCES += \
+    $$PWD/activitymap.cpp \
+    $$PWD/blockhistogram.cpp \
+    $$PWD/blockindex.cpp \
+    $$PWD/chunk.cpp \
+    $$PWD/chunkcache.cpp \
+    $$PWD/chunkloader.cpp \
+    $$PWD/chunkrenderer.cpp \
+    $$PWD/identifier/biomeidentifier.cpp \
+    $$PWD/identifier/blockidentifier.cpp \
+    $$PWD/identifier/definitionloader.cpp \
+    $$PWD/identifier/dimensionidentifier.cpp \
+    $$PWD/identifier/entityidentifier.cpp \
+    $$PWD/identifier/flatteningconverter.cpp \
+    $$PWD/imageencoder.cpp \
+    $$PWD/java.cpp \
+    $$PWD/lz4/lz4.c \
+    $$PWD/lz4/xxhash.c \
+    $$PWD/nbt/nbt.cpp \
+    $$PWD/nbt/nbtprojection.cpp \
+    $$PWD/nbt/tag.cpp \
+    $$PWD/nbt/tagdatastream.cpp \
+    $$PWD/nbt/tagpath.cpp \
+    $$PWD/overlay/entity.cpp \
+    $$PWD/overlay/entitycluster.cpp \
+    $$PWD/overlay/generatedstructure.cpp \
+    $$PWD/overlay/overlayitem.cpp \
+    $$PWD/overlay/overlaystore.cpp \
+    $$PWD/overlay/village.cpp \
+    $$PWD/regionfile.cpp \
+    $$PWD/tileexport.cpp \
+    $$PWD/worldinfo.cpp \
+    $$PWD/worldsave.cpp \
+    $$PWD/zipreader.cpp
+
+win32 {
+HEADERS += \
+    $$PWD/zlib/crc32.h \
+    $$PWD/zlib/deflate.h \
+    $$PWD/zlib/gzguts.h \
+    $$PWD/zlib/inffast.h \
+    $$PWD/zlib/inffixed.h \
+    $$PWD/zlib/inflate.h \
+    $$PWD/zlib/inftrees.h \
+    $$PWD/zlib/trees.h \
+    $$PWD/zlib/zconf.h \
+    $$PWD/zlib/zlib.h \
+    $$PWD/zlib/zutil.h
+
+SOURCES += \
+    $$PWD/zlib/adler32.c \
+    $$PWD/zlib/compress.c \
+    $$PWD/zlib/crc32.c \
+    $$PWD/zlib/deflate.c \
+    $$PWD/zlib/gzclose.c \
+    $$PWD/zlib/gzlib.c \
+    $$PWD/zlib/gzread.c \
+    $$PWD/zlib/gzwrite.c \
+    $$PWD/zlib/infback.c \
+    $$PWD/zlib/inffast.c \
+    $$PWD/zlib/inflate.c \
+    $$PWD/zlib/inftrees.c \
+    $$PWD/zlib/trees.c \
+    $$PWD/zlib/uncompr.c \
+    $$PWD/zlib/zutil.c
+
+INCLUDEPATH += $$PWD/zlib $$PWD/lz4
+}
@@ -26,7 +26,10 @@
 #include "identifier/dimensionidentifier.h"
 #include "settings.h"
 #include "worldinfo.h"
+#include "dimensionmenu.h"
 #include "worldsave.h"
+#include "tileexport.h"
+#include "activitymap.h"
 #include "overlay/properties.h"
 #include "overlay/generatedstructure.h"
 #include "overlay/village.h"
@@ -36,6 +39,7 @@
 #include "search/searchchunksdialog.h"
 #include "search/searchentityplugin.h"
 #include "search/searchblockplugin.h"
+#include "search/searchqueryplugin.h"
 #include "search/statisticdialog.h"
 
 
@@ -51,18 +55,18 @@ Minutor::Minutor()
           this,    SLOT(showProperties(QVariant)));
 
   ChunkCache const & cache = ChunkCache::Instance();
-  connect(&cache, &ChunkCache::structureFound,
-          this,   &Minutor::addStructureFromChunk);
+  connect(&cache, &ChunkCache::structuresFound,
+          this,   &Minutor::addStructuresFromChunk);
 
   // Definition manager
   dm = new DefinitionManager(this);
   mapview->attach(dm);
   connect(dm,   SIGNAL(packsChanged()),
           this, SLOT(updateDimensions()));
-  // world information
-  WorldInfo & wi = WorldInfo::Instance();
-  connect(&wi,  SIGNAL(dimensionChanged(const DimensionInfo &)),
-          this, SLOT(viewDimension(const DimensionInfo &)));
+  // Dimension menu of current world
+  dimensionMenu = new DimensionMenu(this);
+  connect(dimensionMenu, SIGNAL(dimensionChanged(const DimensionInfo &)),
+          this,          SLOT(viewDimension(const DimensionInfo &)));
 
   // "Settings" dialog
   dialogSettings = new Settings(this);
@@ -180,7 +184,9 @@ void Minutor::save() {
   QFileDialog fileDialog(this);
   fileDialog.setDefaultSuffix("png");
   QString filename = fileDialog.getSaveFileName(this, tr("Save world as PNG"),
-                                                QString(), "PNG Images (*.png)");
+                                                QString(), "PNG Images (*.png);;"
+                                                           "QOI Images (*.qoi);;"
+                                                           "Raw RGBA Data (*.raw)");
 
   // check if filename was given
   if (filename.isEmpty())
@@ -197,29 +203,58 @@ void Minutor::save() {
   savePNG(filename, false,
           pngoptions.getRegionChecker(), pngoptions.getChunkChecker(),
           pngoptions.getTop(), pngoptions.getLeft(),
-          pngoptions.getBottom(), pngoptions.getRight());
+          pngoptions.getBottom(), pngoptions.getRight(),
+          pngoptions.getScale());
 }
 
 void Minutor::savePNG(QString filename, bool autoclose,
                       bool regionChecker, bool chunkChecker,
-                      int w_top, int w_left, int w_bottom, int w_right) {
-  progressAutoclose = autoclose;
+                      int w_top, int w_left, int w_bottom, int w_right,
+                      int scale, const ImageEncoder::Options &encoding) {
   if (!filename.isEmpty()) {
-    WorldSave *ws = new WorldSave(filename, mapview,
+    // single layer with current view settings
+    QList<WorldSave::Layer> layers;
+    layers.append(WorldSave::Layer(filename, mapview->getDepth(), mapview->getFlags()));
+    savePNGLayers(layers, autoclose, regionChecker, chunkChecker,
+                  w_top, w_left, w_bottom, w_right, scale, encoding);
+  }
+}
+
+void Minutor::savePNGLayers(const QList<WorldSave::Layer> &layers, bool autoclose,
+                            bool regionChecker, bool chunkChecker,
+                            int w_top, int w_left, int w_bottom, int w_right,
+                            int scale, const ImageEncoder::Options &encoding) {
+  progressAutoclose = autoclose;
+  if (!layers.isEmpty()) {
+    WorldSave *ws = new WorldSave(layers, mapview->getWorldPath(),
                                   regionChecker, chunkChecker,
-                                  w_top, w_left, w_bottom, w_right);
-    progress = new QProgressDialog();
-    progress->setCancelButton(NULL);
-    progress->setMaximum(100);
-    progress->show();
-    connect(ws, SIGNAL(progress(QString, double)),
-            this, SLOT(saveProgress(QString, double)));
-    connect(ws, SIGNAL(finished()),
-            this, SLOT(saveFinished()));
-    QThreadPool::globalInstance()->start(ws);
+                                  w_top, w_left, w_bottom, w_right, scale, encoding);
+    startSaveJob(ws, ws);
+  }
+}
+
+void Minutor::saveTiles(QString directory, bool autoclose) {
+  progressAutoclose = autoclose;
+  if (!directory.isEmpty()) {
+    TileExport *te = new TileExport(directory, mapview->getWorldPath(),
+                                    mapview->getDepth(), mapview->getFlags());
+    startSaveJob(te, te);
   }
 }
 
+// show progress dialog and run a background export job
+void Minutor::startSaveJob(QObject *job, QRunnable *runnable) {
+  progress = new QProgressDialog();
+  progress->setCancelButton(NULL);
+  progress->setMaximum(100);
+  progress->show();
+  connect(job, SIGNAL(progress(QString, double)),
+          this, SLOT(saveProgress(QString, double)));
+  connect(job, SIGNAL(finished()),
+          this, SLOT(saveFinished()));
+  QThreadPool::globalInstance()->start(runnable);
+}
+
 
 void Minutor::saveProgress(QString status, double value) {
   progress->setValue(value*100);
@@ -244,9 +279,10 @@ void Minutor::closeWorld() {
   m_ui.menu_JumpPlayer->setEnabled(false);
 
   // clear "Dimensions" menu
-  WorldInfo::Instance().clearDimensionsMenu(m_ui.menu_Dimension);
+  dimensionMenu->clearDimensionsMenu(m_ui.menu_Dimension);
   // clear overlays
   mapview->clearOverlayItems();
+  m_ui.action_WorldActivity->setChecked(false);
   // clear other stuff
   currentWorld = QDir();
   emit worldLoaded(false);
@@ -367,6 +403,23 @@ void Minutor::toggleOverlays()
   mapview->redraw();
 }
 
+// scan InhabitedTime of the whole dimension in background, then show it
+void Minutor::toggleWorldActivity(bool checked) {
+  if (!checked) {
+    mapview->setActivityMap(QSharedPointer<const ActivityMap>());
+    return;
+  }
+  QSharedPointer<ActivityMap> map(new ActivityMap(mapview->getWorldPath()));
+  ActivityScan *job = new ActivityScan(map);
+  connect(job, &ActivityScan::finished, this, [this, map]() {
+    // dimension may have changed or overlay was disabled while scanning
+    if (m_ui.action_WorldActivity->isChecked() && (map->getPath() == mapview->getWorldPath()))
+      mapview->setActivityMap(map);
+  });
+  progressAutoclose = false;
+  startSaveJob(job, job);
+}
+
 void Minutor::toggleStructures(bool checked)
 {
   bool toggleEnabled = false;
@@ -500,6 +553,9 @@ void Minutor::viewDimension(const DimensionInfo &dim) {
       break;
     }
 
+  // activity of the previous dimension is not valid anymore
+  m_ui.action_WorldActivity->setChecked(false);
+
   // clear current map & update scale
   QString path = QDir(currentWorld).absoluteFilePath(dim.path);
   mapview->setDimension(path, dim.scale);
@@ -524,7 +580,7 @@ void Minutor::updateDatapackActions()
 }
 
 void Minutor::updateDimensions() {
-  WorldInfo::Instance().getDimensionsInWorld(currentWorld, m_ui.menu_Dimension, this);
+  dimensionMenu->getDimensionsInWorld(currentWorld, m_ui.menu_Dimension, this);
 }
 
 void Minutor::createActions() {
@@ -589,6 +645,11 @@ void Minutor::createActions() {
   connect(m_ui.action_ChunkLock, SIGNAL(triggered()),
           this,                  SLOT(toggleFlags()));
 
+  connect(m_ui.action_WorldActivity, &QAction::toggled,
+          this,                      &Minutor::toggleWorldActivity);
+  connect(this,                      &Minutor::worldLoaded,
+          m_ui.action_WorldActivity, &QAction::setEnabled);
+
   // [View->Others]
 //  m_ui.action_Refresh->setStatusTip(tr("Reloads all chunks, "
 //                                       "but keeps the same position / dimension"));
@@ -606,6 +667,11 @@ void Minutor::createActions() {
   connect(this,                       &Minutor::worldLoaded,
           m_ui.action_SearchBlock,    &QAction::setEnabled);
 
+  connect(m_ui.action_SearchQuery,    &QAction::triggered,
+          this,                       &Minutor::openSearchQueryDialog);
+  connect(this,                       &Minutor::worldLoaded,
+          m_ui.action_SearchQuery,    &QAction::setEnabled);
+
   connect(m_ui.action_StatisticBlock, &QAction::triggered,
           this,                       &Minutor::openStatisticBlockDialog);
   connect(this,                       &Minutor::worldLoaded,
@@ -922,7 +988,7 @@ void Minutor::loadWorld(QDir path) {
   }
 
   // create Dimensions menu
-  WorldInfo::Instance().getDimensionsInWorld(path, m_ui.menu_Dimension, this);
+  dimensionMenu->getDimensionsInWorld(path, m_ui.menu_Dimension, this);
 
   // finalize
   emit worldLoaded(true);
@@ -1106,19 +1172,21 @@ void Minutor::addOverlayItemType(QString path, QString type,
   }
 }
 
-void Minutor::addStructureFromChunk(QSharedPointer<GeneratedStructure> structure) {
-  // update menu (if necessary)
-  QString type = structure->type();
-  QString path;
-  if (!type.contains("minecraft:")) {
-    // not vanilla -> structure from a mod
-    QStringList mod = type.split(QRegularExpression("[.:]"));
-    path = mod[1];
-  }
+void Minutor::addStructuresFromChunk(GeneratedStructureList structures) {
+  for (const auto &structure : structures) {
+    // update menu (if necessary)
+    QString type = structure->type();
+    QString path;
+    if (!type.contains("minecraft:")) {
+      // not vanilla -> structure from a mod
+      QStringList mod = type.split(QRegularExpression("[.:]"));
+      path = mod[1];
+    }
 
-  addOverlayItemType(path, type, structure->color());
-  // add to list with overlays
-  mapview->addOverlayItem(structure);
+    addOverlayItemType(path, type, structure->color());
+    // add to list with overlays
+    mapview->addOverlayItem(structure);
+  }
 }
 
 void Minutor::addOverlayItem(QSharedPointer<OverlayItem> item) {
@@ -1181,6 +1249,15 @@ void Minutor::openSearchBlockDialog() {
   searchBlockForm->showNormal();
 }
 
+void Minutor::openSearchQueryDialog() {
+  // prepare dialog
+  auto searchPlugin = QSharedPointer<SearchQueryPlugin>::create();
+  auto searchQueryForm = prepareSearchForm(searchPlugin);
+  // show dialog
+  searchQueryForm->setWindowTitle(m_ui.action_SearchQuery->statusTip());
+  searchQueryForm->showNormal();
+}
+
 void Minutor::openStatisticBlockDialog() {
   // prepare dialog
   StatisticDialog *dialog = new StatisticDialog(this);
@@ -12,18 +12,20 @@
 
 #include "ui_minutor.h"
 #include "overlay/generatedstructure.h"
+#include "worldsave.h"
 
 class QAction;
 class QActionGroup;
 class QMenu;
 class QProgressDialog;
+class QRunnable;
 class MapView;
 class LabelledSlider;
 class DefinitionManager;
 class DimensionIdentifier;
 class Settings;
 class DimensionInfo;
-class WorldSave;
+class DimensionMenu;
 class Properties;
 class OverlayItem;
 class JumpTo;
@@ -49,7 +51,15 @@ class Minutor : public QMainWindow {
 
   void savePNG(QString filename, bool autoclose = false,
                bool regionChecker = false, bool chunkChecker = false,
-               int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0);
+               int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0,
+               int scale = 1,
+               const ImageEncoder::Options &encoding = ImageEncoder::Options());
+  void savePNGLayers(const QList<WorldSave::Layer> &layers, bool autoclose = false,
+                     bool regionChecker = false, bool chunkChecker = false,
+                     int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0,
+                     int scale = 1,
+                     const ImageEncoder::Options &encoding = ImageEncoder::Options());
+  void saveTiles(QString directory, bool autoclose = false);
 
   void jumpToXZ(int blockX, int blockZ);  // jumps to the block coords
   void setViewLighting(bool value);       // set View->Ligthing
@@ -79,6 +89,7 @@ private slots:
   void viewDimension(const DimensionInfo &dim);
   void toggleFlags();
   void toggleOverlays();
+  void toggleWorldActivity(bool checked);
 
   void about();
 
@@ -89,7 +100,7 @@ private slots:
   void rescanWorlds();
   void saveProgress(QString status, double value);
   void saveFinished();
-  void addStructureFromChunk(QSharedPointer<GeneratedStructure> structure);
+  void addStructuresFromChunk(GeneratedStructureList structures);
   void addOverlayItem(QSharedPointer<OverlayItem> item);
   QMenu* addOverlayItemMenu(QString path);
   void addOverlayItemType(QString path, QString type, QColor color, QString dimension = "");
@@ -97,6 +108,7 @@ private slots:
 
   void openSearchEntityDialog();
   void openSearchBlockDialog();
+  void openSearchQueryDialog();
   void openStatisticBlockDialog();
 
   void triggerJumpToPosition(QVector3D pos);
@@ -130,6 +142,8 @@ signals:
   The actions are sorted by world's folder name. */
   void getWorldList();
 
+  void startSaveJob(QObject *job, QRunnable *runnable);
+
   MapView *mapview;
   LabelledSlider *depth;
   QProgressDialog *progress;
@@ -145,6 +159,7 @@ signals:
   // loaded world data
   QList<Location> locations;  // data of player related locations in this world
   DefinitionManager *dm;
+  DimensionMenu *dimensionMenu;
   Settings *dialogSettings;
   JumpTo *dialogJumpTo;
   QDir currentWorld;
@@ -4,7 +4,6 @@ CONFIG += c++14
 QT += widgets network concurrent
 greaterThan(QT_MAJOR_VERSION, 5) QT += core5compat
 QMAKE_INFO_PLIST = minutor.plist
-unix:LIBS += -lz
 win32:RC_FILE += winicon.rc
 macx:ICON=icon.icns
 
@@ -14,39 +13,18 @@ macx:ICON=icon.icns
 #    QMAKE_LFLAGS += -pg
 #}
 
-# Input
+# Input, the core library is shared with minutor-cli
 HEADERS += \
-    chunkid.h \
-    java.h \
-    labelledseparator.h \
-    labelledslider.h \
-    clamp.h \
-    chunk.h \
-    chunkcache.h \
-    chunkloader.h \
-    chunkrenderer.h \
-    identifier/biomeidentifier.h \
-    identifier/blockidentifier.h \
+    dimensionmenu.h \
     identifier/definitionmanager.h \
     identifier/definitionupdater.h \
-    identifier/dimensionidentifier.h \
-    identifier/entityidentifier.h \
-    identifier/flatteningconverter.h \
     jumpto.h \
-    lz4/lz4.h \
-    lz4/xxhash.h \
+    labelledseparator.h \
+    labelledslider.h \
     mapview.h \
     minutor.h \
-    nbt/nbt.h \
-    nbt/tag.h \
-    nbt/tagdatastream.h \
-    overlay/entity.h \
-    overlay/generatedstructure.h \
-    overlay/overlayitem.h \
     overlay/properties.h \
     overlay/propertietreecreator.h \
-    overlay/village.h \
-    paletteentry.h \
     pngexport.h \
     search/entityevaluator.h \
     search/range.h \
@@ -55,94 +33,47 @@ HEADERS += \
     search/searchchunksdialog.h \
     search/searchentityplugin.h \
     search/searchplugininterface.h \
+    search/searchquery.h \
+    search/searchqueryplugin.h \
     search/searchrangewidget.h \
     search/searchresultitem.h \
+    search/searchresultmodel.h \
     search/searchresultwidget.h \
+    search/searchscheduler.h \
     search/searchtextwidget.h \
     search/statisticdialog.h \
     search/statisticlabel.h \
     search/statisticresultitem.h \
-    settings.h \
-    worldinfo.h \
-    worldsave.h \
-    zipreader.h
+    settings.h
 SOURCES += \
-    java.cpp \
-    labelledseparator.cpp \
-    labelledslider.cpp \
-    chunk.cpp \
-    chunkcache.cpp \
-    chunkloader.cpp \
-    chunkrenderer.cpp \
-    identifier/biomeidentifier.cpp \
-    identifier/blockidentifier.cpp \
+    dimensionmenu.cpp \
     identifier/definitionmanager.cpp \
     identifier/definitionupdater.cpp \
-    identifier/dimensionidentifier.cpp \
-    identifier/entityidentifier.cpp \
-    identifier/flatteningconverter.cpp \
     jumpto.cpp \
-    lz4/lz4.c \
-    lz4/xxhash.c \
+    labelledseparator.cpp \
+    labelledslider.cpp \
     main.cpp \
     mapview.cpp \
     minutor.cpp \
-    nbt/nbt.cpp \
-    nbt/tag.cpp \
-    nbt/tagdatastream.cpp \
-    overlay/entity.cpp \
-    overlay/generatedstructure.cpp \
     overlay/properties.cpp \
     overlay/propertietreecreator.cpp \
-    overlay/village.cpp \
     pngexport.cpp \
     search/entityevaluator.cpp \
     search/searchblockplugin.cpp \
     search/searchchunksdialog.cpp \
     search/searchentityplugin.cpp \
+    search/searchquery.cpp \
+    search/searchqueryplugin.cpp \
     search/searchrangewidget.cpp \
+    search/searchresultmodel.cpp \
     search/searchresultwidget.cpp \
+    search/searchscheduler.cpp \
     search/searchtextwidget.cpp \
     search/statisticdialog.cpp \
-    settings.cpp \
-    worldinfo.cpp \
-    worldsave.cpp \
-    zipreader.cpp
+    settings.cpp
 RESOURCES = minutor.qrc
 
-win32 {
-HEADERS += \
-    zlib/crc32.h \
-    zlib/deflate.h \
-    zlib/gzguts.h \
-    zlib/inffast.h \
-    zlib/inffixed.h \
-    zlib/inflate.h \
-    zlib/inftrees.h \
-    zlib/trees.h \
-    zlib/zconf.h \
-    zlib/zlib.h \
-    zlib/zutil.h
-
-SOURCES += \
-    zlib/adler32.c \
-    zlib/compress.c \
-    zlib/crc32.c \
-    zlib/deflate.c \
-    zlib/gzclose.c \
-    zlib/gzlib.c \
-    zlib/gzread.c \
-    zlib/gzwrite.c \
-    zlib/infback.c \
-    zlib/inffast.c \
-    zlib/inflate.c \
-    zlib/inftrees.c \
-    zlib/trees.c \
-    zlib/uncompr.c \
-    zlib/zutil.c
-
-INCLUDEPATH += identifer json nbt overlay search zlib lz4
-}
+include(minutor-core.pri)
 
 desktopfile.path = /usr/share/applications
 desktopfile.files = minutor.desktop
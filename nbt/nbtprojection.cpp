@@ -0,0 +1,378 @@
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "nbt/nbtprojection.h"
+#include "nbt/nbt.h"
+#include "nbt/tag.h"
+
+
+// Input of the scanner: uncompressed data is used in place,
+// zlib data is inflated block by block on demand
+class NBTProjection::Reader {
+ public:
+  Reader(const uchar *data, int length, bool compressed)
+    : inflating(compressed)
+    , finished(!compressed)  // nothing to refill from uncompressed data
+    , cur(data)
+    , end(data + length)
+  {
+    if (inflating) {
+      stream.zalloc = Z_NULL;
+      stream.zfree  = Z_NULL;
+      stream.opaque = Z_NULL;
+      stream.avail_in = length;
+      stream.next_in  = const_cast<Bytef *>(data);  // zlib will not change the input data
+      // +32 to autodetect gzip/zlib header
+      inflating = (inflateInit2(&stream, 15 + 32) == Z_OK);
+      finished = !inflating;
+      cur = end = NULL;
+    }
+  }
+  ~Reader() {
+    if (inflating)
+      inflateEnd(&stream);
+  }
+
+  // make n bytes available at data()
+  bool need(int n) {
+    return ((end - cur) >= n) || refill(n);
+  }
+  const uchar *data() const { return cur; }
+  void advance(int n) { cur += n; }
+
+  bool skip(qint64 n) {
+    while (n > 0) {
+      if ((cur == end) && !refill(1))
+        return false;
+      const qint64 step = std::min<qint64>(n, end - cur);
+      cur += step;
+      n -= step;
+    }
+    return true;
+  }
+
+  bool r8(quint8 &v) {
+    if (!need(1)) return false;
+    v = cur[0];
+    cur += 1;
+    return true;
+  }
+  bool r16(quint16 &v) {
+    if (!need(2)) return false;
+    v = (quint16(cur[0]) << 8) | quint16(cur[1]);
+    cur += 2;
+    return true;
+  }
+  bool r32(quint32 &v) {
+    if (!need(4)) return false;
+    v = (quint32(cur[0]) << 24) | (quint32(cur[1]) << 16) | (quint32(cur[2]) << 8) | quint32(cur[3]);
+    cur += 4;
+    return true;
+  }
+  bool r64(quint64 &v) {
+    quint32 hi, lo;
+    if (!r32(hi) || !r32(lo)) return false;
+    v = (quint64(hi) << 32) | lo;
+    return true;
+  }
+
+ private:
+  static const int BLOCK_SIZE = 16384;
+
+  // move the remaining bytes to the front and inflate until n bytes are available
+  bool refill(int n) {
+    if (finished)
+      return false;
+    const int remaining = static_cast<int>(end - cur);
+    if (remaining > 0)
+      memmove(buffer.data(), cur, remaining);
+    if (buffer.size() < size_t(n) + BLOCK_SIZE)
+      buffer.resize(size_t(n) + BLOCK_SIZE);
+
+    int filled = remaining;
+    while (filled < n) {
+      stream.next_out  = buffer.data() + filled;
+      stream.avail_out = static_cast<uInt>(buffer.size() - filled);
+      const int ret = inflate(&stream, Z_NO_FLUSH);
+      filled = static_cast<int>(buffer.size() - stream.avail_out);
+      if (ret != Z_OK) {
+        // end of stream or corrupted data
+        finished = true;
+        break;
+      }
+    }
+    cur = buffer.data();
+    end = cur + filled;
+    return (filled >= n);
+  }
+
+  z_stream stream;
+  bool     inflating;
+  bool     finished;
+  std::vector<uchar> buffer;
+  const uchar *cur;
+  const uchar *end;
+};
+
+
+int NBTProjection::addField(const QStringList &alternatives) {
+  const int field = values.size();
+  values.append(QVariant());
+  for (const QString &path : alternatives) {
+    Path p;
+    p.field = field;
+    for (const QString &key : path.split("/"))
+      p.keys.append(key.toUtf8());
+    paths.append(p);
+  }
+  return field;
+}
+
+bool NBTProjection::has(int field) const {
+  return values.value(field).isValid();
+}
+
+qint64 NBTProjection::toLong(int field, qint64 defaultValue) const {
+  const QVariant &value = values.at(field);
+  return value.isValid() ? value.toLongLong() : defaultValue;
+}
+
+QString NBTProjection::toString(int field, const QString &defaultValue) const {
+  const QVariant &value = values.at(field);
+  return value.isValid() ? value.toString() : defaultValue;
+}
+
+
+bool NBTProjection::scan(const uchar *chunk) {
+  for (auto &value : values)
+    value = QVariant();
+  pending = values.size();
+
+  // find chunk size in first 4 bytes, format is fifth byte
+  const int length = ((chunk[0] << 24) | (chunk[1] << 16) | (chunk[2] << 8) | chunk[3]) - 1;
+  const uchar *data = chunk + 5;
+  if (length <= 0)
+    return false;
+
+  // supported compression formats, see NBT
+  bool compressed;
+  switch (chunk[4]) {
+    case 1:  // rfc1952
+    case 2:  // rfc1950
+      compressed = true;
+      break;
+    case 3:  // uncompressed
+      compressed = false;
+      break;
+    case 4:  // LZ4 blocks can not be inflated partially
+      return scanFallback(chunk);
+    default:
+      return false;
+  }
+
+  Reader in(data, length, compressed);
+  quint8  type;
+  quint16 nameLength;
+  if (!in.r8(type) || (type != Tag::TAG_COMPOUND) ||
+      !in.r16(nameLength) || !in.skip(nameLength))  // name of outer compound is empty anyways
+    return false;
+
+  QVector<int> candidates(paths.size());
+  for (int i = 0; i < paths.size(); i++)
+    candidates[i] = i;
+  return scanCompound(in, 0, candidates);
+}
+
+// walk the entries of one Compound, candidates are the paths
+// matching all names up to this depth
+bool NBTProjection::scanCompound(Reader &in, int depth, const QVector<int> &candidates) {
+  if (depth > MAX_DEPTH)
+    return false;
+
+  QVector<int> matching;
+  while (pending > 0) {
+    quint8  type;
+    quint16 nameLength;
+    if (!in.r8(type))
+      return false;
+    if (type == Tag::TAG_END)
+      return true;
+    if (!in.r16(nameLength) || !in.need(nameLength))
+      return false;
+
+    // compare name without converting it
+    matching.clear();
+    for (int i : candidates) {
+      const Path &path = paths[i];
+      const QByteArray &key = path.keys[depth];
+      if (!values[path.field].isValid() && (key.size() == nameLength) &&
+          (memcmp(key.constData(), in.data(), nameLength) == 0))
+        matching.append(i);
+    }
+    in.advance(nameLength);
+
+    if (matching.isEmpty()) {
+      if (!skipPayload(in, type, depth + 1))
+        return false;
+      continue;
+    }
+
+    // a field itself or a Compound on the way to fields
+    QVector<int> deeper;
+    int field = -1;
+    for (int i : matching) {
+      if (paths[i].keys.size() == depth + 1)
+        field = paths[i].field;
+      else
+        deeper.append(i);
+    }
+    if ((field >= 0) && (type != Tag::TAG_COMPOUND) && (type != Tag::TAG_LIST)) {
+      if (!readValue(in, type, values[field]))
+        return false;
+      if (values[field].isValid())
+        pending--;
+    } else if (!deeper.isEmpty() && (type == Tag::TAG_COMPOUND)) {
+      if (!scanCompound(in, depth + 1, deeper))
+        return false;
+    } else if (!skipPayload(in, type, depth + 1)) {
+      return false;
+    }
+  }
+  // every field found: stop without reading the rest
+  return true;
+}
+
+// skip the payload of one Tag without decoding it
+bool NBTProjection::skipPayload(Reader &in, quint8 type, int depth) {
+  if (depth > MAX_DEPTH)
+    return false;
+
+  quint32 length;
+  quint16 shortLength;
+  switch (type) {
+    case Tag::TAG_BYTE:   return in.skip(1);
+    case Tag::TAG_SHORT:  return in.skip(2);
+    case Tag::TAG_INT:
+    case Tag::TAG_FLOAT:  return in.skip(4);
+    case Tag::TAG_LONG:
+    case Tag::TAG_DOUBLE: return in.skip(8);
+    case Tag::TAG_BYTE_ARRAY:
+      return in.r32(length) && (qint32(length) >= 0) && in.skip(length);
+    case Tag::TAG_INT_ARRAY:
+      return in.r32(length) && (qint32(length) >= 0) && in.skip(qint64(length) * 4);
+    case Tag::TAG_LONG_ARRAY:
+      return in.r32(length) && (qint32(length) >= 0) && in.skip(qint64(length) * 8);
+    case Tag::TAG_STRING:
+      return in.r16(shortLength) && in.skip(shortLength);
+    case Tag::TAG_LIST: {
+      quint8 elementType;
+      if (!in.r8(elementType) || !in.r32(length) || (qint32(length) < 0))
+        return false;
+      // lists of fixed size elements are skipped at once
+      static const int fixedSize[] = {0, 1, 2, 4, 8, 4, 8};
+      if (elementType <= Tag::TAG_DOUBLE)
+        return in.skip(qint64(length) * fixedSize[elementType]);
+      for (quint32 i = 0; i < length; i++)
+        if (!skipPayload(in, elementType, depth + 1))
+          return false;
+      return true;
+    }
+    case Tag::TAG_COMPOUND:
+      for (;;) {
+        quint8 entryType;
+        if (!in.r8(entryType))
+          return false;
+        if (entryType == Tag::TAG_END)
+          return true;
+        if (!in.r16(shortLength) || !in.skip(shortLength) ||
+            !skipPayload(in, entryType, depth + 1))
+          return false;
+      }
+    default:
+      return false;
+  }
+}
+
+// read a scalar payload, other types are skipped and leave value invalid
+bool NBTProjection::readValue(Reader &in, quint8 type, QVariant &value) {
+  quint8  v8;
+  quint16 v16;
+  quint32 v32;
+  quint64 v64;
+  switch (type) {
+    case Tag::TAG_BYTE:
+      if (!in.r8(v8)) return false;
+      value = qint64(qint8(v8));
+      return true;
+    case Tag::TAG_SHORT:
+      if (!in.r16(v16)) return false;
+      value = qint64(qint16(v16));
+      return true;
+    case Tag::TAG_INT:
+      if (!in.r32(v32)) return false;
+      value = qint64(qint32(v32));
+      return true;
+    case Tag::TAG_LONG:
+      if (!in.r64(v64)) return false;
+      value = qint64(v64);
+      return true;
+    case Tag::TAG_FLOAT: {
+      if (!in.r32(v32)) return false;
+      float f;
+      memcpy(&f, &v32, sizeof(f));
+      value = double(f);
+      return true;
+    }
+    case Tag::TAG_DOUBLE: {
+      if (!in.r64(v64)) return false;
+      double d;
+      memcpy(&d, &v64, sizeof(d));
+      value = d;
+      return true;
+    }
+    case Tag::TAG_STRING:
+      if (!in.r16(v16) || !in.need(v16)) return false;
+      value = QString::fromUtf8(reinterpret_cast<const char *>(in.data()), v16);
+      in.advance(v16);
+      return true;
+    default:
+      return skipPayload(in, type, 1);
+  }
+}
+
+// decode the complete Chunk and look the fields up in the Tag tree
+bool NBTProjection::scanFallback(const uchar *chunk) {
+  NBT nbt(chunk);
+  for (const Path &path : paths) {
+    if (values[path.field].isValid())
+      continue;
+    const QString first = QString::fromUtf8(path.keys.first());
+    if (!nbt.has(first))
+      continue;
+    const Tag *tag = nbt.at(first);
+    for (int k = 1; tag && (k < path.keys.size()); k++) {
+      const QString key = QString::fromUtf8(path.keys[k]);
+      tag = ((tag->getType() == Tag::TAG_COMPOUND) && tag->has(key)) ? tag->at(key) : NULL;
+    }
+    if (!tag)
+      continue;
+    switch (tag->getType()) {
+      case Tag::TAG_BYTE:
+      case Tag::TAG_SHORT:
+      case Tag::TAG_INT:
+      case Tag::TAG_LONG:
+        values[path.field] = qint64(tag->getData().toLongLong());
+        break;
+      case Tag::TAG_FLOAT:
+      case Tag::TAG_DOUBLE:
+        values[path.field] = tag->toDouble();
+        break;
+      case Tag::TAG_STRING:
+        values[path.field] = tag->toString();
+        break;
+    }
+  }
+  return true;
+}
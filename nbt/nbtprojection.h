@@ -0,0 +1,53 @@
+#ifndef NBTPROJECTION_H_
+#define NBTPROJECTION_H_
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+
+// Reads a few scalar fields of a compressed Chunk without building the Tag tree.
+//
+// The NBT stream is inflated incrementally and walked in place: only Compounds
+// on the way to a requested field are entered, all other payloads are skipped
+// without allocating anything, and inflating stops as soon as every field has
+// a value. Each field can have alternative paths, e.g. "Level/InhabitedTime"
+// (up to 1.17) and "InhabitedTime" (since 1.18), the first one found is used.
+// An NBTProjection can be reused for many Chunks, by one thread at a time.
+class NBTProjection {
+ public:
+  // add a field with its "/" separated alternative paths, returns the field index
+  int addField(const QStringList &paths);
+
+  // scan a Chunk as stored in a region file (length, compression format, data),
+  // returns false for unsupported or corrupted data
+  bool scan(const uchar *chunk);
+
+  bool    has(int field) const;
+  qint64  toLong(int field, qint64 defaultValue = 0) const;
+  QString toString(int field, const QString &defaultValue = QString()) const;
+
+ private:
+  class Reader;
+
+  struct Path {
+    int               field;
+    QList<QByteArray> keys;  // UTF-8, compared with the names in the stream
+  };
+
+  bool scanCompound(Reader &in, int depth, const QVector<int> &candidates);
+  bool scanFallback(const uchar *chunk);
+  static bool skipPayload(Reader &in, quint8 type, int depth);
+  static bool readValue(Reader &in, quint8 type, QVariant &value);
+
+  static const int MAX_DEPTH = 512;  // nesting limit against corrupted data
+
+  QVector<Path>     paths;
+  QVector<QVariant> values;   // per field, invalid when not found
+  int               pending = 0;  // fields still without value during scan()
+};
+
+#endif  // NBTPROJECTION_H_
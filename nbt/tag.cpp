@@ -7,6 +7,34 @@
 #include "nbt/nbt.h"
 
 
+// helper to write NBT binary data (big endian)
+
+static void w8(QByteArray &out, quint8 v) {
+  out.append(static_cast<char>(v));
+}
+
+static void w16(QByteArray &out, quint16 v) {
+  w8(out, v >> 8);
+  w8(out, v);
+}
+
+static void w32(QByteArray &out, quint32 v) {
+  w16(out, v >> 16);
+  w16(out, v);
+}
+
+static void w64(QByteArray &out, quint64 v) {
+  w32(out, v >> 32);
+  w32(out, v);
+}
+
+static void wutf8(QByteArray &out, const QString &str) {
+  QByteArray utf8 = str.toUtf8();
+  w16(out, utf8.size());
+  out.append(utf8);
+}
+
+
 Tag::Tag() {
 }
 
@@ -68,6 +96,13 @@ const QVariant Tag::getData() const {
   return QVariant();
 }
 
+quint8 Tag::getType() const {
+  return TAG_END;
+}
+
+void Tag::encode(QByteArray &) const {
+}
+
 
 // Tag_Byte
 
@@ -91,6 +126,14 @@ const QVariant Tag_Byte::getData() const {
   return data;
 }
 
+quint8 Tag_Byte::getType() const {
+  return TAG_BYTE;
+}
+
+void Tag_Byte::encode(QByteArray &out) const {
+  w8(out, data);
+}
+
 
 // Tag_Short
 
@@ -114,6 +157,14 @@ const QVariant Tag_Short::getData() const {
   return data;
 }
 
+quint8 Tag_Short::getType() const {
+  return TAG_SHORT;
+}
+
+void Tag_Short::encode(QByteArray &out) const {
+  w16(out, data);
+}
+
 
 // Tag_Int
 
@@ -137,6 +188,14 @@ const QVariant Tag_Int::getData() const {
   return data;
 }
 
+quint8 Tag_Int::getType() const {
+  return TAG_INT;
+}
+
+void Tag_Int::encode(QByteArray &out) const {
+  w32(out, data);
+}
+
 double Tag_Int::toDouble() const {
   return static_cast<double>(data);
 }
@@ -176,6 +235,14 @@ const QVariant Tag_Long::getData() const {
   return data;
 }
 
+quint8 Tag_Long::getType() const {
+  return TAG_LONG;
+}
+
+void Tag_Long::encode(QByteArray &out) const {
+  w64(out, data);
+}
+
 
 // Tag_Float
 
@@ -196,6 +263,16 @@ const QVariant Tag_Float::getData() const {
   return data;
 }
 
+quint8 Tag_Float::getType() const {
+  return TAG_FLOAT;
+}
+
+void Tag_Float::encode(QByteArray &out) const {
+  union {qint32 d; float f;} fl;
+  fl.f = data;
+  w32(out, fl.d);
+}
+
 
 // Tag_Double
 
@@ -213,6 +290,16 @@ const QVariant Tag_Double::getData() const {
   return data;
 }
 
+quint8 Tag_Double::getType() const {
+  return TAG_DOUBLE;
+}
+
+void Tag_Double::encode(QByteArray &out) const {
+  union {qint64 d; double f;} fl;
+  fl.f = data;
+  w64(out, fl.d);
+}
+
 const QString Tag_Double::toString() const {
   return QString::number(data);
 }
@@ -239,6 +326,17 @@ const QVariant Tag_Byte_Array::getData() const {
   return QByteArray(reinterpret_cast<const char*>(&data[0]), len);
 }
 
+quint8 Tag_Byte_Array::getType() const {
+  return TAG_BYTE_ARRAY;
+}
+
+void Tag_Byte_Array::encode(QByteArray &out) const {
+  const int size = static_cast<int>(data.size());  // data may be short on truncated input
+  w32(out, size);
+  if (size)
+    out.append(reinterpret_cast<const char*>(&data[0]), size);
+}
+
 const QString Tag_Byte_Array::toString() const {
   try {
     return QString::fromLatin1(reinterpret_cast<const char *>(&data[0]));
@@ -263,6 +361,14 @@ const QVariant Tag_String::getData() const {
   return data;
 }
 
+quint8 Tag_String::getType() const {
+  return TAG_STRING;
+}
+
+void Tag_String::encode(QByteArray &out) const {
+  wutf8(out, data);
+}
+
 
 // Tag_List
 
@@ -329,6 +435,18 @@ const QVariant Tag_List::getData() const {
   return lst;
 }
 
+quint8 Tag_List::getType() const {
+  return TAG_LIST;
+}
+
+void Tag_List::encode(QByteArray &out) const {
+  // type of empty lists is invalid anyway
+  w8(out, data.isEmpty() ? static_cast<quint8>(TAG_END) : data.first()->getType());
+  w32(out, data.count());
+  for (auto i = data.constBegin(); i != data.constEnd(); i++)
+    (*i)->encode(out);
+}
+
 
 // Tag_Compound
 
@@ -395,6 +513,23 @@ const QVariant Tag_Compound::getData() const {
   return map;
 }
 
+quint8 Tag_Compound::getType() const {
+  return TAG_COMPOUND;
+}
+
+void Tag_Compound::encode(QByteArray &out) const {
+  for (auto i = children.constBegin(); i != children.constEnd(); i++) {
+    w8(out, i.value()->getType());
+    wutf8(out, i.key());
+    i.value()->encode(out);
+  }
+  w8(out, TAG_END);
+}
+
+QList<QString> Tag_Compound::keys() const {
+  return children.keys();
+}
+
 
 // Tag_Int_Array
 
@@ -432,6 +567,16 @@ const QVariant Tag_Int_Array::getData() const {
   return ret;
 }
 
+quint8 Tag_Int_Array::getType() const {
+  return TAG_INT_ARRAY;
+}
+
+void Tag_Int_Array::encode(QByteArray &out) const {
+  w32(out, len);
+  for (int i = 0; i < len; ++i)
+    w32(out, data[i]);
+}
+
 
 // Tag_Long_Array
 
@@ -468,3 +613,13 @@ const QVariant Tag_Long_Array::getData() const {
 
   return ret;
 }
+
+quint8 Tag_Long_Array::getType() const {
+  return TAG_LONG_ARRAY;
+}
+
+void Tag_Long_Array::encode(QByteArray &out) const {
+  w32(out, len);
+  for (int i = 0; i < len; ++i)
+    w64(out, data[i]);
+}
@@ -2,6 +2,7 @@
 #define TAG_H
 
 #include <vector>
+#include <QByteArray>
 #include <QString>
 #include <QVariant>
 
@@ -25,6 +26,10 @@ class Tag {
   virtual const std::vector<qint64> & toLongArray() const;
   virtual const QVariant              getData() const;
 
+  // write payload in NBT binary format (without type and name)
+  virtual quint8                      getType() const;
+  virtual void                        encode(QByteArray &out) const;
+
   enum TagType {
     TAG_END        = 0,
     TAG_BYTE       = 1,
@@ -53,6 +58,8 @@ class Tag_Byte : public Tag {
   unsigned int   toUInt() const;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   quint8 data;
 };
@@ -65,6 +72,8 @@ class Tag_Short : public Tag {
   unsigned int   toUInt() const;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   qint16 data;
 };
@@ -78,6 +87,8 @@ class Tag_Int : public Tag {
   double         toDouble() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   qint32 data;
 };
@@ -93,6 +104,8 @@ class Tag_Long : public Tag {
   double         toDouble() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   qint64 data;
 };
@@ -104,6 +117,8 @@ class Tag_Float : public Tag {
   double         toDouble() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
 
  private:
   float data;
@@ -116,6 +131,8 @@ class Tag_Double : public Tag {
   double         toDouble() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   double data;
 };
@@ -128,6 +145,8 @@ class Tag_Byte_Array : public Tag {
   const std::vector<quint8>& toByteArray() const override;
   const QString              toString() const override;
   const QVariant             getData() const override;
+  quint8                     getType() const override;
+  void                       encode(QByteArray &out) const override;
  private:
   std::vector<quint8> data;
   int len;
@@ -139,6 +158,8 @@ class Tag_String : public Tag {
 
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   QString data;
 };
@@ -152,6 +173,8 @@ class Tag_List : public Tag {
   int            length() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
  private:
   QList<Tag *> data;
 };
@@ -166,6 +189,9 @@ class Tag_Compound : public Tag {
   int            length() const override;
   const QString  toString() const override;
   const QVariant getData() const override;
+  quint8         getType() const override;
+  void           encode(QByteArray &out) const override;
+  QList<QString> keys() const;
  private:
   QHash<QString, Tag *> children;
 };
@@ -178,6 +204,8 @@ class Tag_Int_Array : public Tag {
   const std::vector<qint32>& toIntArray() const override;
   const QString              toString() const override;
   const QVariant             getData() const override;
+  quint8                     getType() const override;
+  void                       encode(QByteArray &out) const override;
  private:
   int len;
   std::vector<qint32> data;
@@ -191,6 +219,8 @@ class Tag_Long_Array : public Tag {
   const std::vector<qint64>& toLongArray() const override;
   const QString              toString() const override;
   const QVariant             getData() const override;
+  quint8                     getType() const override;
+  void                       encode(QByteArray &out) const override;
  private:
   int len;
   std::vector<qint64> data;
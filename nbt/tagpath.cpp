@@ -0,0 +1,76 @@
+#include "nbt/tagpath.h"
+#include "nbt/tag.h"
+
+#include <QStringList>
+
+
+TagPath::TagPath(const QString &path) {
+  const QStringList elements = path.split("/", Qt::SkipEmptyParts);
+  steps.reserve(elements.size());
+  for (const QString &element : elements) {
+    Step step = {element, -1};
+    if (element.startsWith('[') && element.endsWith(']')) {
+      bool ok = false;
+      int index = element.mid(1, element.size() - 2).toInt(&ok);
+      if (ok && (index >= 0))
+        step.index = index;
+    }
+    steps.append(step);
+  }
+}
+
+const Tag *TagPath::resolve(const Tag *root) const {
+  const Tag *tag = root;
+  for (const Step &step : steps) {
+    if (!tag)
+      return nullptr;
+    if (step.index >= 0) {
+      if ((tag->getType() != Tag::TAG_LIST) || (step.index >= tag->length()))
+        return nullptr;
+      tag = tag->at(step.index);
+    } else {
+      if ((tag->getType() != Tag::TAG_COMPOUND) || !tag->has(step.key))
+        return nullptr;
+      tag = tag->at(step.key);
+    }
+  }
+  return tag;
+}
+
+QString TagPath::toString(const Tag *root, const QString &defaultValue) const {
+  const Tag *tag = resolve(root);
+  if (!tag)
+    return defaultValue;
+  return valueString(tag);
+}
+
+qint32 TagPath::toInt(const Tag *root, qint32 defaultValue) const {
+  const Tag *tag = resolve(root);
+  switch (tag ? tag->getType() : Tag::TAG_END) {
+    case Tag::TAG_BYTE:
+    case Tag::TAG_SHORT:
+    case Tag::TAG_INT:
+    case Tag::TAG_LONG:
+      return tag->toInt();
+    case Tag::TAG_FLOAT:
+    case Tag::TAG_DOUBLE:
+      return static_cast<qint32>(tag->toDouble());
+    default:
+      return defaultValue;
+  }
+}
+
+QString TagPath::valueString(const Tag *tag) {
+  switch (tag ? tag->getType() : Tag::TAG_END) {
+    case Tag::TAG_BYTE:
+    case Tag::TAG_SHORT:
+    case Tag::TAG_INT:
+    case Tag::TAG_LONG:
+    case Tag::TAG_FLOAT:
+    case Tag::TAG_DOUBLE:
+    case Tag::TAG_STRING:
+      return tag->getData().toString();
+    default:
+      return QString();
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef TAGPATH_H_
+#define TAGPATH_H_
+
+#include <QString>
+#include <QVector>
+
+class Tag;
+
+
+// Path to a Tag inside an NBT tree, parsed once and evaluated against many trees.
+// Elements are separated by "/", list elements are addressed as "[n]":
+//   "VillagerData/profession", "Offers/Recipes/[0]/sell/id"
+class TagPath {
+ public:
+  explicit TagPath(const QString &path);
+
+  const Tag * resolve(const Tag *root) const;  // nullptr when not present
+  QString     toString(const Tag *root, const QString &defaultValue = QString()) const;
+  qint32      toInt(const Tag *root, qint32 defaultValue = 0) const;
+
+  static QString valueString(const Tag *tag);  // value of scalar Tags, empty otherwise
+
+ private:
+  struct Step {
+    QString key;
+    int     index;  // >= 0 for list elements
+  };
+  QVector<Step> steps;
+};
+
+#endif  // TAGPATH_H_
@@ -23,8 +23,6 @@ QSharedPointer<OverlayItem> Entity::TryParse(const Tag* tag) {
       QString type = id->toString().toLower().remove("minecraft:");
       EntityInfo const & info = ei.getEntityInfo(type);
 
-      QMap<QString, QVariant> props = tag->getData().toMap();
-
       // get something more descriptive if its an item
       if (type == "item") {
         auto itemId = tag->at("Item")->at("id");
@@ -40,13 +38,13 @@ QSharedPointer<OverlayItem> Entity::TryParse(const Tag* tag) {
       entity->setType("Entity." + info.category);
       entity->setColor(info.brushColor);
       entity->setExtraColor(info.penColor);
-      entity->setProperties(props);
+      entity->setProperties(tag);
 
       // parse POI of villagers / PiglinBrutes
-      if (props.contains("Brain")) {
-        QMap<QString, QVariant> brain = props["Brain"].toMap();
-        if (brain.contains("memories")) {
-          QMap<QString, QVariant> memories = brain["memories"].toMap();
+      if (tag->has("Brain")) {
+        auto brain = tag->at("Brain");
+        if (brain->has("memories")) {
+          auto memories = brain->at("memories");
           // home is location of bed
           entity->tryParseMemory(memories, "minecraft:home",               QColor(0,0,255));
 
@@ -65,19 +63,24 @@ QSharedPointer<OverlayItem> Entity::TryParse(const Tag* tag) {
   return ret;
 }
 
-void Entity::tryParseMemory(const QMap<QString, QVariant> &memories,
+void Entity::tryParseMemory(const Tag *memories,
                             const QString memory,
                             QColor color) {
-  if (memories.contains(memory)) {
-    QMap<QString, QVariant> location = memories[memory].toMap();
-    QList<QVariant> pos;
-    if (location.contains("value")) {
-      QMap<QString, QVariant> value = location["value"].toMap();
-      pos = value["pos"].toList();
-    } else if (location.contains("pos")) {
-      pos = location["pos"].toList();
+  if (memories->has(memory)) {
+    auto location = memories->at(memory);
+    const Tag *pos;
+    if (location->at("value")->has("pos")) {
+      pos = location->at("value")->at("pos");
+    } else if (location->has("pos")) {
+      pos = location->at("pos");
     } else return;
-    POI p(pos[0].toInt(), pos[2].toInt());
+    if (pos->length() < 3) return;
+    // position is stored as Int_Array, but be graceful with List of Int
+    POI p;
+    if (pos->getType() == Tag::TAG_INT_ARRAY)
+      p = POI(pos->toIntArray()[0], pos->toIntArray()[2]);
+    else
+      p = POI(pos->at(0)->toInt(), pos->at(2)->toInt());
     p.color = color;
     this->poiList.append(p);
   }
@@ -133,3 +136,7 @@ void Entity::draw(double offsetX, double offsetZ, double scale,
 Entity::Point Entity::midpoint() const {
   return pos;
 }
+
+Entity::Cuboid Entity::bounds() const {
+  return Cuboid(pos, pos);
+}
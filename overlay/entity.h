@@ -17,6 +17,7 @@ class Entity: public OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                     QPainter *canvas) const;
   virtual Point midpoint() const;
+  virtual Cuboid bounds() const;
   void setExtraColor(const QColor& c) {extraColor = c;}
 
   static const int RADIUS = 5;
@@ -38,7 +39,7 @@ class Entity: public OverlayItem {
   };
   QList<POI> poiList;
 
-  void tryParseMemory(const QMap<QString, QVariant> &memories, const QString memory, QColor color);
+  void tryParseMemory(const Tag *memories, const QString memory, QColor color);
 };
 
 #endif  // ENTITY_H_
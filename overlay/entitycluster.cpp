@@ -0,0 +1,71 @@
+#include <QPainter>
+#include <algorithm>
+
+#include "overlay/entitycluster.h"
+#include "overlay/entity.h"
+
+EntityCluster::EntityCluster(const QString &type, const QColor &color)
+    : num(0)
+{
+  setType(type);
+  setColor(color);
+}
+
+void EntityCluster::add(const QSharedPointer<OverlayItem> &entity) {
+  // merging another cluster keeps its count and covered area
+  const EntityCluster *cluster = dynamic_cast<const EntityCluster*>(entity.data());
+  const int   n = cluster ? cluster->num : 1;
+  const Point s = cluster ? cluster->sum : entity->midpoint();
+  const Cuboid b = cluster ? cluster->bounds() : Cuboid(s, s);
+  if (num == 0) {
+    min = b.min;
+    max = b.max;
+  } else {
+    min = Point(std::min(min.x, b.min.x), std::min(min.y, b.min.y), std::min(min.z, b.min.z));
+    max = Point(std::max(max.x, b.max.x), std::max(max.y, b.max.y), std::max(max.z, b.max.z));
+  }
+  sum = Point(sum.x + s.x, sum.y + s.y, sum.z + s.z);
+  num += n;
+  setDisplay(QString("%1 Entities").arg(num));
+}
+
+bool EntityCluster::intersects(const OverlayItem::Cuboid& cuboid) const {
+  return cuboid.min.x <= max.x && min.x <= cuboid.max.x &&
+         cuboid.min.y <= max.y && min.y <= cuboid.max.y &&
+         cuboid.min.z <= max.z && min.z <= cuboid.max.z;
+}
+
+void EntityCluster::draw(double offsetX, double offsetZ, double scale,
+                         QPainter *canvas) const {
+  const Point pos = midpoint();
+  QPoint center((pos.x - offsetX) * scale,
+                (pos.z - offsetZ) * scale);
+
+  QColor penColor = color().darker();
+  penColor.setAlpha(192);
+  QPen pen = canvas->pen();
+  pen.setColor(penColor);
+  pen.setWidth(2);
+  canvas->setPen(pen);
+
+  QColor brushColor = color();
+  brushColor.setAlpha(160);
+  canvas->setBrush(brushColor);
+  canvas->drawEllipse(center, Entity::RADIUS, Entity::RADIUS);
+
+  // number of Entities next to the marker
+  if (num < 2)
+    return;
+  canvas->setPen(Qt::black);
+  canvas->drawText(center + QPoint(Entity::RADIUS + 1, Entity::RADIUS), QString::number(num));
+}
+
+EntityCluster::Point EntityCluster::midpoint() const {
+  if (num == 0)
+    return Point();
+  return Point(sum.x / num, sum.y / num, sum.z / num);
+}
+
+EntityCluster::Cuboid EntityCluster::bounds() const {
+  return Cuboid(min, max);
+}
@@ -0,0 +1,29 @@
+#ifndef ENTITYCLUSTER_H_
+#define ENTITYCLUSTER_H_
+
+#include <QSharedPointer>
+#include "overlay/overlayitem.h"
+
+// Aggregate of all Entities of one type inside a Chunk (or Region).
+// Used instead of the individual Entities when zoomed out far,
+// drawn as a single marker with the number of Entities.
+class EntityCluster: public OverlayItem {
+ public:
+  EntityCluster(const QString &type, const QColor &color);
+
+  void add(const QSharedPointer<OverlayItem> &entity);
+  int  count() const { return num; }
+
+  virtual bool intersects(const OverlayItem::Cuboid& cuboid) const;
+  virtual void draw(double offsetX, double offsetZ, double scale,
+                    QPainter *canvas) const;
+  virtual Point midpoint() const;
+  virtual Cuboid bounds() const;
+
+ private:
+  int   num;
+  Point sum;       // to calculate the average position
+  Point min, max;  // covered area
+};
+
+#endif  // ENTITYCLUSTER_H_
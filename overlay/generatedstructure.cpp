@@ -17,9 +17,7 @@ GeneratedStructure::tryParseDatFile(const Tag* data) {
   if (data && data != &NBT::Null) {
     auto features = data->at("Features");
     if (features && features != &NBT::Null) {
-      // convert the features to a qvariant here
-      QVariant maybeFeatureMap = features->getData();
-      ret.append( GeneratedStructure::tryParseFeatures(maybeFeatureMap) );
+      ret.append( GeneratedStructure::tryParseFeatures(features) );
     }
   }
   return ret;
@@ -38,9 +36,7 @@ GeneratedStructure::tryParseChunk(const Tag* structuresTag) {
       starts = "starts";
     auto features = structuresTag->at(starts);
     if (features && features != &NBT::Null) {
-      // convert the features to a qvariant here
-      QVariant maybeFeatureMap = features->getData();
-      ret.append( GeneratedStructure::tryParseFeatures(maybeFeatureMap) );
+      ret.append( GeneratedStructure::tryParseFeatures(features) );
     }
   }
   return ret;
@@ -127,9 +123,7 @@ GeneratedStructure::tryParseSpawner(const Tag* tagSpawner) {
   spawner->setColor(color);
 
   // fill properties
-  const Tag_Compound * tc = static_cast<const Tag_Compound *>(tagSpawner);
-  QMap<QString, QVariant> spawnerProperties = tc->getData().toMap();
-  spawner->setProperties(spawnerProperties);
+  spawner->setProperties(tagSpawner);
 
   // get covered area
   int x = tagSpawner->at("x")->toInt();
@@ -143,49 +137,42 @@ GeneratedStructure::tryParseSpawner(const Tag* tagSpawner) {
   return spawner;
 }
 
+// read bounding box given as Int_Array (or List of Int in older versions)
+static bool tryParseBB(const Tag* bb, int out[6]) {
+  if (bb->getType() == Tag::TAG_INT_ARRAY) {
+    if (bb->length() != 6) return false;
+    const std::vector<qint32> &values = bb->toIntArray();
+    for (int i = 0; i < 6; i++)
+      out[i] = values[i];
+    return true;
+  }
+  if (bb->getType() == Tag::TAG_LIST) {
+    if (bb->length() != 6) return false;
+    for (int i = 0; i < 6; i++)
+      out[i] = bb->at(i)->toInt();
+    return true;
+  }
+  return false;
+}
+
 // static
 QList<QSharedPointer<GeneratedStructure>>
-GeneratedStructure::tryParseFeatures(QVariant &maybeFeatureMap) {
+GeneratedStructure::tryParseFeatures(const Tag* features) {
   // we will return a list of all found structures
   QList<QSharedPointer<GeneratedStructure>> ret;
 
   // check if we got a map
-  if ((QMetaType::Type)maybeFeatureMap.type() == QMetaType::QVariantMap) {
-    // convert it to a real map
-    QMap<QString, QVariant> featureMap = maybeFeatureMap.toMap();
-
+  auto featureMap = dynamic_cast<const Tag_Compound*>(features);
+  if (featureMap) {
     // loop over all elements in feature map
-    for (auto &feature : featureMap) {
+    for (auto &key : featureMap->keys()) {
+      const Tag* feature = featureMap->at(key);
       // check if the element is also a map
-      if ((QMetaType::Type)feature.type() == QMetaType::QVariantMap) {
-        // convert it to a real map
-        QMap<QString, QVariant> featureProperties = feature.toMap();
-
+      if (feature->getType() == Tag::TAG_COMPOUND) {
         // check for required properties
-        if (featureProperties.contains("id") && featureProperties["id"].toString() != "INVALID") {
+        if (feature->has("id") && feature->at("id")->toString() != "INVALID") {
           // parse id
-          QString id = featureProperties["id"].toString();
-
-          GeneratedStructure* structure = new GeneratedStructure();
-          structure->setType("Structure." + id);
-          structure->setDisplay(id);
-          structure->setProperties(featureProperties);
-
-          // base the color on a hash of its type
-          int    hue = qHash(id, 0) % 360;
-          QColor color;
-          color.setHsv(hue, 255, 255, 64);
-          structure->setColor(color);
-
-          // this will have to be maintained if new structures are added
-          // that are appearing only in some Dimensions
-          if (structure->type() == "Structure.Fortress") {
-            structure->setDimension("nether");
-          } else if (structure->type() == "Structure.EndCity") {
-            structure->setDimension("end");
-          } else {
-            structure->setDimension("overworld");
-          }
+          QString id = feature->at("id")->toString();
 
           // get covered area
           int minX = INT_MAX;
@@ -194,40 +181,34 @@ GeneratedStructure::tryParseFeatures(QVariant &maybeFeatureMap) {
           int maxX = INT_MIN;
           int maxY = INT_MIN;
           int maxZ = INT_MIN;
+          int bb[6];
           // covered area is given directly in feature (<1.17)
-          if (featureProperties.contains("BB") &&
-              (QMetaType::Type)featureProperties["BB"].type() == QMetaType::QVariantList ) {
+          const quint8 bbType = feature->at("BB")->getType();
+          if ((bbType == Tag::TAG_INT_ARRAY) || (bbType == Tag::TAG_LIST)) {
             // parse Bounding Box
-            QList<QVariant> bb = featureProperties["BB"].toList();
-            if (bb.size() == 6) {
-              minX = bb[0].toInt();
-              minY = bb[1].toInt();
-              minZ = bb[2].toInt();
-              maxX = bb[3].toInt();
-              maxY = bb[4].toInt();
-              maxZ = bb[5].toInt();
+            if (tryParseBB(feature->at("BB"), bb)) {
+              minX = bb[0];
+              minY = bb[1];
+              minZ = bb[2];
+              maxX = bb[3];
+              maxY = bb[4];
+              maxZ = bb[5];
             }
           } else {
             // covered area is given in Children only (starting with 1.17)
-            if (featureProperties.contains("Children")) {
+            if (feature->has("Children")) {
               // loop over all elements in Children
-              auto children = featureProperties["Children"];
-              if ((QMetaType::Type)children.type() == QMetaType::QVariantList)
-                for (auto &child : children.toList()) {
-                  if ( (QMetaType::Type)child.type() == QMetaType::QVariantMap ) {
-                    QMap<QString, QVariant> childMap = child.toMap();
-                    if (childMap.contains("BB") &&
-                        ( QMetaType::Type)childMap["BB"].type() == QMetaType::QVariantList ) {
-                      QList<QVariant> bb = childMap["BB"].toList();
-                      if (bb.size() == 6) {
-                        minX = std::min<int>(minX, bb[0].toInt());
-                        minY = std::min<int>(minY, bb[1].toInt());
-                        minZ = std::min<int>(minZ, bb[2].toInt());
-                        maxX = std::max<int>(maxX, bb[3].toInt());
-                        maxY = std::max<int>(maxY, bb[4].toInt());
-                        maxZ = std::max<int>(maxZ, bb[5].toInt());
-                      }
-                    }
+              auto children = feature->at("Children");
+              if (children->getType() == Tag::TAG_LIST)
+                for (int c = 0; c < children->length(); c++) {
+                  const Tag* child = children->at(c);
+                  if (child->has("BB") && tryParseBB(child->at("BB"), bb)) {
+                    minX = std::min<int>(minX, bb[0]);
+                    minY = std::min<int>(minY, bb[1]);
+                    minZ = std::min<int>(minZ, bb[2]);
+                    maxX = std::max<int>(maxX, bb[3]);
+                    maxY = std::max<int>(maxY, bb[4]);
+                    maxZ = std::max<int>(maxZ, bb[5]);
                   }
                 }
             }
@@ -236,6 +217,27 @@ GeneratedStructure::tryParseFeatures(QVariant &maybeFeatureMap) {
           // Only add the structure if it has a non-zero bounding box.
           // This removes Terralith's bogus zpointer nonsense.
           if (minX != maxX || minY != maxY || minZ != maxZ) {
+            GeneratedStructure* structure = new GeneratedStructure();
+            structure->setType("Structure." + id);
+            structure->setDisplay(id);
+            structure->setProperties(feature);
+
+            // base the color on a hash of its type
+            int    hue = qHash(id, 0) % 360;
+            QColor color;
+            color.setHsv(hue, 255, 255, 64);
+            structure->setColor(color);
+
+            // this will have to be maintained if new structures are added
+            // that are appearing only in some Dimensions
+            if (structure->type() == "Structure.Fortress") {
+              structure->setDimension("nether");
+            } else if (structure->type() == "Structure.EndCity") {
+              structure->setDimension("end");
+            } else {
+              structure->setDimension("overworld");
+            }
+
             structure->setBounds( Point(minX, minY, minZ), Point(maxX, maxY, maxZ));
             ret.append( QSharedPointer<GeneratedStructure>(structure) );
           }
@@ -273,3 +275,7 @@ void GeneratedStructure::draw(double offsetX, double offsetZ, double scale,
 GeneratedStructure::Point GeneratedStructure::midpoint() const {
   return Point((p1.x + p2.x) / 2, (p1.y + p2.y) / 2, (p1.z + p2.z) / 2);
 }
+
+GeneratedStructure::Cuboid GeneratedStructure::bounds() const {
+  return Cuboid(p1, p2);
+}
@@ -19,13 +19,14 @@ class GeneratedStructure: public OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                    QPainter *canvas) const;
   virtual Point midpoint() const;
+  virtual Cuboid bounds() const;
 
  protected:
   GeneratedStructure() {}
 
   static QSharedPointer<GeneratedStructure> tryParseChest(const Tag* tagChest);
   static QSharedPointer<GeneratedStructure> tryParseSpawner(const Tag* tagSpawner);
-  static QList<QSharedPointer<GeneratedStructure>> tryParseFeatures(QVariant &maybeFeatureMap);
+  static QList<QSharedPointer<GeneratedStructure>> tryParseFeatures(const Tag* features);
 
   // these are used to draw a rounded rect. If you want to draw something
   // else, override draw()
@@ -36,4 +37,6 @@ class GeneratedStructure: public OverlayItem {
   Point p1, p2;
 };
 
+typedef QList<QSharedPointer<GeneratedStructure>> GeneratedStructureList;
+
 #endif  // GENERATEDSTRUCTURE_H_
@@ -0,0 +1,33 @@
+#include "overlay/overlayitem.h"
+#include "nbt/tag.h"
+#include "nbt/tagdatastream.h"
+
+
+// Properties are only needed for the properties view and searches.
+// They are kept as NBT binary data, which is much more compact than the
+// nested QVariant maps (especially for Entities with inventories, brains, ...).
+
+QVariant OverlayItem::properties() const {
+  if (itemProperties.isEmpty())
+    return QVariant();
+
+  TagDataStream s(itemProperties.constData(), itemProperties.size());
+  Tag_Compound tag(&s);
+  return tag.getData();
+}
+
+QSharedPointer<const Tag> OverlayItem::propertiesTag() const {
+  if (itemProperties.isEmpty())
+    return QSharedPointer<const Tag>();
+
+  TagDataStream s(itemProperties.constData(), itemProperties.size());
+  return QSharedPointer<const Tag>(new Tag_Compound(&s));
+}
+
+void OverlayItem::setProperties(const Tag* tag) {
+  itemProperties.clear();
+  if (tag && (tag->getType() == Tag::TAG_COMPOUND)) {
+    tag->encode(itemProperties);
+    itemProperties.squeeze();
+  }
+}
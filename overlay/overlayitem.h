@@ -2,12 +2,15 @@
 #ifndef OVERLAYITEM_H_
 #define OVERLAYITEM_H_
 
+#include <QByteArray>
 #include <QColor>
+#include <QSharedPointer>
 #include <QString>
 #include <QVariant>
 #include <QVector3D>
 
 class QPainter;
+class Tag;
 
 class OverlayItem {
  public:
@@ -31,21 +34,23 @@ class OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                     QPainter *canvas) const = 0;
   virtual Point midpoint() const = 0;
+  virtual Cuboid bounds() const = 0;
   const QString& type() const {return itemType;}
   const QString& display() const { return itemDescription;}
-  const QVariant& properties() const { return itemProperties;}
+  QVariant properties() const;  // decoded on demand
+  QSharedPointer<const Tag> propertiesTag() const;  // decoded on demand, without QVariant conversion
   const QColor& color() const { return itemColor; }
   const QString& dimension() const { return itemDimension; }
 
  protected:
-  void setProperties(const QVariant& props) {itemProperties = props;}
+  void setProperties(const Tag* tag);
   void setColor(const QColor& c) {itemColor = c;}
   void setDimension(const QString& d) {itemDimension = d;}
   void setDisplay(const QString& d) {itemDescription = d;}
   void setType(const QString& t) {itemType = t;}
 
  private:
-  QVariant itemProperties;
+  QByteArray itemProperties;  // compound payload in NBT binary format
   QColor itemColor;
   QString itemDimension;
   QString itemType;
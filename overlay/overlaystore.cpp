@@ -0,0 +1,53 @@
+#include "overlay/overlaystore.h"
+
+
+bool OverlayStore::insert(const ItemT &item) {
+  TypeBucket &bucket = buckets[item->type()];
+
+  // test if item is already present
+  const OverlayItem::Point p = item->midpoint();
+  const PositionKey key = {p.x, p.y, p.z};
+  if (bucket.positions.contains(key))
+    return false;
+  bucket.positions.insert(key);
+  count++;
+
+  // add item to all grid cells it covers
+  const OverlayItem::Cuboid b = item->bounds();
+  const int cx1 = toCell(b.min.x);
+  const int cz1 = toCell(b.min.z);
+  const int cx2 = toCell(b.max.x);
+  const int cz2 = toCell(b.max.z);
+  if ((cx2 - cx1 >= MAX_CELL_SPAN) || (cz2 - cz1 >= MAX_CELL_SPAN)) {
+    bucket.oversized.append(item);
+    return true;
+  }
+  for (int cz = cz1; cz <= cz2; cz++)
+    for (int cx = cx1; cx <= cx2; cx++)
+      bucket.cells[CellID(cx, cz)].append(item);
+
+  return true;
+}
+
+void OverlayStore::clear() {
+  buckets.clear();
+  count = 0;
+}
+
+bool OverlayStore::isEmpty() const {
+  return (count == 0);
+}
+
+int OverlayStore::size() const {
+  return count;
+}
+
+QList<QString> OverlayStore::types() const {
+  return buckets.keys();
+}
+
+OverlayStore::ItemListT OverlayStore::query(const QString &type, const OverlayItem::Cuboid &cuboid) const {
+  ItemListT ret;
+  forEach(type, cuboid, [&ret](const ItemT &item) { ret.append(item); });
+  return ret;
+}
@@ -0,0 +1,127 @@
+#ifndef OVERLAYSTORE_H_
+#define OVERLAYSTORE_H_
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <algorithm>
+#include <cmath>
+
+#include "overlay/overlayitem.h"
+
+// Storage for all OverlayItems shown on the map, grouped by their type.
+// Items are deduplicated by a hash on (type, midpoint) and indexed in a coarse
+// grid with Region sized cells, so that drawing and hovering only have to test
+// the items close to the viewed area instead of every item of a type.
+class OverlayStore {
+ public:
+  typedef QSharedPointer<OverlayItem> ItemT;
+  typedef QList<ItemT>                ItemListT;
+
+  bool insert(const ItemT &item);  // returns false when item is already present
+  void clear();
+  bool isEmpty() const;
+  int  size() const;
+  QList<QString> types() const;
+
+  // call fn(item) for every item of given type intersecting the cuboid
+  template<typename FunctionT>
+  void forEach(const QString &type, const OverlayItem::Cuboid &cuboid, FunctionT fn) const;
+
+  ItemListT query(const QString &type, const OverlayItem::Cuboid &cuboid) const;
+
+  static const int CELL_SHIFT    = 9;   // 512 Blocks = one Region per cell
+  static const int MAX_CELL_SPAN = 16;  // items spanning more cells are not gridded
+
+ private:
+  typedef QPair<int, int> CellID;
+
+  struct PositionKey {
+    double x, y, z;
+    bool operator==(const PositionKey &other) const {
+      return (x == other.x) && (y == other.y) && (z == other.z);
+    }
+  };
+  friend unsigned int qHash(const PositionKey &key);
+
+  struct TypeBucket {
+    QSet<PositionKey>        positions;  // midpoints of all items (deduplication)
+    QHash<CellID, ItemListT> cells;      // spatial grid
+    ItemListT                oversized;  // items too large for the grid
+  };
+
+  static int toCell(double v) {
+    return static_cast<int>(std::floor(v)) >> CELL_SHIFT;
+  }
+
+  template<typename FunctionT>
+  static void visitCell(const CellID &cell, const ItemListT &items,
+                        int qx1, int qz1,
+                        const OverlayItem::Cuboid &cuboid, FunctionT &fn);
+
+  QHash<QString, TypeBucket> buckets;
+  int count = 0;
+};
+
+
+inline unsigned int qHash(const OverlayStore::PositionKey &key) {
+  return static_cast<unsigned int>(qHash(key.x) ^ (qHash(key.y) << 1) ^ (qHash(key.z) << 2));
+}
+
+
+template<typename FunctionT>
+void OverlayStore::visitCell(const CellID &cell, const ItemListT &items,
+                             int qx1, int qz1,
+                             const OverlayItem::Cuboid &cuboid, FunctionT &fn) {
+  for (const auto &item : items) {
+    // items covering several cells are reported only in their first cell inside the query
+    const OverlayItem::Cuboid b = item->bounds();
+    if ((cell.first  != std::max(qx1, toCell(b.min.x))) ||
+        (cell.second != std::max(qz1, toCell(b.min.z))))
+      continue;
+    if (item->intersects(cuboid))
+      fn(item);
+  }
+}
+
+template<typename FunctionT>
+void OverlayStore::forEach(const QString &type, const OverlayItem::Cuboid &cuboid, FunctionT fn) const {
+  auto bucketIt = buckets.constFind(type);
+  if (bucketIt == buckets.constEnd())
+    return;
+  const TypeBucket &bucket = bucketIt.value();
+
+  for (const auto &item : bucket.oversized) {
+    if (item->intersects(cuboid))
+      fn(item);
+  }
+
+  const int qx1 = toCell(cuboid.min.x);
+  const int qz1 = toCell(cuboid.min.z);
+  const int qx2 = toCell(cuboid.max.x);
+  const int qz2 = toCell(cuboid.max.z);
+
+  const qint64 area = qint64(qx2 - qx1 + 1) * qint64(qz2 - qz1 + 1);
+  if (area > bucket.cells.size()) {
+    // less occupied cells than queried -> iterate over occupied ones
+    for (auto it = bucket.cells.constBegin(); it != bucket.cells.constEnd(); ++it) {
+      const CellID &cell = it.key();
+      if ((cell.first  >= qx1) && (cell.first  <= qx2) &&
+          (cell.second >= qz1) && (cell.second <= qz2))
+        visitCell(cell, it.value(), qx1, qz1, cuboid, fn);
+    }
+  } else {
+    for (int cz = qz1; cz <= qz2; cz++) {
+      for (int cx = qx1; cx <= qx2; cx++) {
+        auto it = bucket.cells.constFind(CellID(cx, cz));
+        if (it != bucket.cells.constEnd())
+          visitCell(it.key(), it.value(), qx1, qz1, cuboid, fn);
+      }
+    }
+  }
+}
+
+#endif  // OVERLAYSTORE_H_
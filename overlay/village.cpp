@@ -30,7 +30,7 @@ Village::tryParseDatFile(const Tag* tag, const QString& dimension) {
         color.setHsv(hue % 360, 255, 255, 64);
         newVillage->setColor(color);
 
-        newVillage->setProperties(village->getData());
+        newVillage->setProperties(village);
         newVillage->setDimension(dimension);
         ret.append(QSharedPointer<GeneratedStructure>(newVillage));
       }
@@ -35,6 +35,9 @@ PngExport::PngExport(QWidget *parent)
     snapDistance = 512;
     ui->radioButton_region->setChecked(true);
   }
+  ui->comboBox_scale->setCurrentIndex(settings.value("PNGExportScale", 0).toInt());
+  connect(ui->comboBox_scale, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          this, [](int index) { QSettings().setValue("PNGExportScale", index); });
 }
 
 PngExport::~PngExport()
@@ -155,3 +158,6 @@ int PngExport::getRight() const  { return ui->spinBox_right ->value(); }
 
 bool PngExport::getChunkChecker() const  { return ui->checkBox_chunk ->checkState(); }
 bool PngExport::getRegionChecker() const { return ui->checkBox_region->checkState(); }
+
+// combo box entries are 1:1, 1:2, 1:4, ... Blocks per pixel
+int PngExport::getScale() const { return 1 << ui->comboBox_scale->currentIndex(); }
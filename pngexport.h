@@ -27,6 +27,8 @@ public:
   bool getChunkChecker() const;
   bool getRegionChecker() const;
 
+  int  getScale() const;
+
 private:
   Ui::PngExport *ui;
 
@@ -0,0 +1,165 @@
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#include "regionfile.h"
+#include "chunk.h"
+#include "chunkloader.h"
+#include "nbt/nbt.h"
+#include "nbt/nbtprojection.h"
+
+static const int headerSize = 8192;  // 4096 Bytes locations + 4096 Bytes timestamps
+
+
+RegionFile::RegionFile(const QString &filename)
+  : file(filename)
+  , header(NULL)
+  , opened(false)
+{}
+
+RegionFile::~RegionFile() {
+  if (header)
+    file.unmap(header);
+  file.close();
+}
+
+QString RegionFile::filename(const QString &path, const QString &folder, int rx, int rz) {
+  return path + "/" + folder + "/r." + QString::number(rx) + "." + QString::number(rz) + ".mca";
+}
+
+bool RegionFile::open() {
+  if (opened)
+    return (header != NULL);
+  opened = true;
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    // no chunks in this region (region file not present at all)
+    return false;
+  }
+  if (file.size() < headerSize) {
+    // file header not yet fully written by minecraft
+    file.close();
+    return false;
+  }
+  // map header into memory
+  header = file.map(0, headerSize);
+  return (header != NULL);
+}
+
+bool RegionFile::exists() {
+  return open();
+}
+
+bool RegionFile::contains(int cx, int cz) {
+  if (!open())
+    return false;
+  const int offset = 4 * ((cx & 31) + (cz & 31) * 32);
+  return ((header[offset] | header[offset + 1] | header[offset + 2]) != 0);
+}
+
+QBitArray RegionFile::presence() {
+  if (!open())
+    return QBitArray();
+  QBitArray bits(32 * 32);
+  for (int i = 0; i < 32 * 32; i++)
+    bits.setBit(i, (header[4 * i] | header[4 * i + 1] | header[4 * i + 2]) != 0);
+  return bits;
+}
+
+void RegionFile::willNeed() {
+#if defined(__linux__)
+  // starts asynchronous read ahead of the complete file into the page cache
+  if (open())
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+#endif
+}
+
+quint32 RegionFile::timestamp(int cx, int cz) {
+  if (!open())
+    return 0;
+  const int offset = 4096 + 4 * ((cx & 31) + (cz & 31) * 32);
+  return (quint32(header[offset]) << 24) | (quint32(header[offset + 1]) << 16) |
+         (quint32(header[offset + 2]) << 8) | quint32(header[offset + 3]);
+}
+
+// map the data of one Chunk: 4 bytes length, 1 byte compression format, data
+uchar *RegionFile::map(int cx, int cz) {
+  if (!open())
+    return NULL;
+
+  const int offset = 4 * ((cx & 31) + (cz & 31) * 32);
+  const int coffset = (header[offset] << 16) | (header[offset + 1] << 8) | header[offset + 2];
+  const int numSectors = header[offset+3];
+
+  if (coffset == 0) {
+    // no Chunk information stored in region file
+    return NULL;
+  }
+
+  const qint64 chunkStart = qint64(coffset) * 4096;
+  const qint64 chunkSize = qint64(numSectors) * 4096;
+
+  // Check if chunk header (5 bytes: 4 length + 1 compression) is readable
+  if (file.size() < chunkStart + 5) {
+    return NULL;
+  }
+
+  // Read chunk header to get actual data length
+  file.seek(chunkStart);
+  char headerBuf[4];
+  if (file.read(headerBuf, 4) != 4) {
+    return NULL;
+  }
+  const uchar *hdr = reinterpret_cast<const uchar*>(headerBuf);
+  int actualLength = (hdr[0] << 24) | (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+
+  // Sanity check: length must be positive and fit within allocated sectors
+  if (actualLength <= 0 || actualLength + 4 > chunkSize) {
+    return NULL;
+  }
+
+  // Check actual data fits in file (handles unpadded files like WorldTools exports)
+  if (file.size() < chunkStart + 4 + actualLength) {
+    return NULL;
+  }
+
+  return file.map(chunkStart, actualLength + 4);
+}
+
+bool RegionFile::load(int cx, int cz, QSharedPointer<Chunk> chunk, int loadtype, int channels) {
+  uchar *raw = map(cx, cz);
+  if (raw == NULL) {
+    return false;
+  }
+  // parse Chunk data
+  // Chunk will be flagged "loaded" in a thread save way
+  NBT nbt(raw);
+  switch (loadtype) {
+    case ChunkLoader::MAIN_MAP_DATA:
+      chunk->load(nbt, channels);
+      break;
+    case ChunkLoader::MAIN_MAP_DATA_WITH_ENTITIES:
+      chunk->load(nbt, channels);
+      Q_FALLTHROUGH();
+    case ChunkLoader::ENTITY_DATA:
+      chunk->loadEntities(nbt);
+      break;
+    case ChunkLoader::ENTITY_DATA_ONLY:
+      chunk->loadEntitiesOnly(nbt);
+      break;
+  }
+  file.unmap(raw);
+
+  // if we reach this point, everything went well
+  return true;
+}
+
+bool RegionFile::scan(int cx, int cz, NBTProjection &projection) {
+  uchar *raw = map(cx, cz);
+  if (raw == NULL) {
+    return false;
+  }
+  const bool ok = projection.scan(raw);
+  file.unmap(raw);
+  return ok;
+}
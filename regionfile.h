@@ -0,0 +1,42 @@
+#ifndef REGIONFILE_H_
+#define REGIONFILE_H_
+
+#include <QBitArray>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+
+class Chunk;
+class NBTProjection;
+
+// Access to the Chunks stored in one region file (.mca).
+// The file is opened and its headers (locations and timestamps) mapped on first use only once,
+// any number of Chunks can then be loaded without opening it again.
+// A RegionFile is used by one thread at a time.
+class RegionFile {
+ public:
+  explicit RegionFile(const QString &filename);
+  ~RegionFile();
+
+  // "<path>/<folder>/r.<rx>.<rz>.mca"
+  static QString filename(const QString &path, const QString &folder, int rx, int rz);
+
+  bool exists();                    // file is present with a complete header
+  bool contains(int cx, int cz);    // header has an entry for this Chunk
+  QBitArray presence();             // 32*32 bits (x fastest) of contains(), empty without file
+  quint32 timestamp(int cx, int cz);  // last modification (seconds since epoch), 0 if unknown
+  void willNeed();                  // hint the OS to read the file ahead (Linux only)
+  bool load(int cx, int cz, QSharedPointer<Chunk> chunk, int loadtype,
+            int channels);              // Chunk::DECODE_CHANNELS of Block data
+  bool scan(int cx, int cz, NBTProjection &projection);  // read only the projected fields
+
+ private:
+  bool   open();
+  uchar *map(int cx, int cz);  // stored Chunk data, to be unmapped by caller
+
+  QFile  file;
+  uchar *header;
+  bool   opened;  // open() was called, header is valid when not NULL
+};
+
+#endif  // REGIONFILE_H_
@@ -0,0 +1,47 @@
+#ifndef RENDERFLAGS_H_
+#define RENDERFLAGS_H_
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class RenderFlags {
+ public:
+  /// Values for the individual flags
+  enum {
+    flgLighting       = 1 << 0,
+    flgMobSpawn       = 1 << 1,
+    flgCaveMode       = 1 << 2,
+    flgDepthShading   = 1 << 3,
+    flgBiomeColors    = 1 << 4,
+    flgSeaGround      = 1 << 5,
+    flgSingleLayer    = 1 << 6,
+    flgSlimeChunks    = 1 << 7,
+    flgInhabitedTime  = 1 << 8,
+    flgChunkLock      = 1 << 9,
+  };
+
+  // convert comma separated list of view options (e.g. "lighting,cavemode")
+  // into flags, unknown names and "none" are ignored
+  static int fromString(const QString &list) {
+    static const QMap<QString, int> names = {
+      {"lighting",      flgLighting},
+      {"mobspawning",   flgMobSpawn},
+      {"cavemode",      flgCaveMode},
+      {"depthshading",  flgDepthShading},
+      {"biomecolors",   flgBiomeColors},
+      {"seaground",     flgSeaGround},
+      {"singlelayer",   flgSingleLayer},
+      {"slimechunks",   flgSlimeChunks},
+      {"inhabitedtime", flgInhabitedTime},
+      {"chunklock",     flgChunkLock}
+    };
+    int flags = 0;
+    for (auto &name : list.toLower().split(",")) {
+      flags |= names.value(name.trimmed(), 0);
+    }
+    return flags;
+  }
+};
+
+#endif  // RENDERFLAGS_H_
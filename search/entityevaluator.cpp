@@ -1,11 +1,10 @@
 #include "search/entityevaluator.h"
 
 #include "overlay/overlayitem.h"
-//#include "genericidentifier.h"
+#include "overlay/propertietreecreator.h"
+#include "nbt/tag.h"
+#include "nbt/tagpath.h"
 #include "search/searchresultwidget.h"
-//#include "careeridentifier.h"
-
-#include <QTreeWidgetItem>
 
 static const QString prefixToBeRemoved = "minecraft:";
 
@@ -18,6 +17,20 @@ static QString removeMinecraftPrefix(const QString& id)
   return id;
 }
 
+// paths into the Entity NBT
+static const TagPath pathId("id");
+static const TagPath pathCount("Count");
+static const TagPath pathCountNew("count");  // since 1.20.5
+static const TagPath pathRecipes("Offers/Recipes");
+static const TagPath pathBuy("buy");
+static const TagPath pathBuyB("buyB");
+static const TagPath pathSell("sell");
+static const TagPath pathVillagerData("VillagerData");
+static const TagPath pathProfession("VillagerData/profession");
+static const TagPath pathAttributes("Attributes");
+static const TagPath pathAttributeName("Name");
+static const TagPath pathAttributeBase("Base");
+
 using SpecialParamsFunctionT = std::function<QString(const EntityEvaluator &entity)>;
 
 static std::map<QString, SpecialParamsFunctionT> special_param_extractor =
@@ -38,12 +51,8 @@ static std::map<QString, SpecialParamsFunctionT> special_param_extractor =
 
 EntityEvaluator::EntityEvaluator(const EntityEvaluatorConfig& config)
   : config(config)
-  , rootNode(QSharedPointer<QTreeWidgetItem>::create())
+  , root(config.entity->propertiesTag())
 {
-  creator.CreateTree(rootNode.data(), config.entity->properties());
-
-  //searchProperties();
-
   bool found = config.evalFunction(*this);
   if (found) {
     addResult();
@@ -54,23 +63,13 @@ QList<QString> EntityEvaluator::getVillagerOffers() const
 {
   QList<QString> result;
 
-  auto* node = getNodeFromPath("Offers/Recipes", *rootNode);
-  if (!node) {
+  const Tag* node = pathRecipes.resolve(root.data());
+  if (!node || (node->getType() != Tag::TAG_LIST)) {
     return result;
   }
 
-  {   // single receipe only?
-    QString receipeDescription = describeReceipe(*node);
-    if (receipeDescription.size() > 0) {
-      result.append(receipeDescription);
-      return result;
-    }
-  }
-
-  // multiple ones:
-  for (int i = 0; i < node->childCount(); i++) {
-    auto& currentReceipNode = *node->child(i);
-    QString receipeDescription = describeReceipe(currentReceipNode);
+  for (int i = 0; i < node->length(); i++) {
+    QString receipeDescription = describeReceipe(*node->at(i));
     if (receipeDescription.size() > 0) {
       result.append(receipeDescription);
     }
@@ -89,43 +88,23 @@ QString EntityEvaluator::getSpecialParams() const
   return "";
 }
 
-void EntityEvaluator::searchProperties()
-{
-  searchTreeNode("", *rootNode);
-}
-
-void EntityEvaluator::searchTreeNode(const QString prefix, const QTreeWidgetItem &node)
-{
-  auto keyText = prefix + node.text(0);
-  auto valueText = node.text(1);
-
-  bool found = config.evalFunction(*this);
-  if (found) {
-    addResult();
-  } else {
-    for (int i = 0; i < node.childCount(); i++) {
-      searchTreeNode(keyText + ".", *node.child(i));
-    }
-  }
-}
-
-QString EntityEvaluator::describeReceipe(const QTreeWidgetItem &currentReceipNode) const
+QString EntityEvaluator::describeReceipe(const Tag &currentReceipNode) const
 {
   QString result = "";
 
-  auto* buyNode = getNodeFromPath("buy", currentReceipNode);
+  const Tag* buyNode = pathBuy.resolve(&currentReceipNode);
   if (buyNode) {
     result += describeReceipeItem(*buyNode);
   }
 
-  auto* buyBNode = getNodeFromPath("buyB", currentReceipNode);
+  const Tag* buyBNode = pathBuyB.resolve(&currentReceipNode);
   if (buyBNode) {
     QString buyB = describeReceipeItem(*buyBNode);
     if (buyB != "air")
       result += "," + buyB;
   }
 
-  auto* sellNode = getNodeFromPath("sell", currentReceipNode);
+  const Tag* sellNode = pathSell.resolve(&currentReceipNode);
   if (sellNode) {
     result += " => " + describeReceipeItem(*sellNode);
   }
@@ -133,19 +112,18 @@ QString EntityEvaluator::describeReceipe(const QTreeWidgetItem &currentReceipNod
   return result;
 }
 
-QString EntityEvaluator::describeReceipeItem(const QTreeWidgetItem &itemNode) const
+QString EntityEvaluator::describeReceipeItem(const Tag &itemNode) const
 {
   QString value = "";
 
-  auto* itemIdNode = getNodeFromPath("id", itemNode);
+  const Tag* itemIdNode = pathId.resolve(&itemNode);
   if (itemIdNode) {
-    auto* itemCountNode = getNodeFromPath("Count", itemNode);
-    int count = itemCountNode->text(1).toInt();
+    int count = pathCount.toInt(&itemNode, pathCountNew.toInt(&itemNode, 1));
     if (count > 1) {
       value += QString::number(count) + "*";
     }
 
-    QString id = removeMinecraftPrefix(itemIdNode->text(1));
+    QString id = removeMinecraftPrefix(TagPath::valueString(itemIdNode));
 
     value += id;
   }
@@ -155,9 +133,11 @@ QString EntityEvaluator::describeReceipeItem(const QTreeWidgetItem &itemNode) co
 
 void EntityEvaluator::addResult()
 {
+  // QVariant conversion only for Entities that are displayed
+  PropertieTreeCreator creator;
   SearchResultItem result;
-  result.properties = config.entity->properties();
-  result.name = creator.GetSummary("[0]", config.entity->properties());
+  result.properties = root ? root->getData() : QVariant();
+  result.name = creator.GetSummary("[0]", result.properties);
   result.pos.setX(config.entity->midpoint().x);
   result.pos.setY(config.entity->midpoint().y);
   result.pos.setZ(config.entity->midpoint().z);
@@ -166,51 +146,9 @@ void EntityEvaluator::addResult()
   config.resultSink.push_back(result);
 }
 
-const QTreeWidgetItem *EntityEvaluator::getNodeFromPath(const QString path, const QTreeWidgetItem &searchRoot)
-{
-  QStringList elements = path.split("/");
-
-  return getNodeFromPath(elements.begin(), elements.end(), searchRoot);
-}
-
-const QTreeWidgetItem *EntityEvaluator::getNodeFromPath(QStringList::iterator iter, QStringList::iterator end, const QTreeWidgetItem &searchRoot)
-{
-  QString nextName = *iter;
-  iter++;
-
-  for (int i = 0; i < searchRoot.childCount(); i++)
-  {
-    auto *child = searchRoot.child(i);
-    if (child && (child->text(0) == nextName)) {
-      if (iter != end) {
-        return getNodeFromPath(iter, end, *child);
-      } else {
-        return child;
-      }
-    }
-  }
-
-  return nullptr;
-}
-
-const QString EntityEvaluator::getNodeValueFromPath(const QString path, const QTreeWidgetItem &searchRoot, QString defaultValue)
-{
-  auto* node = getNodeFromPath(path, searchRoot);
-  if (node) {
-    return node->text(1);
-  }
-
-  return defaultValue;
-}
-
 QString EntityEvaluator::getTypeId() const
 {
-  auto* itemIdNode = getNodeFromPath("id", *rootNode);
-  if (itemIdNode) {
-    return itemIdNode->text(1);
-  }
-
-  return "-";
+  return pathId.toString(root.data(), "-");
 }
 
 bool EntityEvaluator::isVillager() const
@@ -221,9 +159,8 @@ bool EntityEvaluator::isVillager() const
 
 QString EntityEvaluator::getVillagerProfession() const
 {
-  auto node = getNodeFromPath("VillagerData", *rootNode);
-  if (node != nullptr) {
-    return getNodeValueFromPath("profession", *node, "");
+  if (pathVillagerData.resolve(root.data()) != nullptr) {
+    return pathProfession.toString(root.data(), "");
   }
 
   return "-";
@@ -231,21 +168,16 @@ QString EntityEvaluator::getVillagerProfession() const
 
 QString EntityEvaluator::getNamedAttribute(const QString &name) const
 {
-  auto node = getNodeFromPath("Attributes", *rootNode);
-
-  if (!node) return "";
-
-  for (int i = 0; i < node->childCount(); i++) {
-    auto *child = node->child(i);
-    if (child) {
-      auto nameNode = getNodeFromPath("Name", *child);
-      if (nameNode) {
-        if (nameNode->text(1) == name) {
-          auto baseNode = getNodeFromPath("Base", *child);
-          if (baseNode) {
-            return baseNode->text(1);
-          }
-        }
+  const Tag* node = pathAttributes.resolve(root.data());
+
+  if (!node || (node->getType() != Tag::TAG_LIST)) return "";
+
+  for (int i = 0; i < node->length(); i++) {
+    const Tag* child = node->at(i);
+    if (pathAttributeName.toString(child) == name) {
+      const Tag* baseNode = pathAttributeBase.resolve(child);
+      if (baseNode) {
+        return TagPath::valueString(baseNode);
       }
     }
   }
@@ -1,7 +1,6 @@
 #ifndef ENTITYEVALUATOR_H
 #define ENTITYEVALUATOR_H
 
-#include "overlay/propertietreecreator.h"
 #include "search/searchplugininterface.h"
 
 #include <QSharedPointer>
@@ -13,8 +12,7 @@ class Chunk;
 class SearchResultItem;
 class GenericIdentifier;
 class OverlayItem;
-
-class QTreeWidgetItem;
+class Tag;
 
 class EntityEvaluator;
 
@@ -35,6 +33,8 @@ struct EntityEvaluatorConfig
   std::function<bool(EntityEvaluator&)> evalFunction;
 };
 
+// evaluates the NBT properties of one Entity directly,
+// all paths into the NBT tree are parsed only once (see TagPath)
 class EntityEvaluator
 {
 public:
@@ -43,11 +43,6 @@ public:
   QList<QString> getVillagerOffers() const;
   QString getSpecialParams() const;
 
-  static const QTreeWidgetItem *getNodeFromPath(const QString path, const QTreeWidgetItem &searchRoot);
-  static const QTreeWidgetItem *getNodeFromPath(QStringList::iterator start, QStringList::iterator end, const QTreeWidgetItem &searchRoot);
-
-  static const QString getNodeValueFromPath(const QString path, const QTreeWidgetItem &searchRoot, QString defaultValue);
-
   QString getTypeId() const;
   bool isVillager() const;
   QString getVillagerProfession() const;
@@ -56,14 +51,10 @@ public:
 
 private:
   EntityEvaluatorConfig config;
-  QSharedPointer<QTreeWidgetItem> rootNode;
-  PropertieTreeCreator creator;
-
-  void searchProperties();
-  void searchTreeNode(const QString prefix, const QTreeWidgetItem& node);
+  QSharedPointer<const Tag> root;  // decoded once per entity
 
-  QString describeReceipe(const QTreeWidgetItem& node) const;
-  QString describeReceipeItem(const QTreeWidgetItem& node) const;
+  QString describeReceipe(const Tag& node) const;
+  QString describeReceipeItem(const Tag& node) const;
 
   void addResult();
 };
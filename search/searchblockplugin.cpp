@@ -1,9 +1,12 @@
 #include "search/searchblockplugin.h"
 #include "search/searchresultitem.h"
 
+#include "blockindex.h"
 #include "chunk.h"
 #include "identifier/blockidentifier.h"
+#include "identifier/flatteningconverter.h"
 
+#include <QVarLengthArray>
 #include <algorithm>
 
 SearchBlockPlugin::SearchBlockPlugin(QWidget* parent)
@@ -57,18 +60,31 @@ bool SearchBlockPlugin::initSearch()
   }
 
   if (stw_blockName->active()) {
+    const SearchTextWidget::Matcher matcher = stw_blockName->getMatcher();
     const QList<quint32> &knownIds = BlockIdentifier::Instance().getKnownIds();
     for (quint32 hid: knownIds) {
       auto blockInfo = BlockIdentifier::Instance().getBlockInfo(hid);
-      if (stw_blockName->matches(blockInfo.getName())) {
+      if (matcher.matches(blockInfo.getName())) {
         m_searchForIds.insert(hid);
       }
     }
   }
 
+  // the shared palette is too large to be tested for every Section
+  const PaletteEntry *legacyPalette = FlatteningConverter::Instance().getPalette();
+  m_legacyMatch.assign(FlatteningConverter::paletteLength, 0);
+  for (int i = 0; i < FlatteningConverter::paletteLength; i++) {
+    m_legacyMatch[i] = (m_searchForIds.count(legacyPalette[i].hid) > 0);
+  }
+
   return (m_searchForIds.size() > 0);
 }
 
+bool SearchBlockPlugin::mayContainResults(const BlockIndex &index, const ChunkID &id, const Range<int> &range) const
+{
+  return index.mayContain(id, m_searchForIds, range.begin() >> 4, range.end() >> 4);
+}
+
 SearchPluginI::ResultListT SearchBlockPlugin::searchChunk(const Chunk &chunk, const Range<int> &range)
 {
   SearchPluginI::ResultListT results;
@@ -81,21 +97,46 @@ SearchPluginI::ResultListT SearchBlockPlugin::searchChunk(const Chunk &chunk, co
   int range_start = std::max<int>(chunk.getLowest(), range.begin());
   int range_stop  = std::min<int>(chunk.getHighest(), range.end());
 
-  for (int y = range_start; y <= range_stop; y++) {
-    int offset = (y & 0x0f) * (16*16);
-    const ChunkSection * const section = chunk.getSectionByY(y);
-    if (section) {
+  for (int sy = (range_start >> 4); sy <= (range_stop >> 4); sy++) {
+    const ChunkSection * const section = chunk.getSectionByIdx(sy);
+    if (!section || (section->blockPaletteLength == 0)) {
+      continue;
+    }
+
+    // which palette indices are searched for, skip Section when none
+    const char *match = nullptr;
+    QVarLengthArray<char, 256> sectionMatch;
+    if (section->blockPaletteIsShared) {
+      match = m_legacyMatch.data();
+    } else {
+      bool any = false;
+      sectionMatch.resize(section->blockPaletteLength);
+      for (int i = 0; i < section->blockPaletteLength; i++) {
+        sectionMatch[i] = (m_searchForIds.count(section->blockPalette[i].hid) > 0);
+        any |= (sectionMatch[i] != 0);
+      }
+      if (!any) {
+        continue;
+      }
+      match = sectionMatch.constData();
+    }
+
+    const int y_start = std::max(range_start, sy * 16);
+    const int y_stop  = std::min(range_stop,  sy * 16 + 15);
+    for (int y = y_start; y <= y_stop; y++) {
+      int offset = (y & 0x0f) * (16*16);
       for (int z = 0; z < 16; z++) {
         for (int x = 0; x < 16; x++, offset++) {
-          quint32 blockHid = section->getPaletteEntry(offset).hid;
-          const auto it = m_searchForIds.find(blockHid);
-          if (it != m_searchForIds.end()) {
-            auto info = BlockIdentifier::Instance().getBlockInfo(blockHid);
+          quint16 index = section->blocks[offset];
+          if (index >= section->blockPaletteLength) {
+            index = 0;  // same fallback as ChunkSection::getPaletteEntry()
+          }
+          if (match[index]) {
+            auto info = BlockIdentifier::Instance().getBlockInfo(section->blockPalette[index].hid);
 
             SearchResultItem item;
             item.name = info.getName();
             item.pos = QVector3D(chunk.getChunkX() * 16 + x, y, chunk.getChunkZ() * 16 + z) + QVector3D(0.5,0.0,0.5); // mark center of block, not origin
-            item.entity = QSharedPointer<Entity>::create(OverlayItem::Point(item.pos));
             results.push_back(item);
           }
         }
@@ -7,6 +7,7 @@
 #include <QWidget>
 #include <QLayout>
 #include <set>
+#include <vector>
 
 
 class SearchBlockPlugin : public QWidget, public SearchPluginI
@@ -20,6 +21,8 @@ class SearchBlockPlugin : public QWidget, public SearchPluginI
   QWidget &getWidget() override;
 
   bool    initSearch() override;
+  bool    usesBlockIndex() const override { return true; }
+  bool    mayContainResults(const BlockIndex &index, const ChunkID &id, const Range<int> &range) const override;
   SearchPluginI::ResultListT searchChunk(const Chunk &chunk, const Range<int> &range) override;
 
  private:
@@ -29,6 +32,7 @@ class SearchBlockPlugin : public QWidget, public SearchPluginI
   SearchTextWidget* stw_blockName;
 
   std::set<quint32> m_searchForIds;
+  std::vector<char> m_legacyMatch;  // per index of the shared palette of converted pre-1.13 Chunks
 };
 
 #endif // SEARCHBLOCKPLUGIN_H
@@ -1,14 +1,11 @@
 #include "search/searchchunksdialog.h"
 #include "ui_searchchunksdialog.h"
 
-#include "chunkcache.h"
 #include "search/range.h"
-#include "search/rectangleinnertoouteriterator.h"
 
 #include <QVariant>
 #include <QVector2D>
 #include <QTreeWidgetItem>
-#include <QtConcurrent/QtConcurrent>
 
 
 SearchChunksDialog::SearchChunksDialog(QSharedPointer<SearchPluginI> searchPlugin_, QWidget *parent)
@@ -48,7 +45,7 @@ void SearchChunksDialog::setSearchCenter(int x, int y, int z)
 void SearchChunksDialog::on_pb_search_clicked()
 {
   // when search is pending -> cancel and return
-  if (!currentfuture.isCanceled()) {
+  if (currentSearch) {
     cancelSearch();
     return;
   }
@@ -61,51 +58,43 @@ void SearchChunksDialog::on_pb_search_clicked()
   ui->range->setButtonText("Cancel");
   ui->resultList->clearResults();
 
-  // determine Chunks to be searched
-  auto chunks = QSharedPointer<QList<ChunkID> >::create();
-  const int radius = ui->range->getRadiusChunks();
-  for (RectangleInnerToOuterIterator it(searchCenter, radius); it != it.end(); ++it) {
-    const ChunkID id(it->x(), it->y());
-    chunks->append(id);
-  }
-
-  ui->range->setProgressMaximum(chunks->size());
-  ui->range->setProgressValue(0);
+  SearchScheduler::StopCondition stop;
+  stop.maxResults  = ui->sb_stop_after->value();
+  stop.nearestOnly = ui->check_nearest->isChecked();
 
   // start search
   const Range<int> range_y = ui->range->getRangeY();
-  currentSearch = QSharedPointer<AsyncSearch>::create(*this, range_y, searchPlugin);
+  currentSearch = QSharedPointer<SearchScheduler>::create(searchPlugin, range_y, stop);
+  connect(currentSearch.data(), &SearchScheduler::resultsReady,
+          this, &SearchChunksDialog::displayResults, Qt::QueuedConnection);
+  connect(currentSearch.data(), &SearchScheduler::finished,
+          this, &SearchChunksDialog::cancelSearch, Qt::QueuedConnection);
 
-  currentfuture = QtConcurrent::map(*chunks, [currentSearch = currentSearch, chunks /* needed to keep list alive during search */](const ChunkID& id){
-    currentSearch->loadChunk_async(id);
-  });
+  ui->range->setProgressValue(0);
+  if (ui->check_world->isChecked())
+    ui->range->setProgressMaximum(currentSearch->startWorld(searchCenter));
+  else
+    ui->range->setProgressMaximum(currentSearch->start(searchCenter, ui->range->getRadiusChunks()));
 }
 
 
 
-void SearchChunksDialog::displayResultsOfSingleChunk(QSharedPointer<SearchPluginI::ResultListT> results)
+void SearchChunksDialog::displayResults(QSharedPointer<SearchPluginI::ResultListT> results, int chunksDone)
 {
   if (results) {
-    for (const auto& result: *results) {
-      ui->resultList->addResult(result);
-    }
+    ui->resultList->addResults(*results);
   }
 
-  addOneToProgress();
-}
-
-void SearchChunksDialog::addOneToProgress()
-{
-  if (ui->range->incrementProgressValue()) {
-    cancelSearch(); // finished
-  }
+  ui->range->addProgressValue(chunksDone);
 }
 
 void SearchChunksDialog::cancelSearch()
 {
-  currentfuture.cancel();
-  currentfuture.waitForFinished();
-  currentSearch.reset();
+  if (currentSearch) {
+    currentSearch->disconnect(this);
+    currentSearch->cancel();
+    currentSearch.reset();
+  }
 
   ui->resultList->searchDone();
   ui->range->setButtonText("Search");
@@ -121,33 +110,3 @@ void SearchChunksDialog::on_resultList_updateSearchResultPositions(QVector<QShar
   emit updateSearchResultPositions(item);
 }
 
-
-// AsyncSearch
-
-void SearchChunksDialog::AsyncSearch::loadChunk_async(ChunkID id)
-{
-  QSharedPointer<Chunk> chunk = ChunkCache::Instance().getChunkSynchronously(id);
-
-  QSharedPointer<SearchPluginI::ResultListT> results;
-
-  if (chunk) {
-    results = processChunk_async(chunk);
-  }
-
-  QMetaObject::invokeMethod(&parent, "displayResultsOfSingleChunk", Qt::QueuedConnection,
-                            Q_ARG(QSharedPointer<SearchPluginI::ResultListT>, results));
-}
-
-
-QSharedPointer<SearchPluginI::ResultListT> SearchChunksDialog::AsyncSearch::processChunk_async(const QSharedPointer<Chunk>& chunk)
-{
-  ChunkID id(chunk->getChunkX(), chunk->getChunkZ());
-
-  auto strong = searchPlugin.lock();
-  if (!strong) {
-    return QSharedPointer<SearchPluginI::ResultListT>();
-  }
-
-  auto results = strong->searchChunk(*chunk, range_y);
-  return QSharedPointer<SearchPluginI::ResultListT>::create(results);
-}
@@ -6,10 +6,9 @@
 #include "search/entityevaluator.h"
 #include "search/range.h"
 #include "search/searchplugininterface.h"
-#include "chunkid.h"
+#include "search/searchscheduler.h"
 
 #include <QDialog>
-#include <QFuture>
 #include <QVector3D>
 
 #include <set>
@@ -17,8 +16,6 @@
 #include "ui_searchchunksdialog.h"
 
 
-class ChunkCache;
-class Chunk;
 class SearchResultWidget;
 
 class SearchChunksDialog : public QDialog
@@ -44,9 +41,7 @@ class SearchChunksDialog : public QDialog
   void on_resultList_jumpTo(const QVector3D &);
   void on_resultList_updateSearchResultPositions(QVector<QSharedPointer<OverlayItem> >);
 
-  void displayResultsOfSingleChunk(QSharedPointer<SearchPluginI::ResultListT> results);
-
-  void addOneToProgress();
+  void displayResults(QSharedPointer<SearchPluginI::ResultListT> results, int chunksDone);
 
   void cancelSearch();
 
@@ -55,29 +50,7 @@ class SearchChunksDialog : public QDialog
   QSharedPointer<SearchPluginI> searchPlugin;
   QVector3D searchCenter;
 
-  class AsyncSearch
-  {
-   public:
-    AsyncSearch(SearchChunksDialog& parent_,
-                const Range<int>& range_y_,
-                const QWeakPointer<SearchPluginI>& searchPlugin_)
-      : parent(parent_)
-      , range_y(range_y_)
-      , searchPlugin(searchPlugin_)
-    {}
-
-    void loadChunk_async(ChunkID id);
-
-    QSharedPointer<SearchPluginI::ResultListT> processChunk_async(const QSharedPointer<Chunk> &chunk);
-
-   private:
-    SearchChunksDialog& parent;
-    const Range<int> range_y;
-    QWeakPointer<SearchPluginI> searchPlugin;
-  };
-
-  QSharedPointer<AsyncSearch> currentSearch;
-  QFuture<void> currentfuture;
+  QSharedPointer<SearchScheduler> currentSearch;
 };
 
 #endif // SEARCHENTITYDIALOG_H
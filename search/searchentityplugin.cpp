@@ -44,6 +44,18 @@ QWidget &SearchEntityPlugin::getWidget()
   return *this;
 }
 
+bool SearchEntityPlugin::initSearch()
+{
+  m_entity         = stw_entity->getMatcher();
+  m_buys           = stw_buys->getMatcher();
+  m_sells          = stw_sells->getMatcher();
+  m_special        = stw_special->getMatcher();
+  m_villagerActive = stw_villager->active();
+  m_villager       = stw_villager->getSearchText();
+
+  return true;
+}
+
 SearchPluginI::ResultListT SearchEntityPlugin::searchChunk(const Chunk &chunk, const Range<int> &range)
 {
   SearchPluginI::ResultListT results;
@@ -65,41 +77,40 @@ SearchPluginI::ResultListT SearchEntityPlugin::searchChunk(const Chunk &chunk, c
 
 bool SearchEntityPlugin::evaluateEntity(EntityEvaluator &entity)
 {
-  bool result = true;
-
-  if (stw_entity->active()) {
+  if (m_entity.active()) {
     QString id = entity.getTypeId().remove("minecraft:");
-    result = result && stw_entity->matches(id);
+    if (!m_entity.matches(id))
+      return false;
   }
 
-  if (stw_villager->active()) {
-    QString searchFor = stw_villager->getSearchText();
+  if (m_villagerActive) {
     QString career = entity.getVillagerProfession();
-    result = result && (career.contains(searchFor, Qt::CaseInsensitive));
+    if (!career.contains(m_villager, Qt::CaseInsensitive))
+      return false;
   }
 
-  if (stw_buys->active()) {
-    result = result && findBuyOrSell(entity, *stw_buys, 0);
+  if (m_buys.active() || m_sells.active()) {
+    const QList<QString> offers = entity.getVillagerOffers();
+    if (m_buys.active() && !findBuyOrSell(offers, m_buys, 0))
+      return false;
+    if (m_sells.active() && !findBuyOrSell(offers, m_sells, 1))
+      return false;
   }
 
-  if (stw_sells->active()) {
-    result = result && findBuyOrSell(entity, *stw_sells, 1);
+  if (m_special.active()) {
+    if (!m_special.matches(entity.getSpecialParams()))
+      return false;
   }
 
-  if (stw_special->active()) {
-    result = result && stw_special->matches(entity.getSpecialParams());
-  }
-
-  return result;
+  return true;
 }
 
-bool SearchEntityPlugin::findBuyOrSell(EntityEvaluator &entity, SearchTextWidget& searchText, int index)
+bool SearchEntityPlugin::findBuyOrSell(const QList<QString> &offers, const SearchTextWidget::Matcher &matcher, int index)
 {
   bool foundOffer = false;
-  auto offers = entity.getVillagerOffers();
   for (const auto& offer: offers) {
     auto splitOffer = offer.split(" => ");
-    foundOffer = (splitOffer.count() > index) && searchText.matches(splitOffer[index]);
+    foundOffer = (splitOffer.count() > index) && matcher.matches(splitOffer[index]);
     if (foundOffer) {
       break;
     }
@@ -107,5 +118,3 @@ bool SearchEntityPlugin::findBuyOrSell(EntityEvaluator &entity, SearchTextWidget
 
   return foundOffer;
 }
-
-
@@ -19,6 +19,9 @@ class SearchEntityPlugin : public QWidget, public SearchPluginI
 
   QWidget &getWidget() override;
 
+  bool initSearch() override;
+  int  neededChunkParts() const override { return ChunkLoader::PART_ENTITIES; }
+
   SearchPluginI::ResultListT searchChunk(const Chunk &chunk, const Range<int> &range) override;
 
  private:
@@ -30,8 +33,16 @@ class SearchEntityPlugin : public QWidget, public SearchPluginI
   SearchTextWidget* stw_buys;
   SearchTextWidget* stw_special;
 
+  // criteria compiled by initSearch(), evaluated from worker threads
+  SearchTextWidget::Matcher m_entity;
+  SearchTextWidget::Matcher m_buys;
+  SearchTextWidget::Matcher m_sells;
+  SearchTextWidget::Matcher m_special;
+  bool                      m_villagerActive = false;
+  QString                   m_villager;
+
   bool evaluateEntity(EntityEvaluator &entity);
-  bool findBuyOrSell(EntityEvaluator& entity, SearchTextWidget &searchText, int index);
+  static bool findBuyOrSell(const QList<QString>& offers, const SearchTextWidget::Matcher &matcher, int index);
 };
 
 #endif // SEARCHENTITYPLUGIN_H
@@ -4,11 +4,14 @@
 #include "search/range.h"
 #include "search/searchresultitem.h"
 #include "chunk.h"
+#include "chunkid.h"
+#include "chunkloader.h"
 
 #include <vector>
 
 
 class QWidget;
+class BlockIndex;
 
 class SearchPluginI
 {
@@ -20,6 +23,15 @@ class SearchPluginI
 
   virtual bool initSearch() { return true; }
 
+  // parts of a Chunk evaluated by searchChunk() (ChunkLoader::CHUNK_PARTS),
+  // the others are not loaded or decoded; Entities are loaded on demand only
+  virtual int neededChunkParts() const { return ChunkLoader::PART_BLOCKS; }
+
+  // Block index: Chunks that can not contain results are not loaded at all
+  virtual bool usesBlockIndex() const { return false; }
+  virtual bool mayContainResults(const BlockIndex &/*index*/, const ChunkID &/*id*/,
+                                 const Range<int> &/*range*/) const { return true; }
+
   virtual ResultListT searchChunk(const Chunk &chunk, const Range<int> &range) = 0;
   ResultListT searchChunk(const Chunk &chunk)
   {
@@ -0,0 +1,546 @@
+#include "search/searchquery.h"
+
+#include "chunk.h"
+#include "chunkcache.h"
+#include "identifier/biomeidentifier.h"
+#include "identifier/blockidentifier.h"
+#include "identifier/flatteningconverter.h"
+
+#include <QStringList>
+#include <algorithm>
+
+
+static QStringList tokenize(const QString &text)
+{
+  static const QString delimiters = "(),<>=";
+  QStringList tokens;
+  int i = 0;
+  while (i < text.size()) {
+    const QChar c = text[i];
+    if (c.isSpace()) {
+      i++;
+    } else if ((c == '(') || (c == ')') || (c == ',')) {
+      tokens << QString(c);
+      i++;
+    } else if ((c == '<') || (c == '>') || (c == '=') ||
+               ((c == '!') && (text.mid(i + 1, 1) == "="))) {
+      const int length = (text.mid(i + 1, 1) == "=") ? 2 : 1;
+      tokens << text.mid(i, length);
+      i += length;
+    } else {
+      const int start = i;
+      while ((i < text.size()) && !text[i].isSpace() && !delimiters.contains(text[i]) &&
+             !((text[i] == '!') && (text.mid(i + 1, 1) == "=")))
+        i++;
+      tokens << text.mid(start, i - start);
+    }
+  }
+  return tokens;
+}
+
+static QRegularExpression wildcard(const QString &pattern)
+{
+  return QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern),
+                            QRegularExpression::CaseInsensitiveOption);
+}
+
+static bool matchesName(const QRegularExpression &re, const QString &name)
+{
+  static const QString prefix = "minecraft:";
+  return re.match(name).hasMatch() ||
+         (name.startsWith(prefix) && re.match(name.mid(prefix.size())).hasMatch());
+}
+
+
+// recursive descent parser:
+//   or  := and ("or" and)*
+//   and := not ("and" not)*
+//   not := "not" not | "(" or ")" | predicate
+class SearchQuery::Parser
+{
+ public:
+  Parser(SearchQuery &query, const QString &text)
+    : query(query)
+    , tokens(tokenize(text))
+    , pos(0)
+  {}
+
+  int parse()
+  {
+    int index = parseOr();
+    if ((index >= 0) && (pos < tokens.size()))
+      return fail("unexpected '" + tokens[pos] + "'");
+    return index;
+  }
+
+  QString error;
+
+ private:
+  QString peek() const { return (pos < tokens.size()) ? tokens[pos].toLower() : QString(); }
+  QString take()       { return (pos < tokens.size()) ? tokens[pos++] : QString(); }
+
+  int fail(const QString &message)
+  {
+    if (error.isEmpty())
+      error = message;
+    return -1;
+  }
+
+  bool expect(const QString &token)
+  {
+    if (take() == token)
+      return true;
+    fail("'" + token + "' expected");
+    return false;
+  }
+
+  int parseNumber(bool *ok)
+  {
+    const QString token = take();
+    const int value = token.toInt(ok);
+    if (!*ok)
+      fail("number expected instead of '" + token + "'");
+    return value;
+  }
+
+  int parseOr()
+  {
+    int left = parseAnd();
+    while ((left >= 0) && (peek() == "or")) {
+      take();
+      const int right = parseAnd();
+      if (right < 0)
+        return -1;
+      left = combine(OR, left, right);
+    }
+    return left;
+  }
+
+  int parseAnd()
+  {
+    int left = parseNot();
+    while ((left >= 0) && (peek() == "and")) {
+      take();
+      const int right = parseNot();
+      if (right < 0)
+        return -1;
+      left = combine(AND, left, right);
+    }
+    return left;
+  }
+
+  int parseNot()
+  {
+    if (peek() == "not") {
+      take();
+      const int operand = parseNot();
+      if (operand < 0)
+        return -1;
+      Node node;
+      node.type = NOT;
+      node.children << operand;
+      return query.addNode(node);
+    }
+    if (peek() == "(") {
+      take();
+      const int index = parseOr();
+      if ((index < 0) || !expect(")"))
+        return -1;
+      return index;
+    }
+    return parsePredicate();
+  }
+
+  int parsePredicate()
+  {
+    if (pos >= tokens.size())
+      return fail("unexpected end of query");
+
+    const QString name = take().toLower();
+    Node node;
+    bool ok = true;
+
+    if ((name == "block") || (name == "near") || (name == "biome")) {
+      if (!expect("("))
+        return -1;
+      const QString pattern = take();
+      if (pattern.isEmpty() || (pattern == ")") || (pattern == ","))
+        return fail("pattern expected after '" + name + "('");
+
+      if (name == "biome") {
+        node.type    = BIOME;
+        node.pattern = wildcard(pattern);
+        node.cost    = 4;
+      } else {
+        node.type = (name == "near") ? NEAR : BLOCK;
+        node.cost = 2;
+        if (!query.resolveBlocks(node, pattern, &error))
+          return -1;
+      }
+
+      if (node.type == NEAR) {
+        if (!expect(","))
+          return -1;
+        node.value = parseNumber(&ok);
+        if (!ok)
+          return -1;
+        if ((node.value < 1) || (node.value > MAX_NEAR_RADIUS))
+          return fail(QString("near() radius must be 1 to %1").arg(MAX_NEAR_RADIUS));
+        const int side = 2 * node.value + 1;
+        node.cost = 10 + side * side * side;
+      }
+      if (!expect(")"))
+        return -1;
+
+    } else if ((name == "y") || (name == "light")) {
+      const QString op = take();
+      if      (op == "<")  node.compare = LT;
+      else if (op == "<=") node.compare = LE;
+      else if (op == ">")  node.compare = GT;
+      else if (op == ">=") node.compare = GE;
+      else if ((op == "=") || (op == "==")) node.compare = EQ;
+      else if (op == "!=") node.compare = NE;
+      else return fail("comparison expected after '" + name + "'");
+      node.value = parseNumber(&ok);
+      if (!ok)
+        return -1;
+      node.type = (name == "y") ? Y : LIGHT;
+      node.cost = (name == "y") ? 1 : 3;
+
+    } else {
+      return fail("unknown predicate '" + name + "'");
+    }
+
+    return query.addNode(node);
+  }
+
+  int combine(NodeType type, int left, int right)
+  {
+    // flatten chains of the same operator
+    if (query.nodes[left].type == type) {
+      query.nodes[left].children << right;
+      return left;
+    }
+    Node node;
+    node.type = type;
+    node.children << left << right;
+    return query.addNode(node);
+  }
+
+  SearchQuery &query;
+  QStringList  tokens;
+  int          pos;
+};
+
+
+bool SearchQuery::compile(const QString &text, QString *error)
+{
+  nodes.clear();
+  required.clear();
+  root = -1;
+  parts = ChunkLoader::PART_BLOCKS;
+
+  Parser parser(*this, text);
+  const int index = parser.parse();
+  if (index < 0) {
+    nodes.clear();
+    if (error)
+      *error = parser.error;
+    return false;
+  }
+
+  order(index);
+  root = index;
+
+  // Block needed in every Chunk with results (for the Block index)
+  const Node &top = nodes[root];
+  if (top.type == BLOCK) {
+    required = top.hids;
+  } else if (top.type == AND) {
+    for (int child : top.children) {
+      if (nodes[child].type == BLOCK) {
+        required = nodes[child].hids;
+        break;
+      }
+    }
+  }
+
+  // optional Chunk data decoded only for predicates reading it
+  for (const Node &node : qAsConst(nodes)) {
+    if (node.type == BIOME)
+      parts |= ChunkLoader::PART_BIOMES;
+    else if (node.type == LIGHT)
+      parts |= ChunkLoader::PART_BLOCKLIGHT;
+  }
+
+  return true;
+}
+
+int SearchQuery::addNode(const Node &node)
+{
+  nodes.append(node);
+  return nodes.size() - 1;
+}
+
+// evaluate cheap operands first, "and" / "or" stop at the first decisive one
+void SearchQuery::order(int index)
+{
+  Node &node = nodes[index];
+  if (node.children.isEmpty())
+    return;
+
+  int cost = 0;
+  for (int child : qAsConst(node.children)) {
+    order(child);
+    cost += nodes[child].cost;
+  }
+  std::stable_sort(node.children.begin(), node.children.end(), [this](int a, int b) {
+    return nodes[a].cost < nodes[b].cost;
+  });
+  node.cost = cost;
+}
+
+bool SearchQuery::resolveBlocks(Node &node, const QString &pattern, QString *error) const
+{
+  const QRegularExpression re = wildcard(pattern);
+  const QList<quint32> &knownIds = BlockIdentifier::Instance().getKnownIds();
+  for (quint32 hid : knownIds) {
+    if (matchesName(re, BlockIdentifier::Instance().getBlockInfo(hid).getName()))
+      node.hids.insert(hid);
+  }
+  if (node.hids.empty()) {
+    if (error)
+      *error = "no Block matches '" + pattern + "'";
+    return false;
+  }
+
+  const PaletteEntry *legacyPalette = FlatteningConverter::Instance().getPalette();
+  node.legacyMatch.assign(FlatteningConverter::paletteLength, 0);
+  for (int i = 0; i < FlatteningConverter::paletteLength; i++)
+    node.legacyMatch[i] = (node.hids.count(legacyPalette[i].hid) > 0);
+  return true;
+}
+
+
+SearchPluginI::ResultListT SearchQuery::searchChunk(const Chunk &chunk, const Range<int> &range) const
+{
+  SearchPluginI::ResultListT results;
+  if (root < 0)
+    return results;
+
+  Context ctx;
+  ctx.chunk  = &chunk;
+  ctx.chunkX = chunk.getChunkX();
+  ctx.chunkZ = chunk.getChunkZ();
+  for (int dz = 0; dz < 3; dz++) {
+    for (int dx = 0; dx < 3; dx++) {
+      ctx.neighbors[dz][dx] = nullptr;
+      ctx.fetched[dz][dx]   = false;
+    }
+  }
+  ctx.neighbors[1][1] = &chunk;
+  ctx.fetched[1][1]   = true;
+  ctx.sectionMatch.fill(nullptr, nodes.size());
+
+  const int range_start = std::max<int>(chunk.getLowest(), range.begin());
+  const int range_stop  = std::min<int>(chunk.getHighest(), range.end());
+
+  for (int sy = (range_start >> 4); sy <= (range_stop >> 4); sy++) {
+    const ChunkSection * const section = chunk.getSectionByIdx(sy);
+    if (!section || (section->blockPaletteLength == 0))
+      continue;
+    if (!possible(ctx, root, sy))
+      continue;
+
+    // palette matches of this Section, looked up per Block
+    for (int i = 0; i < nodes.size(); i++) {
+      if (nodes[i].type == BLOCK)
+        ctx.sectionMatch[i] = section->blockPaletteIsShared ? nodes[i].legacyMatch.data()
+                                                            : mask(ctx, i, section).match.constData();
+    }
+
+    const int y_start = std::max(range_start, sy * 16);
+    const int y_stop  = std::min(range_stop,  sy * 16 + 15);
+    for (int y = y_start; y <= y_stop; y++) {
+      for (int z = 0; z < 16; z++) {
+        for (int x = 0; x < 16; x++) {
+          if (!eval(ctx, root, section, x, y, z))
+            continue;
+          const PaletteEntry &entry = section->getPaletteEntry(x, y, z);
+          SearchResultItem item;
+          item.name = BlockIdentifier::Instance().getBlockInfo(entry.hid).getName();
+          item.pos  = QVector3D(ctx.chunkX * 16 + x, y, ctx.chunkZ * 16 + z) + QVector3D(0.5, 0.0, 0.5);
+          results.push_back(item);
+        }
+      }
+    }
+  }
+
+  return results;
+}
+
+const ChunkSection *SearchQuery::section(Context &ctx, int dx, int dz, int sy) const
+{
+  if ((sy < -128) || (sy > 127))
+    return nullptr;
+
+  if (!ctx.fetched[dz + 1][dx + 1]) {
+    ctx.fetched[dz + 1][dx + 1] = true;
+    // only Block states of neighbors are evaluated
+    QSharedPointer<Chunk> neighbor = ChunkCache::Instance().getChunkSynchronously(
+          ChunkID(ctx.chunkX + dx, ctx.chunkZ + dz), false, CachePolicy::scan, 0);
+    if (neighbor) {
+      ctx.keepAlive.append(neighbor);
+      ctx.neighbors[dz + 1][dx + 1] = neighbor.data();
+    }
+  }
+
+  const Chunk *chunk = ctx.neighbors[dz + 1][dx + 1];
+  return chunk ? chunk->getSectionByIdx(sy) : nullptr;
+}
+
+const SearchQuery::Mask &SearchQuery::mask(Context &ctx, int index, const ChunkSection *section) const
+{
+  const QPair<int, const ChunkSection*> key(index, section);
+  auto it = ctx.masks.constFind(key);
+  if (it != ctx.masks.constEnd())
+    return it.value();
+
+  Mask m;
+  if (section->blockPaletteIsShared) {
+    m.any = true;  // too large to test, nodes[index].legacyMatch is used instead
+  } else {
+    const std::set<quint32> &hids = nodes[index].hids;
+    m.any = false;
+    m.match.resize(section->blockPaletteLength);
+    for (int i = 0; i < section->blockPaletteLength; i++) {
+      m.match[i] = (hids.count(section->blockPalette[i].hid) > 0);
+      m.any |= (m.match[i] != 0);
+    }
+  }
+  return ctx.masks.insert(key, m).value();
+}
+
+bool SearchQuery::matchesAt(Context &ctx, int index, int x, int y, int z) const
+{
+  const ChunkSection *s = section(ctx, x >> 4, z >> 4, y >> 4);
+  if (!s || (s->blockPaletteLength == 0))
+    return false;
+
+  const int offset = ((y & 0x0f) << 8) + ((z & 0x0f) << 4) + (x & 0x0f);
+  quint16 i = s->blocks[offset];
+  if (i >= s->blockPaletteLength)
+    i = 0;  // same fallback as ChunkSection::getPaletteEntry()
+  if (s->blockPaletteIsShared)
+    return nodes[index].legacyMatch[i];
+  return mask(ctx, index, s).match[i];
+}
+
+// can any Block of Section sy satisfy the node, judged by palettes only
+bool SearchQuery::possible(Context &ctx, int index, int sy) const
+{
+  const Node &node = nodes[index];
+  switch (node.type) {
+    case AND:
+      for (int child : node.children)
+        if (!possible(ctx, child, sy))
+          return false;
+      return true;
+    case OR:
+      for (int child : node.children)
+        if (possible(ctx, child, sy))
+          return true;
+      return false;
+    case BLOCK: {
+      const ChunkSection *s = section(ctx, 0, 0, sy);
+      return s && (s->blockPaletteLength > 0) && mask(ctx, index, s).any;
+    }
+    case NEAR: {
+      // own Chunk first, neighbor Chunks are fetched only when needed
+      static const int around[9][2] = {{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1},
+                                       {-1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+      const int sy1 = (sy * 16 - node.value) >> 4;
+      const int sy2 = (sy * 16 + 15 + node.value) >> 4;
+      for (const auto &d : around) {
+        for (int s = sy1; s <= sy2; s++) {
+          const ChunkSection *cs = section(ctx, d[0], d[1], s);
+          if (cs && (cs->blockPaletteLength > 0) && mask(ctx, index, cs).any)
+            return true;
+        }
+      }
+      return false;
+    }
+    case Y:
+      for (int y = sy * 16; y < sy * 16 + 16; y++)
+        if (compare(node.compare, y, node.value))
+          return true;
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool SearchQuery::eval(Context &ctx, int index, const ChunkSection *section, int x, int y, int z) const
+{
+  const Node &node = nodes[index];
+  switch (node.type) {
+    case AND:
+      for (int child : node.children)
+        if (!eval(ctx, child, section, x, y, z))
+          return false;
+      return true;
+    case OR:
+      for (int child : node.children)
+        if (eval(ctx, child, section, x, y, z))
+          return true;
+      return false;
+    case NOT:
+      return !eval(ctx, node.children.first(), section, x, y, z);
+    case BLOCK: {
+      quint16 i = section->blocks[((y & 0x0f) << 8) + (z << 4) + x];
+      if (i >= section->blockPaletteLength)
+        i = 0;
+      return ctx.sectionMatch[index][i];
+    }
+    case NEAR: {
+      const int r = node.value;
+      for (int dy = -r; dy <= r; dy++)
+        for (int dz = -r; dz <= r; dz++)
+          for (int dx = -r; dx <= r; dx++)
+            if ((dx || dy || dz) && matchesAt(ctx, index, x + dx, y + dy, z + dz))
+              return true;
+      return false;
+    }
+    case BIOME: {
+      const qint32 id = ctx.chunk->getBiomeID(x, y, z);
+      const QPair<int, qint32> key(index, id);
+      auto it = ctx.biomes.constFind(key);
+      if (it != ctx.biomes.constEnd())
+        return it.value();
+      const BiomeInfo &biome = (ctx.chunk->getVersion() >= 2800) ?
+          BiomeIdentifier::Instance().getBiomeBySection(id) :
+          BiomeIdentifier::Instance().getBiomeByChunk  (id);
+      const bool match = matchesName(node.pattern, biome.nid) || node.pattern.match(biome.name).hasMatch();
+      ctx.biomes.insert(key, match);
+      return match;
+    }
+    case LIGHT:
+      return compare(node.compare, section->getBlockLight(x, y, z), node.value);
+    case Y:
+      return compare(node.compare, y, node.value);
+  }
+  return false;
+}
+
+bool SearchQuery::compare(Compare c, int a, int b)
+{
+  switch (c) {
+    case LT: return (a <  b);
+    case LE: return (a <= b);
+    case GT: return (a >  b);
+    case GE: return (a >= b);
+    case EQ: return (a == b);
+    case NE: return (a != b);
+  }
+  return false;
+}
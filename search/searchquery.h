@@ -0,0 +1,105 @@
+#ifndef SEARCHQUERY_H
+#define SEARCHQUERY_H
+
+#include "search/range.h"
+#include "search/searchplugininterface.h"
+
+#include <QHash>
+#include <QPair>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include <set>
+#include <vector>
+
+class Chunk;
+class ChunkSection;
+
+// Compound query over the Blocks of a Chunk, e.g.
+//   block(*diamond_ore) and near(lava, 2) and y < -50 and biome(deep_dark)
+//
+// Predicates:
+//   block(pattern)      Block name matches the wildcard pattern, "minecraft:" is optional
+//   near(pattern, r)    such a Block within r Blocks (1..8) around, in any direction
+//   biome(pattern)      Biome name or namespace ID matches the wildcard pattern
+//   y <op> n            Y level, <op> is one of  <  <=  >  >=  =  !=
+//   light <op> n        Block light level
+// combined with "and", "or", "not" and parentheses.
+//
+// The query is compiled once: patterns are resolved into sets of Block hids,
+// operands of "and" / "or" are ordered cheapest first. A Chunk is evaluated
+// in one pass per Section. Sections are skipped when their palettes (and the
+// palettes of the Sections around for near()) can not satisfy the query.
+// Neighbor Chunks are fetched at most once per Chunk and only when needed.
+class SearchQuery
+{
+ public:
+  bool compile(const QString &text, QString *error = nullptr);
+  bool isEmpty() const { return (root < 0); }
+
+  // hids of which at least one must be present in a Chunk with results,
+  // empty when the query does not require a specific Block
+  const std::set<quint32> &requiredBlocks() const { return required; }
+
+  // ChunkLoader::CHUNK_PARTS evaluated, Biomes and Block light only when queried
+  int neededChunkParts() const { return parts; }
+
+  SearchPluginI::ResultListT searchChunk(const Chunk &chunk, const Range<int> &range) const;
+
+  static const int MAX_NEAR_RADIUS = 8;
+
+ private:
+  enum NodeType { AND, OR, NOT, BLOCK, NEAR, BIOME, Y, LIGHT };
+  enum Compare  { LT, LE, GT, GE, EQ, NE };
+
+  struct Node {
+    NodeType           type;
+    QVector<int>       children;     // AND, OR, NOT
+    std::set<quint32>  hids;         // BLOCK, NEAR
+    std::vector<char>  legacyMatch;  // BLOCK, NEAR: per index of the shared palette (pre-1.13)
+    QRegularExpression pattern;      // BIOME
+    Compare            compare = EQ; // Y, LIGHT
+    int                value   = 0;  // Y, LIGHT: compared value, NEAR: radius
+    int                cost    = 1;
+  };
+
+  struct Mask {
+    QVector<char> match;  // per palette index of one Section
+    bool          any;
+  };
+
+  // state of the evaluation of one Chunk
+  struct Context {
+    const Chunk *chunk;
+    int          chunkX, chunkZ;
+    const Chunk *neighbors[3][3];  // [dz+1][dx+1], center is chunk
+    bool         fetched[3][3];
+    QVector<QSharedPointer<Chunk>> keepAlive;
+    QHash<QPair<int, const ChunkSection*>, Mask> masks;
+    QHash<QPair<int, qint32>, bool>              biomes;
+    QVector<const char*> sectionMatch;  // block() nodes: match per palette index of current Section
+  };
+
+  class Parser;
+  friend class Parser;
+
+  int  addNode(const Node &node);
+  void order(int index);
+  bool resolveBlocks(Node &node, const QString &pattern, QString *error) const;
+
+  const ChunkSection *section(Context &ctx, int dx, int dz, int sy) const;
+  const Mask &mask(Context &ctx, int index, const ChunkSection *section) const;
+  bool matchesAt(Context &ctx, int index, int x, int y, int z) const;  // x, z relative to Chunk, may be outside
+  bool possible(Context &ctx, int index, int sy) const;
+  bool eval(Context &ctx, int index, const ChunkSection *section, int x, int y, int z) const;
+  static bool compare(Compare c, int a, int b);
+
+  QVector<Node>     nodes;
+  int               root = -1;
+  std::set<quint32> required;
+  int               parts = ChunkLoader::PART_BLOCKS;
+};
+
+#endif // SEARCHQUERY_H
@@ -0,0 +1,70 @@
+#include "search/searchqueryplugin.h"
+
+#include "blockindex.h"
+
+#include <QLabel>
+#include <QLineEdit>
+
+
+SearchQueryPlugin::SearchQueryPlugin(QWidget* parent)
+  : QWidget(parent)
+  , layout(new QVBoxLayout(this))
+{
+  layout->addWidget(edit_query = new QLineEdit());
+  edit_query->setPlaceholderText("block(*diamond_ore) and near(lava, 2) and y < -50 and biome(deep_dark)");
+
+  QLabel *label_help = new QLabel(
+        "block(name), near(name, radius), biome(name), y < n, light >= n\n"
+        "combined with and, or, not, ( ) - names may contain wildcards * and ?");
+  label_help->setTextFormat(Qt::PlainText);
+  label_help->setWordWrap(true);
+  layout->addWidget(label_help);
+
+  layout->addWidget(label_error = new QLabel());
+  label_error->setStyleSheet("color: red");
+  label_error->hide();
+
+  connect(edit_query, &QLineEdit::textChanged, label_error, &QLabel::hide);
+}
+
+SearchQueryPlugin::~SearchQueryPlugin()
+{
+  delete layout;
+}
+
+QWidget &SearchQueryPlugin::getWidget()
+{
+  return *this;
+}
+
+bool SearchQueryPlugin::initSearch()
+{
+  QString error;
+  if (!m_query.compile(edit_query->text(), &error)) {
+    label_error->setText(error);
+    label_error->show();
+    return false;
+  }
+  label_error->hide();
+  return true;
+}
+
+int SearchQueryPlugin::neededChunkParts() const
+{
+  return m_query.neededChunkParts();
+}
+
+bool SearchQueryPlugin::usesBlockIndex() const
+{
+  return !m_query.requiredBlocks().empty();
+}
+
+bool SearchQueryPlugin::mayContainResults(const BlockIndex &index, const ChunkID &id, const Range<int> &range) const
+{
+  return index.mayContain(id, m_query.requiredBlocks(), range.begin() >> 4, range.end() >> 4);
+}
+
+SearchPluginI::ResultListT SearchQueryPlugin::searchChunk(const Chunk &chunk, const Range<int> &range)
+{
+  return m_query.searchChunk(chunk, range);
+}
@@ -0,0 +1,38 @@
+#ifndef SEARCHQUERYPLUGIN_H
+#define SEARCHQUERYPLUGIN_H
+
+#include "search/searchplugininterface.h"
+#include "search/searchquery.h"
+
+#include <QWidget>
+#include <QLayout>
+
+class QLabel;
+class QLineEdit;
+
+
+class SearchQueryPlugin : public QWidget, public SearchPluginI
+{
+  Q_OBJECT
+
+ public:
+  explicit SearchQueryPlugin(QWidget* parent = nullptr);
+  ~SearchQueryPlugin();
+
+  QWidget &getWidget() override;
+
+  bool    initSearch() override;
+  int     neededChunkParts() const override;
+  bool    usesBlockIndex() const override;
+  bool    mayContainResults(const BlockIndex &index, const ChunkID &id, const Range<int> &range) const override;
+  SearchPluginI::ResultListT searchChunk(const Chunk &chunk, const Range<int> &range) override;
+
+ private:
+  QLayout*   layout;
+  QLineEdit* edit_query;
+  QLabel*    label_error;
+
+  SearchQuery m_query;
+};
+
+#endif // SEARCHQUERYPLUGIN_H
@@ -70,3 +70,10 @@ bool SearchRangeWidget::incrementProgressValue()
   // return true when maximum is reached
   return (ui->progressBar->value() == ui->progressBar->maximum());
 }
+
+bool SearchRangeWidget::addProgressValue(const unsigned int value)
+{
+  ui->progressBar->setValue(ui->progressBar->value() + value);
+  // return true when maximum is reached
+  return (ui->progressBar->value() == ui->progressBar->maximum());
+}
@@ -29,6 +29,7 @@ public:
   void setProgressValue(const unsigned int value);
   void setProgressMaximum(const unsigned int value);
   bool incrementProgressValue();
+  bool addProgressValue(const unsigned int value);
 
 private:
   Ui::SearchRangeWidget *ui;
@@ -0,0 +1,240 @@
+#include "search/searchresultmodel.h"
+
+#include "overlay/entity.h"
+
+#include <QIODevice>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+
+SearchResultModel::SearchResultModel(QObject *parent)
+  : QAbstractTableModel(parent)
+  , sortColumn(COLUMN_DISTANCE)
+  , sortOrder(Qt::AscendingOrder)
+{}
+
+void SearchResultModel::clear()
+{
+  beginResetModel();
+  names.clear();
+  x.clear();
+  y.clear();
+  z.clear();
+  distances.clear();
+  offers.clear();
+  properties.clear();
+  entities.clear();
+  nameTable.clear();
+  nameIds.clear();
+  order.clear();
+  endResetModel();
+}
+
+int SearchResultModel::nameId(const QString &name)
+{
+  auto it = nameIds.constFind(name);
+  if (it != nameIds.constEnd())
+    return it.value();
+  nameTable.append(name);
+  nameIds.insert(name, nameTable.size() - 1);
+  return nameTable.size() - 1;
+}
+
+// new rows are added at the end, the view is sorted again by sort()
+void SearchResultModel::append(const SearchPluginI::ResultListT &results)
+{
+  if (results.empty())
+    return;
+
+  const int first = order.size();
+  beginInsertRows(QModelIndex(), first, first + int(results.size()) - 1);
+  for (const auto &result : results) {
+    order.append(names.size());
+    names.append(nameId(result.name));
+    x.append(result.pos.x());
+    y.append(result.pos.y());
+    z.append(result.pos.z());
+    distances.append((pointOfInterest - result.pos).length());
+    offers.append(result.offers);
+    properties.append(result.properties);
+    entities.append(result.entity);
+  }
+  endInsertRows();
+}
+
+void SearchResultModel::setPointOfInterest(const QVector3D &centerPoint)
+{
+  pointOfInterest = centerPoint;
+  for (int i = 0; i < distances.size(); i++)
+    distances[i] = (pointOfInterest - QVector3D(x[i], y[i], z[i])).length();
+  if (!order.isEmpty())
+    emit dataChanged(index(0, COLUMN_DISTANCE), index(order.size() - 1, COLUMN_DISTANCE));
+}
+
+
+SearchResultItem SearchResultModel::result(int row) const
+{
+  const int item = order[row];
+  SearchResultItem result;
+  result.name       = nameTable[names[item]];
+  result.pos        = QVector3D(x[item], y[item], z[item]);
+  result.offers     = offers[item];
+  result.properties = properties[item];
+  result.entity     = entity(row);
+  return result;
+}
+
+QVector3D SearchResultModel::position(int row) const
+{
+  const int item = order[row];
+  return QVector3D(x[item], y[item], z[item]);
+}
+
+QSharedPointer<OverlayItem> SearchResultModel::entity(int row) const
+{
+  const int item = order[row];
+  if (!entities[item])
+    entities[item] = QSharedPointer<Entity>::create(OverlayItem::Point(x[item], y[item], z[item]));
+  return entities[item];
+}
+
+
+QString SearchResultModel::text(int item, int column) const
+{
+  switch (column) {
+    case COLUMN_NAME:
+      return nameTable[names[item]];
+    case COLUMN_DISTANCE:
+      return QString::number(std::roundf(distances[item]));
+    case COLUMN_COORDINATES:
+      return QString::number(int(std::round(x[item]))) + "/" +
+             QString::number(int(std::round(y[item]))) + "/" +
+             QString::number(int(std::round(z[item])));
+    case COLUMN_DETAILS:
+      return offers[item];
+  }
+  return QString();
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : order.size();
+}
+
+int SearchResultModel::columnCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() || (index.row() >= order.size()))
+    return QVariant();
+
+  switch (role) {
+    case Qt::DisplayRole:
+      return text(order[index.row()], index.column());
+    case Qt::TextAlignmentRole:
+      if ((index.column() == COLUMN_DISTANCE) || (index.column() == COLUMN_COORDINATES))
+        return int(Qt::AlignCenter);
+      break;
+  }
+  return QVariant();
+}
+
+QVariant SearchResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if ((orientation != Qt::Horizontal) || (role != Qt::DisplayRole))
+    return QAbstractTableModel::headerData(section, orientation, role);
+
+  switch (section) {
+    case COLUMN_NAME:        return tr("Name");
+    case COLUMN_DISTANCE:    return tr("Distance");
+    case COLUMN_COORDINATES: return tr("Coordinates");
+    case COLUMN_DETAILS:     return tr("Details");
+  }
+  return QVariant();
+}
+
+void SearchResultModel::sort(int column, Qt::SortOrder order_)
+{
+  sortColumn = column;
+  sortOrder  = order_;
+
+  // name ids are in order of arrival, sort by their rank in the name table
+  QVector<int> nameRank(nameTable.size());
+  {
+    QVector<int> byName(nameTable.size());
+    std::iota(byName.begin(), byName.end(), 0);
+    std::sort(byName.begin(), byName.end(),
+              [this](int a, int b) { return nameTable[a] < nameTable[b]; });
+    for (int rank = 0; rank < byName.size(); rank++)
+      nameRank[byName[rank]] = rank;
+  }
+
+  std::function<bool(int, int)> less;
+  switch (column) {
+    case COLUMN_NAME:
+      less = [&nameRank, this](int a, int b) { return nameRank[names[a]] < nameRank[names[b]]; };
+      break;
+    case COLUMN_DISTANCE:
+      less = [this](int a, int b) { return distances[a] < distances[b]; };
+      break;
+    case COLUMN_COORDINATES:
+      less = [this](int a, int b) {
+        if (x[a] != x[b]) return x[a] < x[b];
+        if (y[a] != y[b]) return y[a] < y[b];
+        return z[a] < z[b];
+      };
+      break;
+    case COLUMN_DETAILS:
+      less = [this](int a, int b) { return offers[a] < offers[b]; };
+      break;
+    default:
+      return;
+  }
+
+  emit layoutAboutToBeChanged();
+  const QModelIndexList persistent = persistentIndexList();
+  QVector<int> persistentItems;
+  for (const QModelIndex &index : persistent)
+    persistentItems.append(order[index.row()]);
+
+  if (sortOrder == Qt::AscendingOrder)
+    std::stable_sort(order.begin(), order.end(), less);
+  else
+    std::stable_sort(order.begin(), order.end(), [&less](int a, int b) { return less(b, a); });
+
+  // keep selection and current item on the same results
+  QVector<int> rowOf(order.size());
+  for (int row = 0; row < order.size(); row++)
+    rowOf[order[row]] = row;
+  QModelIndexList moved;
+  for (int i = 0; i < persistent.size(); i++)
+    moved.append(index(rowOf[persistentItems[i]], persistent[i].column()));
+  changePersistentIndexList(persistent, moved);
+  emit layoutChanged();
+}
+
+
+bool SearchResultModel::writeTsv(QIODevice *device) const
+{
+  const QString delim = "\t";
+  QTextStream ts(device);
+
+  // Write header.
+  for (int col = 0; col < COLUMN_COUNT; col++) {
+    ts << headerData(col, Qt::Horizontal).toString() << ((col < COLUMN_COUNT - 1) ? delim : "\n");
+  }
+  // Write the data as it appears in the search results view.
+  for (int row = 0; row < order.size(); row++) {
+    for (int col = 0; col < COLUMN_COUNT; col++) {
+      ts << text(order[row], col) << ((col < COLUMN_COUNT - 1) ? delim : "\n");
+    }
+  }
+  ts.flush();
+  return (ts.status() == QTextStream::Ok);
+}
@@ -0,0 +1,74 @@
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include "search/searchplugininterface.h"
+#include "search/searchresultitem.h"
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector3D>
+#include <QVector>
+
+class OverlayItem;
+class QIODevice;
+
+
+// Table of search results for a QTreeView.
+//
+// Results are kept in flat columns (name ids, coordinates, distance, ...),
+// texts are only formatted for the rows the view asks for, sorting works on
+// the numeric columns and a row order vector. Results are appended in
+// batches, so millions of results can be shown without freezing the UI.
+class SearchResultModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+ public:
+  enum Column { COLUMN_NAME, COLUMN_DISTANCE, COLUMN_COORDINATES, COLUMN_DETAILS, COLUMN_COUNT };
+
+  explicit SearchResultModel(QObject *parent = nullptr);
+
+  void clear();
+  void append(const SearchPluginI::ResultListT &results);
+  void setPointOfInterest(const QVector3D &centerPoint);
+
+  // access by view row
+  SearchResultItem             result(int row) const;
+  QVector3D                    position(int row) const;
+  QSharedPointer<OverlayItem>  entity(int row) const;  // created on demand for Block results
+
+  // tab separated values, rows in current order
+  bool writeTsv(QIODevice *device) const;
+
+  // QAbstractItemModel
+  int      rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int      columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+  void     sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+ private:
+  QString text(int item, int column) const;
+  int     nameId(const QString &name);
+
+  QVector3D            pointOfInterest;
+
+  // result store, one entry per result in order of arrival
+  QVector<int>         names;       // index into nameTable
+  QVector<double>      x, y, z;
+  QVector<float>       distances;
+  QVector<QString>     offers;
+  QVector<QVariant>    properties;
+  mutable QVector<QSharedPointer<OverlayItem>> entities;
+
+  QStringList          nameTable;
+  QHash<QString, int>  nameIds;
+
+  QVector<int>         order;       // view row -> result
+  int                  sortColumn;
+  Qt::SortOrder        sortOrder;
+};
+
+#endif // SEARCHRESULTMODEL_H
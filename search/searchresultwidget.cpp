@@ -1,22 +1,26 @@
+#include <QHeaderView>
+#include <QItemSelectionModel>
 #include <QMessageBox>
-#include <QTextStream>
 #include <QtWidgets/QFileDialog>
-#include <cmath>
+#include <algorithm>
 
 #include "search/searchresultwidget.h"
+#include "search/searchresultmodel.h"
 #include "ui_searchresultwidget.h"
 
 #include "overlay/properties.h"
 
-Q_DECLARE_METATYPE(SearchResultItem);
-
 SearchResultWidget::SearchResultWidget(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::SearchResultWidget)
+    ui(new Ui::SearchResultWidget),
+    model(new SearchResultModel(this))
 {
   ui->setupUi(this);
 
-  ui->treeWidget->sortByColumn(1, Qt::SortOrder::AscendingOrder);
+  ui->treeView->setModel(model);
+  ui->treeView->sortByColumn(SearchResultModel::COLUMN_DISTANCE, Qt::SortOrder::AscendingOrder);
+  connect(ui->treeView->selectionModel(), &QItemSelectionModel::currentRowChanged,
+          this, &SearchResultWidget::currentRowChanged);
 }
 
 SearchResultWidget::~SearchResultWidget()
@@ -26,58 +30,27 @@ SearchResultWidget::~SearchResultWidget()
 
 void SearchResultWidget::clearResults()
 {
-  ui->treeWidget->clear();
-}
-
-namespace {
-
-  class MyTreeWidgetItem : public QTreeWidgetItem {
-    public:
-    MyTreeWidgetItem(QTreeWidget* parent):QTreeWidgetItem(parent){}
-    private:
-    bool operator<(const QTreeWidgetItem &other)const {
-      int column = treeWidget()->sortColumn();
-      switch (column) {
-        case 1:
-          return text(column).toDouble() < other.text(column).toDouble();
-        default:
-          return QTreeWidgetItem::operator<(other);
-      }
-    }
-  };
-
+  model->clear();
 }
 
 void SearchResultWidget::addResult(const SearchResultItem &result)
 {
-  if (ui->treeWidget->topLevelItemCount() > 16000)
-    return;
-
-  auto item = new MyTreeWidgetItem(nullptr);
-  item->setData(0, Qt::UserRole, QVariant::fromValue(result));
-
-  QVector3D distance = pointOfInterest - result.pos;
-  float slopeDistance = distance.length();
-
-  int c = 0;
-  item->setText(c++, result.name);
-  item->setTextAlignment(c, Qt::AlignHCenter);
-  item->setText(c++, QString::number(std::roundf(slopeDistance)));
-  item->setTextAlignment(c, Qt::AlignHCenter);
-  item->setText(c++, QString().number(int(std::roundf(result.pos.x()))) + "/" +
-                     QString().number(int(std::roundf(result.pos.y()))) + "/" +
-                     QString().number(int(std::roundf(result.pos.z()))) );
-  item->setText(c++, result.offers);
-
-  ui->treeWidget->addTopLevelItem(item);
+  model->append(SearchPluginI::ResultListT(1, result));
+}
 
+void SearchResultWidget::addResults(const SearchPluginI::ResultListT &results)
+{
+  model->append(results);
 }
 
 void SearchResultWidget::searchDone()
 {
+  // new results were appended at the end -> sort once
+  const QHeaderView *header = ui->treeView->header();
+  model->sort(header->sortIndicatorSection(), header->sortIndicatorOrder());
   // adapt width of result columns
-  for (int i = 0; i < ui->treeWidget->columnCount(); i++)
-      ui->treeWidget->resizeColumnToContents(i);
+  for (int i = 0; i < model->columnCount(); i++)
+      ui->treeView->resizeColumnToContents(i);
   // update overlay items
   on_check_display_all_stateChanged();
   // update search status
@@ -87,44 +60,39 @@ void SearchResultWidget::searchDone()
 void SearchResultWidget::setPointOfInterest(const QVector3D &centerPoint)
 {
   pointOfInterest = centerPoint;
+  model->setPointOfInterest(centerPoint);
   updateStatusText();
 }
 
-void SearchResultWidget::on_treeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column)
+void SearchResultWidget::on_treeView_doubleClicked(const QModelIndex &index)
 {
-  // TODO(search): unused parameter
-  Q_UNUSED(column);
+  if (!index.isValid())
+    return;
 
   auto properties = new Properties();
 
-  auto props = item->data(0, Qt::UserRole).value<SearchResultItem>().properties;
+  auto props = model->result(index.row()).properties;
   properties->DisplayProperties(props);
   properties->showNormal();
 }
 
-void SearchResultWidget::on_treeWidget_itemSelectionChanged()
+void SearchResultWidget::currentRowChanged(const QModelIndex &current)
 {
-  auto list = ui->treeWidget->selectedItems();
-  if (list.size() > 0) {
-    auto item = list[0];
-    auto data = item->data(0, Qt::UserRole).value<SearchResultItem>();
-    emit jumpTo(data.pos);
+  if (current.isValid()) {
+    emit jumpTo(model->position(current.row()));
 
     if (!ui->check_display_all->isChecked()) {
       QVector<QSharedPointer<OverlayItem> > items;
-      items.push_back(data.entity);
+      items.push_back(model->entity(current.row()));
 
       emit updateSearchResultPositions(items);
     }
   }
 }
 
-void SearchResultWidget::on_treeWidget_itemClicked(QTreeWidgetItem *item, int column)
+void SearchResultWidget::on_treeView_clicked(const QModelIndex &index)
 {
-  // TODO(search): unused parameter
-  Q_UNUSED(item);
-  Q_UNUSED(column);
-  on_treeWidget_itemSelectionChanged();
+  currentRowChanged(index);
 }
 
 void SearchResultWidget::on_check_display_all_stateChanged()
@@ -132,12 +100,11 @@ void SearchResultWidget::on_check_display_all_stateChanged()
   QVector<QSharedPointer<OverlayItem> > items;
 
   if (ui->check_display_all->isChecked()) {
-    const int count = ui->treeWidget->topLevelItemCount();
-    for (int i = 0; i < count; i++) {
-      auto item = ui->treeWidget->topLevelItem(i);
-      auto data = item->data(0, Qt::UserRole).value<SearchResultItem>();
-
-      items.push_back(data.entity);
+    // in current order, e.g. the nearest ones
+    const int count = std::min(model->rowCount(), MAX_DISPLAYED_ON_MAP);
+    items.reserve(count);
+    for (int row = 0; row < count; row++) {
+      items.push_back(model->entity(row));
     }
   }
 
@@ -150,7 +117,7 @@ void SearchResultWidget::updateStatusText()
                               .arg(pointOfInterest.x())
                               .arg(pointOfInterest.y())
                               .arg(pointOfInterest.z())
-                              .arg(ui->treeWidget->topLevelItemCount()));
+                              .arg(model->rowCount()));
 }
 
 void SearchResultWidget::on_saveSearchResults_clicked() {
@@ -163,8 +130,6 @@ void SearchResultWidget::on_saveSearchResults_clicked() {
   if (saveFilename.isEmpty())
     return;
 
-  QString delim = "\t";
-
   // Ensure filename suffix.
   QFile f(saveFilename);
   QFileInfo fileInfo(f);
@@ -181,30 +146,9 @@ void SearchResultWidget::on_saveSearchResults_clicked() {
     errMsgBox.exec();
     return;
   }
-  QTextStream ts(&f);
 
-  // Write header.
-  const QTreeWidgetItem *header = ui->treeWidget->headerItem();
-  int nCol = header->columnCount();
-  for (int col = 0; col < nCol - 1; col++) {
-    ts << header->text(col) << delim;
-  }
-  ts << header->text(nCol - 1) << "\n";
-
-  QTreeWidgetItemIterator iter(ui->treeWidget);
-  // Write the data as it appears in the search results widget.
-  // TODO: Consider adding structure to output data based on the
-  // nature of the search/search results.
-  while (*iter) {
-    // Write columns separated by delimiters.
-    int nCol = (*iter)->columnCount();
-    for (int col = 0; col < nCol - 1; col++) {
-      ts << (*iter)->text(col) << delim;
-    }
-    // Write last column and start a new line
-    ts << (*iter)->text(nCol - 1) << "\n";
-    ++iter;
-  }
+  // streamed directly from the result store
+  model->writeTsv(&f);
 
   f.flush();
   f.close();
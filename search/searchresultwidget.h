@@ -2,14 +2,16 @@
 #define SEARCHRESULTWIDGET_H
 
 #include "overlay/properties.h"
+#include "search/searchplugininterface.h"
 #include "search/searchresultitem.h"
 
 #include <QWidget>
 #include <QVector3D>
 #include <QSharedPointer>
 
-class QTreeWidgetItem;
+class QModelIndex;
 class OverlayItem;
+class SearchResultModel;
 
 namespace Ui {
 class SearchResultWidget;
@@ -25,6 +27,7 @@ class SearchResultWidget : public QWidget
 
   void clearResults();
   void addResult(const SearchResultItem &result);
+  void addResults(const SearchPluginI::ResultListT &results);
   void searchDone();
 
   void setPointOfInterest(const QVector3D& centerPoint);
@@ -34,11 +37,11 @@ class SearchResultWidget : public QWidget
   void updateSearchResultPositions(QVector<QSharedPointer<OverlayItem> >);
 
  protected slots:
-  void on_treeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column);
+  void on_treeView_doubleClicked(const QModelIndex &index);
  private slots:
-  void on_treeWidget_itemSelectionChanged();
+  void currentRowChanged(const QModelIndex &current);
 
-  void on_treeWidget_itemClicked(QTreeWidgetItem *item, int column);
+  void on_treeView_clicked(const QModelIndex &index);
 
   void on_check_display_all_stateChanged();
 
@@ -46,6 +49,10 @@ class SearchResultWidget : public QWidget
 
  private:
   Ui::SearchResultWidget *ui;
+  SearchResultModel      *model;
+
+  // overlay items created for "display all on map" are limited
+  static const int MAX_DISPLAYED_ON_MAP = 100000;
 
   QVector3D pointOfInterest;
 
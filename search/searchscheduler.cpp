@@ -0,0 +1,265 @@
+#include "search/searchscheduler.h"
+#include "search/rectangleinnertoouteriterator.h"
+
+#include "chunkcache.h"
+#include "chunkloader.h"
+#include "regionfile.h"
+
+#include <QDirIterator>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+SearchScheduler::SearchScheduler(QSharedPointer<SearchPluginI> searchPlugin_,
+                                 const Range<int> &range_y_, const StopCondition &stop_)
+  : searchPlugin(searchPlugin_)
+  , range_y(range_y_)
+  , stop(stop_)
+  , nextBatch(0)
+  , activeWorkers(0)
+  , resultCount(0)
+  , canceled(0)
+  , nearest(std::numeric_limits<qint64>::max())
+{
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+}
+
+SearchScheduler::~SearchScheduler()
+{
+  cancel();
+}
+
+int SearchScheduler::start(const QVector3D &center_, unsigned int radiusChunks)
+{
+  center = center_;
+
+  // group Chunks by Region, keeping the inner to outer order of the batches
+  QHash<QPair<int, int>, int> openBatch;  // Region -> index of batch still filling
+  int count = 0;
+  for (RectangleInnerToOuterIterator it(center, radiusChunks); it != it.end(); ++it) {
+    const QPair<int, int> region(it->x() >> 5, it->y() >> 5);
+    auto open = openBatch.find(region);
+    if ((open == openBatch.end()) || (batches[open.value()].chunks.size() >= BATCH_SIZE)) {
+      appendBatch(region.first, region.second);
+      open = openBatch.insert(region, batches.size() - 1);
+    }
+    batches[open.value()].chunks.append(ChunkID(it->x(), it->y()));
+    count++;
+  }
+
+  return launch(count);
+}
+
+int SearchScheduler::startWorld(const QVector3D &center_)
+{
+  center = center_;
+
+  // all region files of this dimension: "r.X.Z.mca"
+  QVector<QPair<int, int>> regions;
+  QDirIterator it(ChunkCache::Instance().getPath() + "/region", QStringList() << "*.mca");
+  while (it.hasNext()) {
+    it.next();
+    const QStringList nameParts = it.fileName().split(".");
+    if ((nameParts.length() != 4) || (it.fileInfo().size() == 0))
+      continue;
+    regions.append(QPair<int, int>(nameParts[1].toInt(), nameParts[2].toInt()));
+  }
+
+  // nearest Regions first, inner to outer inside each Region
+  auto regionDistance2 = [this](const QPair<int, int> &region) {
+    return minimumDistance2(ChunkID(region.first * 32 + 16, region.second * 32 + 16));
+  };
+  std::sort(regions.begin(), regions.end(),
+            [&regionDistance2](const QPair<int, int> &a, const QPair<int, int> &b) {
+              return regionDistance2(a) < regionDistance2(b);
+            });
+
+  int count = 0;
+  for (const auto &region : regions) {
+    QVector<ChunkID> chunks;
+    chunks.reserve(32 * 32);
+    for (int cz = region.second * 32; cz < (region.second + 1) * 32; cz++)
+      for (int cx = region.first * 32; cx < (region.first + 1) * 32; cx++)
+        chunks.append(ChunkID(cx, cz));
+    std::sort(chunks.begin(), chunks.end(), [this](const ChunkID &a, const ChunkID &b) {
+      return minimumDistance2(a) < minimumDistance2(b);
+    });
+    for (int first = 0; first < chunks.size(); first += BATCH_SIZE)
+      appendBatch(region.first, region.second).chunks = chunks.mid(first, BATCH_SIZE);
+    count += chunks.size();
+  }
+
+  return launch(count);
+}
+
+SearchScheduler::Batch &SearchScheduler::appendBatch(int rx, int rz)
+{
+  Batch batch;
+  batch.rx = rx;
+  batch.rz = rz;
+  if (searchPlugin->usesBlockIndex()) {
+    QSharedPointer<RegionIndex> &slot = regionIndex[QPair<int, int>(rx, rz)];
+    if (!slot)
+      slot = QSharedPointer<RegionIndex>::create(ChunkCache::Instance().getPath(), rx, rz);
+    slot->pendingBatches.ref();
+    batch.index = slot;
+  }
+  batches.append(batch);
+  return batches.last();
+}
+
+int SearchScheduler::launch(int count)
+{
+  // nearest only: closest batches first, so the search can end at the first
+  // batch farther away than the nearest result
+  for (Batch &batch : batches) {
+    batch.minDistance2 = std::numeric_limits<qint64>::max();
+    for (const ChunkID &id : qAsConst(batch.chunks))
+      batch.minDistance2 = std::min(batch.minDistance2, minimumDistance2(id));
+  }
+  if (stop.nearestOnly)
+    std::stable_sort(batches.begin(), batches.end(), [](const Batch &a, const Batch &b) {
+      return a.minDistance2 < b.minDistance2;
+    });
+
+  const int threads = std::max(1, std::min(pool.maxThreadCount(), int(batches.size())));
+  activeWorkers.storeRelease(threads);
+  for (int i = 0; i < threads; i++)
+    workers.append(QtConcurrent::run(&pool, [this]() { worker(); }));
+
+  return count;
+}
+
+void SearchScheduler::cancel()
+{
+  canceled.storeRelease(1);
+  for (auto &future : workers)
+    future.waitForFinished();
+  workers.clear();
+
+  // Regions with batches left out by the cancel
+  for (auto &slot : regionIndex)
+    releaseIndex(*slot);
+}
+
+void SearchScheduler::worker()
+{
+  while (!canceled.loadAcquire()) {
+    const int index = nextBatch.fetchAndAddRelaxed(1);
+    if (index >= batches.size())
+      break;
+    // all remaining batches are farther away, without opening their region files
+    if (stop.nearestOnly && (batches[index].minDistance2 > nearest.loadAcquire()))
+      break;
+    processBatch(batches[index]);
+  }
+  // the last worker reports the end of the search
+  if (!activeWorkers.deref())
+    emit finished();
+}
+
+void SearchScheduler::processBatch(const Batch &batch)
+{
+  const int  parts        = searchPlugin->neededChunkParts();
+  const bool withEntities = (parts & ChunkLoader::PART_ENTITIES);
+  const bool entitiesOnly = !(parts & ChunkLoader::PART_BLOCKS);
+  const QString path = ChunkCache::Instance().getPath();
+  RegionFile region(RegionFile::filename(path, "region", batch.rx, batch.rz));
+  RegionFile entityRegion(RegionFile::filename(path, "entities", batch.rx, batch.rz));
+
+  // refresh the Block index from the region header and skip Chunks without any searched Block,
+  // Chunks without valid entry are indexed after they were decoded for the search
+  QVector<ChunkID> chunks = batch.chunks;
+  QSet<ChunkID>    unindexed;
+  QVector<QPair<ChunkID, BlockIndex::Postings>> indexed;
+  if (batch.index) {
+    RegionIndex &slot = *batch.index;
+    QMutexLocker guard(&slot.mutex);
+    if (!slot.loaded) {
+      slot.index.load();
+      slot.loaded = true;
+    }
+    for (const ChunkID &id : slot.index.refresh(region, batch.chunks))
+      unindexed.insert(id);
+    chunks.clear();
+    for (const ChunkID &id : batch.chunks)
+      if (searchPlugin->mayContainResults(slot.index, id, range_y))
+        chunks.append(id);
+  }
+
+  auto results = QSharedPointer<SearchPluginI::ResultListT>::create();
+  for (const ChunkID &id : qAsConst(chunks)) {
+    if (canceled.loadAcquire())
+      break;
+    // no closer result possible in this Chunk
+    if (stop.nearestOnly && (minimumDistance2(id) > nearest.loadAcquire()))
+      continue;
+
+    QSharedPointer<Chunk> chunk = entitiesOnly
+        ? ChunkCache::Instance().getEntitiesSynchronously(id, CachePolicy::scan, region, entityRegion)
+        : ChunkCache::Instance().getChunkSynchronously(id, withEntities, CachePolicy::scan,
+                                                        region, entityRegion,
+                                                        ChunkLoader::decodeChannels(parts));
+    if (unindexed.contains(id))
+      indexed.append(qMakePair(id, chunk ? BlockIndex::indexChunk(*chunk) : BlockIndex::Postings()));
+    if (!chunk)
+      continue;
+
+    const SearchPluginI::ResultListT found = searchPlugin->searchChunk(*chunk, range_y);
+    if (stop.nearestOnly)
+      updateNearest(found);
+    results->insert(results->end(), found.begin(), found.end());
+  }
+
+  if ((stop.maxResults > 0) && !results->empty()) {
+    const int before = resultCount.fetchAndAddRelaxed(int(results->size()));
+    if (before + int(results->size()) >= stop.maxResults) {
+      results->resize(std::max(0, stop.maxResults - before));
+      canceled.storeRelease(1);
+    }
+  }
+
+  if (batch.index && !indexed.isEmpty()) {
+    QMutexLocker guard(&batch.index->mutex);
+    for (const auto &entry : qAsConst(indexed))
+      batch.index->index.record(entry.first, entry.second);
+  }
+  if (batch.index && !batch.index->pendingBatches.deref())
+    releaseIndex(*batch.index);
+
+  emit resultsReady(results, batch.chunks.size());
+}
+
+void SearchScheduler::releaseIndex(RegionIndex &slot)
+{
+  QMutexLocker guard(&slot.mutex);
+  if (slot.index.isModified())
+    slot.index.save();
+  slot.index.clear();
+  slot.loaded = false;
+}
+
+// squared horizontal distance from center to the closest Block of a Chunk
+qint64 SearchScheduler::minimumDistance2(const ChunkID &id) const
+{
+  const double x1 = id.getX() * 16;
+  const double z1 = id.getZ() * 16;
+  const double dx = std::max(0.0, std::max(x1 - center.x(), center.x() - (x1 + 16)));
+  const double dz = std::max(0.0, std::max(z1 - center.z(), center.z() - (z1 + 16)));
+  return static_cast<qint64>(dx * dx + dz * dz);
+}
+
+void SearchScheduler::updateNearest(const SearchPluginI::ResultListT &results)
+{
+  for (const auto &result : results) {
+    const qint64 d2 = static_cast<qint64>(std::ceil((result.pos - center).lengthSquared()));
+    qint64 current = nearest.loadAcquire();
+    while ((d2 < current) && !nearest.testAndSetOrdered(current, d2))
+      current = nearest.loadAcquire();
+  }
+}
@@ -0,0 +1,104 @@
+#ifndef SEARCHSCHEDULER_H
+#define SEARCHSCHEDULER_H
+
+#include "blockindex.h"
+#include "chunkid.h"
+#include "search/range.h"
+#include "search/searchplugininterface.h"
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QVector3D>
+#include <QVector>
+
+
+// Runs a search plugin over all Chunks in a square around a center point.
+//
+// Chunks are ordered inner to outer and grouped into batches of one Region,
+// a batch opens its region files once for all its Chunks. Workers take the
+// next unprocessed batch until none is left, so fast threads help out with
+// the remaining work instead of waiting. The results of a batch are handed
+// over at once.
+//
+// Plugins searching for Block states use the persistent BlockIndex: each
+// batch first refreshes the index of its Chunks from the region header and
+// then loads only Chunks that can contain results. Chunks without valid
+// entry are indexed from the decode of the search itself, outside of the
+// lock of the Region. The index of a Region is written when its last batch
+// is done.
+class SearchScheduler : public QObject
+{
+  Q_OBJECT
+
+ public:
+  struct StopCondition {
+    int  maxResults  = 0;      // stop after this many results, 0 = search all
+    bool nearestOnly = false;  // skip Chunks that can not contain a closer result,
+                               // stop when no batch left can
+  };
+
+  SearchScheduler(QSharedPointer<SearchPluginI> searchPlugin, const Range<int> &range_y,
+                  const StopCondition &stop);
+  ~SearchScheduler();
+
+  // start the search, returns the number of Chunks reported in resultsReady()
+  int  start(const QVector3D &center, unsigned int radiusChunks);
+  int  startWorld(const QVector3D &center);  // all existing Regions of the dimension
+  void cancel();  // waits until running batches are done
+
+  static const int BATCH_SIZE = 64;  // maximum Chunks per batch
+
+ signals:
+  // called from worker threads, connect queued to the UI
+  void resultsReady(QSharedPointer<SearchPluginI::ResultListT> results, int chunksDone);
+  void finished();
+
+ private:
+  struct RegionIndex {
+    RegionIndex(const QString &path, int rx, int rz) : index(path, rx, rz), pendingBatches(0) {}
+    QMutex     mutex;
+    BlockIndex index;
+    bool       loaded = false;
+    QAtomicInt pendingBatches;
+  };
+
+  struct Batch {
+    int rx, rz;
+    QVector<ChunkID> chunks;
+    QSharedPointer<RegionIndex> index;  // when the plugin uses the Block index
+    qint64 minDistance2 = 0;            // of the closest Chunk
+  };
+
+  Batch &appendBatch(int rx, int rz);
+  int  launch(int chunkCount);
+  void worker();
+  void processBatch(const Batch &batch);
+  void releaseIndex(RegionIndex &slot);  // write and free the index of a Region
+  qint64 minimumDistance2(const ChunkID &id) const;
+  void   updateNearest(const SearchPluginI::ResultListT &results);
+
+  QSharedPointer<SearchPluginI> searchPlugin;
+  const Range<int>    range_y;
+  const StopCondition stop;
+  QVector3D           center;
+  QVector<Batch>      batches;
+  QHash<QPair<int, int>, QSharedPointer<RegionIndex>> regionIndex;
+
+  QAtomicInt             nextBatch;
+  QAtomicInt             activeWorkers;
+  QAtomicInt             resultCount;
+  QAtomicInt             canceled;
+  QAtomicInteger<qint64> nearest;  // squared distance of nearest result (rounded up)
+
+  QThreadPool          pool;
+  QList<QFuture<void>> workers;
+};
+
+#endif // SEARCHSCHEDULER_H
@@ -1,7 +1,6 @@
 #include "search/searchtextwidget.h"
 #include "ui_searchtextwidget.h"
 
-#include <QRegExp>
 
 SearchTextWidget::SearchTextWidget(const QString &name, QWidget *parent)
   : QWidget(parent)
@@ -61,11 +60,42 @@ QString SearchTextWidget::getSearchText() const
 
 bool SearchTextWidget::matches(const QString &textToSearch) const
 {
-  QRegExp matcher(getSearchText(), Qt::CaseInsensitive, QRegExp::Wildcard);
+  return getMatcher().matches(textToSearch);
+}
 
+SearchTextWidget::Matcher SearchTextWidget::getMatcher() const
+{
+  // translate wildcard pattern: "*" any text, "?" any character, "[...]" character set
+  const QString text = getSearchText();
+  QString pattern;
+  for (int i = 0; i < text.size(); i++) {
+    const QChar c = text[i];
+    if (c == '*') {
+      pattern += ".*";
+    } else if (c == '?') {
+      pattern += ".";
+    } else if ((c == '[') && (text.indexOf(']', i + 1) > i + 1)) {
+      const int end = text.indexOf(']', i + 1);
+      QString set = text.mid(i, end - i + 1);
+      if (set.startsWith("[!"))
+        set[1] = '^';
+      pattern += set;
+      i = end;
+    } else {
+      pattern += QRegularExpression::escape(QString(c));
+    }
+  }
   if (exactMatch()) {
-    return matcher.exactMatch(textToSearch);
-  } else {
-    return (matcher.indexIn(textToSearch) >= 0);
+    pattern = "\\A(?:" + pattern + ")\\z";
   }
+
+  Matcher matcher;
+  matcher.m_active = active();
+  matcher.m_regexp = QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption);
+  return matcher;
+}
+
+bool SearchTextWidget::Matcher::matches(const QString &textToSearch) const
+{
+  return m_regexp.match(textToSearch).hasMatch();
 }
@@ -2,6 +2,7 @@
 #define SEARCHTEXTWIDGET_H
 
 #include <QWidget>
+#include <QRegularExpression>
 
 namespace Ui {
 class SearchTextWidget;
@@ -12,6 +13,19 @@ class SearchTextWidget : public QWidget
   Q_OBJECT
 
  public:
+  // snapshot of the entered search criterion, can be used from worker threads
+  class Matcher
+  {
+   public:
+    bool active() const { return m_active; }
+    bool matches(const QString& textToSearch) const;
+
+   private:
+    friend class SearchTextWidget;
+    bool               m_active = false;
+    QRegularExpression m_regexp;
+  };
+
   explicit SearchTextWidget(const QString& name, QWidget *parent = nullptr);
   ~SearchTextWidget();
 
@@ -28,6 +42,7 @@ class SearchTextWidget : public QWidget
   QString getSearchText() const;
 
   bool matches(const QString& textToSearch) const;
+  Matcher getMatcher() const;
 
  private:
   Ui::SearchTextWidget *ui;
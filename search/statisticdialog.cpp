@@ -1,9 +1,8 @@
 /** Copyright (c) 2022, EtlamGit */
 
 #include <algorithm>
-#include <iostream>
-#include <fstream>
 #include <QFileDialog>
+#include <QTextStream>
 #include <QtConcurrent/QtConcurrent>
 
 #include "statisticdialog.h"
@@ -45,6 +44,9 @@ StatisticDialog::StatisticDialog(QWidget *parent)
 
 StatisticDialog::~StatisticDialog()
 {
+  canceled.storeRelease(1);
+  for (auto &worker : workers)
+    worker.waitForFinished();
   delete ui;
 }
 
@@ -70,100 +72,94 @@ void StatisticDialog::setSearchCenter(int x, int y, int z)
 // auto-magically connected via name match
 void StatisticDialog::on_pb_search_clicked() {
   // when search is pending -> cancel and return
-  if (!currentFuture.isFinished() && !currentFuture.isCanceled()) {
+  if (!workers.isEmpty()) {
     cancelSearch();
     return;
   }
 
   // determine Chunks to be searched
-  auto chunks = QSharedPointer< QList<ChunkID> >::create();
+  chunks.clear();
   const int radius = ui->range->getRadiusChunks();
   for (RectangleInnerToOuterIterator it(searchCenter, radius); it != it.end(); ++it) {
-    const ChunkID id(it->x(), it->y());
-    chunks->append(id);
+    chunks.append(ChunkID(it->x(), it->y()));
   }
 
   // prepare UI
   ui->range->setButtonText("Cancel");
-  ui->range->setProgressMaximum(chunks->size());
+  ui->range->setProgressMaximum(chunks.size());
   ui->range->setProgressValue(0);
   clearResults();
 
   // setup search parameters
-  const Range<int>   rangeY  = ui->range->getRangeY();
-
-  // get HID for selected "block name"
-  QList<quint32> blockHID;
-  for (const auto hid: BlockIdentifier::Instance().getKnownIds()) {
-    auto blockInfo = BlockIdentifier::Instance().getBlockInfo(hid);
-    if (stw_blockName->matches(blockInfo.getName())) blockHID.append(hid);
+  const Range<int> rangeY = ui->range->getRangeY();
+  histogram.reset();
+  partials.clear();
+  nextChunk.storeRelease(0);
+  canceled.storeRelease(0);
+
+  const int threads = QThreadPool::globalInstance()->maxThreadCount();
+  for (int i = 0; i < threads; i++) {
+    auto partial = QSharedPointer<BlockHistogram>::create(rangeY.begin(), rangeY.end());
+    partials.append(partial);
+    workers.append(QtConcurrent::run([this, partial]() { countChunks_async(partial); }));
   }
-
-  currentStatistic = QSharedPointer<AsyncStatistic>::create(*this, rangeY, blockHID);
-
-  std::function<StatisticResultMap(const ChunkID &)> mapper =
-      [currentStatistic = currentStatistic, chunks /* needed to keep list alive during search */]
-      (const ChunkID &id) -> StatisticResultMap
-      { return currentStatistic->processChunk_async(id); };
-
-  currentFuture = QtConcurrent::mappedReduced(
-        *chunks,
-        mapper,
-        StatisticDialog::AsyncStatistic::reduceResults
-  );
 }
 
 
 // auto-magically connected via name match
 void StatisticDialog::on_pb_save_clicked() {
-  if (currentFuture.isFinished()) {
-    const auto &resultList = currentFuture.results();
-    if (resultList.size() == 1) {
-      const auto &resultMap  = resultList[0];
-
-      // get filename to save to
-      QFileDialog fileDialog(this);
-      fileDialog.setDefaultSuffix("csv");
-      QString filename = fileDialog.getSaveFileName(this, tr("Save statistic results into file"),
-                                                    QString(), "Comma Separated Value (*.csv)");
-      // check if filename was given
-      if (filename.isEmpty())
-        return;
-
-      // add .csv suffix if not present
-      QFile file(filename);
-      QFileInfo fileinfo(file);
-      if (fileinfo.suffix().isEmpty()) {
-        filename.append(".csv");
-      }
+  if (!histogram || !workers.isEmpty())
+    return;
 
-      // write
-      std::ofstream myfile(filename.toStdString());
-      if (myfile.is_open()) {
-        // CSV header
-        myfile << "Y;count;air;total" << std::endl;
-        // results in reverse order
-        QMapIterator<int, StatisticResultItem> key(resultMap);
-        key.toBack();
-        while (key.hasPrevious()) {
-          key.previous();
-          const StatisticResultItem &result = resultMap.value(key.key());
-          myfile << key.key() << ";"
-                 << result.count << ";"
-                 << result.air << ";"
-                 << result.total << std::endl;
-        }
-        myfile.close();
-      }
+  // get filename to save to
+  const QString filterSelected = tr("Selected blocks (*.csv)");
+  const QString filterAllCsv   = tr("All blocks, one column per block (*.csv)");
+  const QString filterAllJson  = tr("All blocks as JSON (*.json)");
+  QString selectedFilter = filterSelected;
+  QString filename = QFileDialog::getSaveFileName(this, tr("Save statistic results into file"), QString(),
+                                                  filterSelected + ";;" + filterAllCsv + ";;" + filterAllJson,
+                                                  &selectedFilter);
+  // check if filename was given
+  if (filename.isEmpty())
+    return;
+
+  // add suffix if not present
+  if (QFileInfo(filename).suffix().isEmpty()) {
+    filename.append((selectedFilter == filterAllJson) ? ".json" : ".csv");
+  }
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    return;
+
+  if (selectedFilter == filterAllCsv) {
+    histogram->writeCsv(&file);
+  } else if (selectedFilter == filterAllJson) {
+    histogram->writeJson(&file);
+  } else {
+    QTextStream out(&file);
+    // CSV header
+    out << "Y;count;air;total\n";
+    // results in reverse order
+    QMapIterator<int, StatisticResultItem> key(resultMap);
+    key.toBack();
+    while (key.hasPrevious()) {
+      key.previous();
+      const StatisticResultItem &result = key.value();
+      out << key.key() << ";"
+          << result.count << ";"
+          << result.air << ";"
+          << result.total << "\n";
     }
   }
+  file.close();
 }
 
 
 void StatisticDialog::updateStatusText()
 {
   updateResultImage();
-  if (currentFuture.isFinished() && currentFuture.results().size() == 1) {
+  if (histogram && workers.isEmpty()) {
     ui->label_result->setText(QString("%4 Blocks found around position: %1,%2,%3")
                                 .arg(searchCenter.x())
                                 .arg(searchCenter.y())
@@ -177,8 +173,10 @@ void StatisticDialog::updateStatusText()
 }
 
 
-void StatisticDialog::updateProgress() {
-  if (ui->range->incrementProgressValue()) {
+void StatisticDialog::updateProgress(int chunksDone) {
+  if (workers.isEmpty())
+    return;  // late message of a cancelled search
+  if (ui->range->addProgressValue(chunksDone)) {
     finishSearch(); // finished
   }
 }
@@ -187,14 +185,27 @@ void StatisticDialog::updateProgress() {
 void StatisticDialog::clearResults()
 {
   ui->label_graph->clear();
+  resultMap.clear();
   setFixedSize(sizeHint());
 }
 
 
 // search is finished
 void StatisticDialog::finishSearch() {
-  currentFuture.waitForFinished();
-  currentStatistic.reset();
+  if (workers.isEmpty())
+    return;
+  for (auto &worker : workers)
+    worker.waitForFinished();
+  workers.clear();
+
+  // cheap final reduce of the per worker histograms
+  if (!partials.isEmpty()) {
+    histogram = partials.takeFirst();
+    for (const auto &partial : qAsConst(partials))
+      histogram->merge(*partial);
+    partials.clear();
+  }
+  updateResultMap();
 
   // update search status
   updateStatusText();
@@ -203,15 +214,40 @@ void StatisticDialog::finishSearch() {
 }
 
 
-// search is cancelled
+// search is cancelled, counted Chunks are still shown
 void StatisticDialog::cancelSearch() {
-  if (!currentFuture.isFinished()) {
-    currentFuture.cancel();
-  }
+  canceled.storeRelease(1);
   finishSearch();
 }
 
 
+// derive the Y distribution of the selected blocks from the full histogram
+void StatisticDialog::updateResultMap()
+{
+  resultMap.clear();
+  if (!histogram)
+    return;
+
+  // get HID for selected "block name"
+  QList<quint32> blockHID;
+  for (const auto hid: histogram->getBlockIds()) {
+    auto blockInfo = BlockIdentifier::Instance().getBlockInfo(hid);
+    if (stw_blockName->matches(blockInfo.getName())) blockHID.append(hid);
+  }
+
+  const int layer = 16*16;
+  for (int y = histogram->getMinY(); y <= histogram->getMaxY(); y++) {
+    StatisticResultItem ri;
+    ri.count = 0;
+    for (const auto hid: blockHID)
+      ri.count += histogram->count(hid, y);
+    ri.air   = histogram->count(air_hid, y);
+    ri.total = histogram->getChunks() * layer;
+    resultMap[y] = ri;
+  }
+}
+
+
 void StatisticDialog::updateResultImage()
 {
   // calculate total number
@@ -219,11 +255,8 @@ void StatisticDialog::updateResultImage()
   resultSum.air   = 0;
   resultSum.total = 0;
 
-  if (currentFuture.isFinished()) {
-    const auto &resultList = currentFuture.results();
-    if (resultList.size() == 1) {
-      const auto &resultMap  = resultList[0];
-
+  if (!resultMap.isEmpty()) {
+    {
       // get overall values
       int min_key   = ui->range->getRangeY().end();
       int max_key   = ui->range->getRangeY().begin();
@@ -268,46 +301,23 @@ void StatisticDialog::updateResultImage()
 
 
 //-------------------------------------------------------------------------------------------------
-// AsyncStatistic
-
-StatisticResultMap StatisticDialog::AsyncStatistic::processChunk_async(const ChunkID &id)
-{
-  StatisticResultMap results;
-
-  QSharedPointer<Chunk> chunk = ChunkCache::Instance().getChunkSynchronously(id);
-  if (chunk) {
-    for (auto y = range_y.begin(); y <= range_y.end(); y++) {
-      StatisticResultItem ri; // init to empty Chunk layer
-      const ChunkSection * const section = chunk->getSectionByY(y);
-      if (section) {
-        int offset = (y & 0x0f) * (16*16);
-        for (int z = 0; z < 16; z++) {  // n->s
-          for (int x = 0; x < 16; x++, offset++) {  // e->w
-            quint32 hid = section->getPaletteEntry(offset).hid;
-            if (hid != parent.air_hid)   ri.air--;
-            if (block_hid.contains(hid)) ri.count++;
-          }
-        }
-      }
-      results[y] = ri;
-    }
-  }
-
-  QMetaObject::invokeMethod(&parent, "updateProgress", Qt::QueuedConnection);
-
-  return results;
-}
+// worker threads
 
-void StatisticDialog::AsyncStatistic::reduceResults(StatisticResultMap &result, const StatisticResultMap &intermediate)
+void StatisticDialog::countChunks_async(QSharedPointer<BlockHistogram> partial)
 {
-  for (auto key: intermediate.keys()) {
-    auto it = result.find(key);
-    if (it != result.end()) {
-      // combine
-      result.insert(key, it.value() + intermediate[key]);
-    } else {
-      // just move over
-      result.insert(key, intermediate[key]);
+  while (!canceled.loadAcquire()) {
+    const int first = nextChunk.fetchAndAddRelaxed(CHUNKS_PER_STEP);
+    if (first >= chunks.size())
+      break;
+    const int last = std::min<int>(first + CHUNKS_PER_STEP, chunks.size());
+    for (int i = first; i < last; i++) {
+      // Block states only
+      QSharedPointer<Chunk> chunk = ChunkCache::Instance().getChunkSynchronously(chunks[i], false,
+                                                                                 CachePolicy::scan, 0);
+      if (chunk)
+        partial->addChunk(*chunk);
     }
+    QMetaObject::invokeMethod(this, "updateProgress", Qt::QueuedConnection,
+                              Q_ARG(int, last - first));
   }
 }
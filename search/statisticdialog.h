@@ -1,6 +1,7 @@
 #ifndef STATISTICDIALOG_H
 #define STATISTICDIALOG_H
 
+#include <QAtomicInt>
 #include <QDialog>
 #include <QVector3D>
 #include <QFuture>
@@ -11,6 +12,7 @@
 #include "search/range.h"
 #include "search/statisticresultitem.h"
 
+#include "blockhistogram.h"
 #include "chunkid.h"
 #include "chunk.h"
 
@@ -37,7 +39,7 @@ class StatisticDialog : public QDialog
   void on_pb_save_clicked();
 
   void updateStatusText();
-  void updateProgress();
+  void updateProgress(int chunksDone);
 
   void clearResults();
   void finishSearch();
@@ -51,30 +53,20 @@ class StatisticDialog : public QDialog
   QPixmap             result_image;
   quint32             air_hid;
 
-  class AsyncStatistic
-  {
-   public:
-    AsyncStatistic(StatisticDialog  &parent_,
-                   const Range<int> &range_y_,
-                   const QList<quint32> &hid_)
-      : parent(parent_)
-      , range_y(range_y_)
-      , block_hid(hid_)
-    {}
-
-    StatisticResultMap processChunk_async(const ChunkID &id);
-
-    static void reduceResults(StatisticResultMap &result, const StatisticResultMap &intermediate);
-
-   private:
-    StatisticDialog& parent;
-    const Range<int> range_y;
-    QList<quint32>   block_hid;
-  };
-
-  QSharedPointer<AsyncStatistic> currentStatistic;
-  QFuture<StatisticResultMap>    currentFuture;
-  StatisticResultItem            resultSum;
+  // all block types are counted in one pass, each worker into its own histogram
+  void countChunks_async(QSharedPointer<BlockHistogram> partial);
+  void updateResultMap();
+
+  static const int CHUNKS_PER_STEP = 16;  // Chunks taken by a worker at once
+
+  QVector<ChunkID>                       chunks;     // to be counted, inner to outer
+  QAtomicInt                             nextChunk;
+  QAtomicInt                             canceled;
+  QList<QSharedPointer<BlockHistogram>>  partials;   // one per worker
+  QList<QFuture<void>>                   workers;
+  QSharedPointer<BlockHistogram>         histogram;  // merged result of last search
+  StatisticResultMap                     resultMap;  // selected blocks per Y
+  StatisticResultItem                    resultSum;
 };
 
 #endif // STATISTICDIALOG_H
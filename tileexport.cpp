@@ -0,0 +1,263 @@
+#include <zlib.h>
+#include <climits>
+#include <QAtomicInt>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFuture>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include "tileexport.h"
+#include "chunk.h"
+#include "chunkloader.h"
+#include "chunkrenderer.h"
+
+static const int MANIFEST_VERSION = 2;  // 2: slippy map layout
+static const char *MANIFEST_NAME  = "tiles.json";
+
+TileExport::TileExport(QString outputDir, QString worldPath, int depth, int flags)
+  : outputDir(outputDir)
+  , worldPath(worldPath)
+  , depth(depth)
+  , flags(flags)
+  , originX(0), originZ(0)
+  , maxZoom(0)
+{}
+
+TileExport::~TileExport() {
+}
+
+void TileExport::run() {
+  emit progress(tr("Scanning regions"), 0.0);
+  QDir().mkpath(outputDir);
+
+  // read manifest of previous run
+  QJsonObject manifest;
+  QFile manifestFile(outputDir + "/" + MANIFEST_NAME);
+  if (manifestFile.open(QIODevice::ReadOnly)) {
+    manifest = QJsonDocument::fromJson(manifestFile.readAll()).object();
+    manifestFile.close();
+  }
+  QHash<TileID, quint32> newRegions = scanRegions(worldPath);
+
+  // layout: smallest pyramid with all Regions inside, counted from the north west Region
+  originX = originZ = maxZoom = 0;
+  if (!newRegions.isEmpty()) {
+    int minX = INT_MAX, maxX = INT_MIN, minZ = INT_MAX, maxZ = INT_MIN;
+    for (auto &region : newRegions.keys()) {
+      minX = std::min(minX, region.first);
+      maxX = std::max(maxX, region.first);
+      minZ = std::min(minZ, region.second);
+      maxZ = std::max(maxZ, region.second);
+    }
+    originX = minX;
+    originZ = minZ;
+    const int size = std::max(maxX - minX, maxZ - minZ) + 1;
+    while ((1 << maxZoom) < size)
+      maxZoom++;
+  }
+
+  // other settings or layout -> all tiles of the previous run are invalid
+  const bool layoutChanged = (manifest["version"].toInt() != MANIFEST_VERSION) ||
+                             (manifest["depth"].toInt()   != depth) ||
+                             (manifest["flags"].toInt()   != flags) ||
+                             (manifest["maxZoom"].toInt() != maxZoom) ||
+                             (manifest["originX"].toInt() != originX) ||
+                             (manifest["originZ"].toInt() != originZ);
+  if (layoutChanged && !manifest.isEmpty()) {
+    for (int zoom = manifest["minZoom"].toInt(); zoom <= manifest["maxZoom"].toInt(); zoom++)
+      QDir(QString("%1/%2").arg(outputDir).arg(zoom)).removeRecursively();
+  }
+
+  QHash<TileID, quint32> oldRegions;
+  if (!layoutChanged) {
+    QJsonObject regions = manifest["regions"].toObject();
+    for (auto it = regions.constBegin(); it != regions.constEnd(); ++it) {
+      QStringList coords = it.key().split(",");
+      if (coords.size() == 2)
+        oldRegions.insert(TileID(coords[0].toInt(), coords[1].toInt()),
+                          static_cast<quint32>(it.value().toDouble()));
+    }
+  }
+
+  // find Regions that have to be rendered again or are gone
+  QList<TileID> dirty;
+  QSet<TileID>  changed;  // tiles at maxZoom
+  for (auto it = newRegions.constBegin(); it != newRegions.constEnd(); ++it) {
+    if (!oldRegions.contains(it.key()) || (oldRegions[it.key()] != it.value())) {
+      dirty.append(it.key());
+      changed.insert(tileOf(it.key()));
+    }
+  }
+  for (auto it = oldRegions.constBegin(); it != oldRegions.constEnd(); ++it) {
+    if (!newRegions.contains(it.key())) {
+      QFile::remove(tileFilename(maxZoom, tileOf(it.key())));
+      changed.insert(tileOf(it.key()));
+    }
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+  QAtomicInt done(0);
+  const double total = std::max(1, dirty.size());
+
+  // render changed Regions at full resolution
+  QList<QFuture<void>> pending;
+  for (const TileID &region : dirty) {
+    pending.append(QtConcurrent::run(&pool, [this, region, &done, total]() {
+      saveTile(maxZoom, tileOf(region), renderRegion(region));
+      emit progress(tr("Rendering regions"), (done.fetchAndAddRelaxed(1) + 1) / total);
+    }));
+  }
+  for (auto &future : pending)
+    future.waitForFinished();
+
+  // rebuild parents of changed tiles level by level
+  for (int zoom = maxZoom - 1; zoom >= 0; zoom--) {
+    QSet<TileID> parents;
+    for (auto &tile : changed)
+      parents.insert(TileID(tile.first >> 1, tile.second >> 1));
+
+    emit progress(tr("Building zoom level %1").arg(zoom), double(maxZoom - zoom) / maxZoom);
+    pending.clear();
+    for (const TileID &tile : parents) {
+      pending.append(QtConcurrent::run(&pool, [this, zoom, tile]() {
+        QImage image = buildParent(zoom, tile);
+        if (image.isNull())
+          QFile::remove(tileFilename(zoom, tile));
+        else
+          saveTile(zoom, tile, image);
+      }));
+    }
+    for (auto &future : pending)
+      future.waitForFinished();
+    changed = parents;
+  }
+
+  // write manifest for next run
+  QJsonObject regions;
+  for (auto it = newRegions.constBegin(); it != newRegions.constEnd(); ++it) {
+    regions.insert(QString("%1,%2").arg(it.key().first).arg(it.key().second),
+                   static_cast<double>(it.value()));
+  }
+  manifest = QJsonObject();
+  manifest["version"]  = MANIFEST_VERSION;
+  manifest["depth"]    = depth;
+  manifest["flags"]    = flags;
+  manifest["tileSize"] = TILE_SIZE;
+  manifest["minZoom"]  = 0;
+  manifest["maxZoom"]  = maxZoom;
+  manifest["originX"]  = originX;
+  manifest["originZ"]  = originZ;
+  manifest["regions"]  = regions;
+  if (manifestFile.open(QIODevice::WriteOnly)) {
+    manifestFile.write(QJsonDocument(manifest).toJson());
+    manifestFile.close();
+  }
+
+  emit finished();
+}
+
+TileExport::TileID TileExport::tileOf(const TileID &region) const {
+  return TileID(region.first - originX, region.second - originZ);
+}
+
+// render all Chunks of one Region into a full resolution tile
+QImage TileExport::renderRegion(const TileID &region) const {
+  QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+
+  for (int z = 0; z < 32; z++) {
+    for (int x = 0; x < 32; x++) {
+      const int cx = region.first  * 32 + x;
+      const int cz = region.second * 32 + z;
+
+      // create a temporary Chunk for tile processing
+      QSharedPointer<Chunk> chunk(new Chunk());
+      if (ChunkLoader::loadNbt(worldPath, cx, cz, chunk, false, ChunkRenderer::decodeChannels(flags))) {
+        ChunkRenderer renderer(cx, cz, depth, flags);
+        renderer.renderChunk(chunk);
+        // Chunk image is in the same memory layout as ARGB32
+        for (int y = 0; y < 16; y++) {
+          memcpy(image.scanLine(z * 16 + y) + x * 16 * 4,
+                 chunk->getImage() + y * 16 * 4, 16 * 4);
+        }
+      }
+    }
+  }
+  return image;
+}
+
+// downscale the four child tiles into one, returns null image without children
+QImage TileExport::buildParent(int zoom, const TileID &tile) const {
+  QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+  bool hasChild = false;
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  const int half = TILE_SIZE / 2;
+  for (int dz = 0; dz < 2; dz++) {
+    for (int dx = 0; dx < 2; dx++) {
+      QImage child(tileFilename(zoom + 1, TileID(tile.first * 2 + dx, tile.second * 2 + dz)));
+      if (!child.isNull()) {
+        painter.drawImage(QRect(dx * half, dz * half, half, half), child);
+        hasChild = true;
+      }
+    }
+  }
+  painter.end();
+
+  return hasChild ? image : QImage();
+}
+
+QString TileExport::tileFilename(int zoom, const TileID &tile) const {
+  return QString("%1/%2/%3/%4.png").arg(outputDir).arg(zoom).arg(tile.first).arg(tile.second);
+}
+
+void TileExport::saveTile(int zoom, const TileID &tile, const QImage &image) const {
+  QString filename = tileFilename(zoom, tile);
+  QDir().mkpath(QFileInfo(filename).path());
+  image.save(filename, "PNG");
+}
+
+// find all Regions with their signature
+QHash<TileExport::TileID, quint32> TileExport::scanRegions(const QString &path) {
+  QHash<TileID, quint32> regions;
+
+  QStringList filters;
+  filters << "*.mca";
+  QDirIterator it(path + "/region", filters);
+  while (it.hasNext()) {
+    it.next();
+    // -> split filename into parts, we expect 4 of them: "r" "X" "Z" "mca"
+    QStringList nameParts = it.fileName().split(".");
+    if (nameParts.length() != 4)
+      continue;
+
+    quint32 signature = regionSignature(it.filePath());
+    if (signature != 0)
+      regions.insert(TileID(nameParts[1].toInt(), nameParts[2].toInt()), signature);
+  }
+  return regions;
+}
+
+// checksum of the Chunk timestamp table (second 4k block of the header),
+// changes whenever Minecraft saves one of the Chunks in this Region
+quint32 TileExport::regionSignature(const QString &filename) {
+  QFile f(filename);
+  if (f.size() < 8192)  // skip empty region files
+    return 0;
+  if (!f.open(QIODevice::ReadOnly))
+    return 0;
+  QByteArray timestamps = f.read(8192).mid(4096);
+  f.close();
+
+  quint32 crc = crc32(0, Z_NULL, 0);
+  crc = crc32(crc, reinterpret_cast<const Bytef *>(timestamps.constData()), timestamps.size());
+  return (crc == 0) ? 1 : crc;  // 0 is reserved for "no data"
+}
@@ -0,0 +1,63 @@
+#ifndef TILEEXPORT_H_
+#define TILEEXPORT_H_
+
+#include <QObject>
+#include <QRunnable>
+#include <QHash>
+#include <QImage>
+#include <QPair>
+#include <QSet>
+
+/*
+ Exports the world as a tile pyramid for web map viewers in the usual
+ "slippy map" layout:
+   <output>/<zoom>/<x>/<y>.png
+ Zoom level 0 is a single tile covering the whole world, each level doubles
+ the resolution until maxZoom has one Region per tile at full resolution.
+ Tile indices start at the north west Region of the world (origin) and are
+ never negative, y grows southwards like Minecraft's z. The manifest
+ (tiles.json) holds maxZoom and the origin in Region coordinates, so a viewer
+ can map Block coordinates to tiles:
+   x = (blockX / 512 - originX) / 2^(maxZoom - zoom)
+
+ The manifest also stores the chunk timestamps of each Region used for its
+ tile, later runs only re-render changed Regions and their parent tiles.
+ When the world grows beyond the pyramid or its origin, all tiles are
+ rendered again.
+ */
+class TileExport : public QObject, public QRunnable {
+  Q_OBJECT
+ public:
+  TileExport(QString outputDir, QString worldPath, int depth, int flags);
+  ~TileExport();
+
+  static const int TILE_SIZE = 512;  // one Region at full resolution
+
+ signals:
+  void progress(QString status, double amount);
+  void finished();
+
+ protected:
+  void run();
+
+ private:
+  typedef QPair<int, int> TileID;
+
+  TileID  tileOf(const TileID &region) const;  // tile at maxZoom
+  QImage  renderRegion(const TileID &region) const;
+  QImage  buildParent(int zoom, const TileID &tile) const;
+  QString tileFilename(int zoom, const TileID &tile) const;
+  void    saveTile(int zoom, const TileID &tile, const QImage &image) const;
+
+  static QHash<TileID, quint32> scanRegions(const QString &path);
+  static quint32 regionSignature(const QString &filename);
+
+  QString outputDir;
+  QString worldPath;
+  int depth;
+  int flags;
+  int originX, originZ;  // Region of tile 0,0 at maxZoom
+  int maxZoom;           // full resolution
+};
+
+#endif  // TILEEXPORT_H_
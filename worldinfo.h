@@ -5,7 +5,7 @@
 #include <QString>
 #include <QDir>
 #include <QList>
-#include <QMenu>
+#include <QMultiMap>
 
 #include "identifier/dimensionidentifier.h"
 #include "nbt/nbt.h"
@@ -36,6 +36,7 @@ class WorldInfo : public QObject
   bool parseWorldFolder(const QDir &path);
   bool parseWorldInfo();
 
+  const QDir &        getFolder() const         { return folder; };
   QString             getLevelName() const      { return levelName; };
   unsigned int        getDataVersion() const    { return dataVersion; };
   unsigned long long  getDayTime() const        { return dayTime; };
@@ -48,16 +49,6 @@ class WorldInfo : public QObject
 
   const QList<DimensionInfo> & getDimensions() const { return dimensions; };
 
-  // Dimension view menu
-  void clearDimensionsMenu(QMenu *menu);
-  void getDimensionsInWorld(QDir path, QMenu *menu, QObject *parent);
-
- signals:
-  void dimensionChanged(const DimensionInfo &dim);    // dimension changed in menu
-
- private slots:
-  void changeViewToDimension();                       // dimension changed in menu
-
  private:
   // singleton: prevent access to constructor and copyconstructor
   WorldInfo();
@@ -81,13 +72,6 @@ class WorldInfo : public QObject
 
   QList<DimensionInfo>  dimensions;
   QMultiMap<QString, DatapackInfo> datapacks;
-
-  // Dimension view menu
-  void addDimensionToMenu(QDir path, QString dir, QString name, QObject *parent);
-
-  QList<QAction *> currentMenuActions;
-  QActionGroup *   menuActionGroup;
-  QList<QString>   foundDimensionDirs;  // all directories where we already found a Dimension
 };
 
 #endif // WORLDINFO_H
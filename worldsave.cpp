@@ -3,58 +3,90 @@
 /*
  Saves the world to PNG.  It doesn't use stock PNG code because
  the resulting image might be too large to fit into RAM.  Therefore,
- it uses a custom PNG generator that will handle *huge* worlds, but
+ it uses custom image encoders that will handle *huge* worlds, but
  make less-than-optimal PNGs.
+
+ Rows of Chunks are loaded, rendered and compressed in parallel.
+ Several images (layers) can be created from one pass, each Chunk is
+ then loaded once and rendered once per layer.
+ Each band of rows is encoded independently by an ImageEncoder (PNG,
+ QOI or raw data, chosen by the filename) and written out in order.
+
+ With a scale factor above 1 every rendered Chunk is box filtered
+ directly into the smaller scanlines of its band, a full resolution
+ image never exists.  For scales above 16 several Chunk rows are
+ combined into one band that results in a single scanline.
+
+ Large exports can be split into shards, each rendering an equal slice
+ of the bands.  A shard writes the encoded bands of each layer into a
+ segment file ("world.png.3-of-8.part") and describes them in a JSON
+ file next to it, the JSON is only written when the shard is complete.
+ PNG bands are byte aligned deflate pieces (sync flushed) with their
+ own adler32, mergeShards() wraps them in IDAT chunks, combines the
+ checksums and thereby creates the same image without recompression.
+ Failed shards are simply run again.
  */
 
 #include <zlib.h>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
 #include "worldsave.h"
-#include "mapview.h"
+#include "imageencoder.h"
 #include "chunkloader.h"
 #include "chunkrenderer.h"
 
-WorldSave::WorldSave(QString filename, MapView *map,
+WorldSave::WorldSave(QString filename, QString path, int depth, int flags,
+                     bool regionChecker, bool chunkChecker,
+                     int top, int left, int bottom, int right,
+                     int scale, const ImageEncoder::Options &encoding) :
+  WorldSave(QList<Layer>() << Layer(filename, depth, flags), path,
+            regionChecker, chunkChecker, top, left, bottom, right, scale, encoding) {
+}
+
+WorldSave::WorldSave(const QList<Layer> &layers, QString path,
                      bool regionChecker, bool chunkChecker,
-                     int top, int left, int bottom, int right) :
-  filename(filename),
-  map(map),
+                     int top, int left, int bottom, int right,
+                     int scale, const ImageEncoder::Options &encoding) :
+  layers(layers),
+  path(path),
   top(top),
   left(left),
   bottom(bottom),
   right(right),
   regionChecker(regionChecker),
-  chunkChecker(chunkChecker) {
+  chunkChecker(chunkChecker),
+  scale(1),
+  encoding(encoding),
+  shardIndex(0),
+  shardCount(1) {
+  // round down to a power of two inside the supported range
+  while ((this->scale * 2 <= scale) && (this->scale * 2 <= MAX_SCALE))
+    this->scale *= 2;
+  chunksPerBand = std::max(1, this->scale / 16);
+  linesPerBand  = std::max(1, 16 / this->scale);
 }
 
 WorldSave::~WorldSave() {
 }
 
-static inline void write32(char *p, quint32 v) {
-  *p++ = v >> 24;
-  *p++ = (v >> 16) & 0xff;
-  *p++ = (v >> 8) & 0xff;
-  *p++ = v & 0xff;
+void WorldSave::setShard(int index, int count) {
+  shardCount = std::max(1, count);
+  shardIndex = qBound(0, index, shardCount - 1);
 }
 
-static void writeChunk(QFile *f, const char *tag, const char *data,
-                       int len) {
-  char dword[4];
-  write32(dword, len);
-  f->write(dword, 4);
-  f->write(tag, 4);
-  if (len != 0)
-    f->write(data, len);
-  quint32 crc = crc32(0, Z_NULL, 0);
-  crc = crc32(crc, (const Bytef *)tag, 4);
-  if (len != 0)
-    crc = crc32(crc, (const Bytef *)data, len);
-  write32(dword, crc);
-  f->write(dword, 4);
+QString WorldSave::shardFilename(QString filename, int index, int count) {
+  return QString("%1.%2-of-%3.part").arg(filename).arg(index + 1).arg(count);
 }
 
 void WorldSave::run() {
   emit progress(tr("Calculating world bounds"), 0.0);
-  QString path = map->getWorldPath();
 
   // convert from Blocks to Chunks
   top    = top    >> 4;
@@ -65,77 +97,242 @@ void WorldSave::run() {
   if ( top==0 && left==0 && right==0 && bottom==0)
     findWorldBounds(path, &top, &left, &bottom, &right);
 
-  int width  = (right + 1 - left) * 16;
-  int height = (bottom + 1 - top) * 16;
-
-  QFile png(filename);
-  png.open(QIODevice::WriteOnly);
-
-  // output PNG signature
-  const char *sig = "\x89PNG\x0d\x0a\x1a\x0a";
-  png.write(sig, 8);
-  // output PNG header
-  const char *ihdrdata =  "\x00\x00\x00\x00"  // width
-                          "\x00\x00\x00\x00"  // height
-                          "\x08"              // bit depth
-                          "\x06"              // color type (rgba)
-                          "\x00"              // compresion method (deflate)
-                          "\x00"              // filter method (standard)
-                          "\x00";             // interlace method (none)
-  char ihdr[13];
-  memcpy(ihdr, ihdrdata, 13);
-  write32(ihdr, width);
-  write32(ihdr + 4, height);
-  writeChunk(&png, "IHDR", ihdr, 13);
-
-  int insize = width * 16 * 4 + 16;
-  int outsize = insize * 2;
-
-  uchar *scanlines = new uchar[insize];
-  for (int i = 0; i < 16; i++)  // set scanline filters to off
-    scanlines[i * (width * 4 + 1)] = 0;
-
-  uchar *compressed = new uchar[outsize];
-  z_stream strm;
-  strm.zalloc = Z_NULL;
-  strm.zfree = Z_NULL;
-  strm.opaque = Z_NULL;
-  deflateInit2(&strm, 6, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
-
-  double maximum = (bottom + 1 - top) * (right + 1 - left);
-  double step = 0.0;
-  for (int cz = top; cz <= bottom; cz++) {
-    for (int cx = left; cx <= right; cx++, step += 1.0) {
-      emit progress(tr("Rendering world"), step / maximum);
-
-      // create a temporary Chunk for PNG processing
-      QSharedPointer<Chunk> chunk(new Chunk());
+  // partial pixels at the right and bottom edge are kept
+  const int width  = ((right + 1 - left) * 16 + scale - 1) / scale;
+  const int height = ((bottom + 1 - top) * 16 + scale - 1) / scale;
+  const int bands  = (bottom + 1 - top + chunksPerBand - 1) / chunksPerBand;
+
+  // the slice of bands rendered by this run
+  const bool sharded  = (shardCount > 1);
+  const int firstBand = qint64(bands) * shardIndex / shardCount;
+  const int lastBand  = qint64(bands) * (shardIndex + 1) / shardCount;
+
+  // one image (or segment) file per layer, format chosen by filename
+  QVector<QSharedPointer<QFile>> files;
+  encoders.clear();
+  for (const Layer &layer : layers) {
+    QString filename = sharded ? shardFilename(layer.filename, shardIndex, shardCount)
+                               : layer.filename;
+    if (sharded)
+      QFile::remove(filename + ".json");  // invalid until this run is complete
+    QSharedPointer<QFile> file(new QFile(filename));
+    file->open(QIODevice::WriteOnly);
+    QSharedPointer<ImageEncoder> encoder(ImageEncoder::create(layer.filename, encoding));
+    if (!sharded)
+      encoder->begin(file.data(), width, height);
+    files.append(file);
+    encoders.append(encoder);
+  }
+  // size and checksums of each band in the segments
+  QVector<QJsonArray> segments(layers.size());
+  QVector<quint32>    segmentCrc(layers.size(), crc32(0, Z_NULL, 0));
+
+  // rows are processed by a private pool, we wait for them in order
+  // at most 2 rows per thread are in flight to limit memory usage
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount());
+  const int window = 2 * pool.maxThreadCount();
+  QQueue<QFuture<QVector<EncodedBand>>> pending;
+  int nextRow = firstBand;
+
+  double maximum = lastBand - firstBand;
+  for (int band = firstBand; band < lastBand; band++) {
+    while ((nextRow < lastBand) && (pending.size() < window)) {
+      const int row = nextRow++;
+      pending.enqueue(QtConcurrent::run(&pool, [this, row]() { return renderRow(row); }));
+    }
 
-      if (ChunkLoader::loadNbt(path, cx, cz, chunk)) {
-        drawChunk(scanlines, width * 4 + 1, cx - left, chunk);
+    // write out scanlines to disk
+    QVector<EncodedBand> encoded = pending.dequeue().result();
+    for (int l = 0; l < encoded.size(); l++) {
+      if (sharded) {
+        encoders[l]->writeSegment(files[l].data(), encoded[l]);
+        segmentCrc[l] = crc32(segmentCrc[l],
+                              reinterpret_cast<const Bytef *>(encoded[l].data.constData()),
+                              encoded[l].data.size());
+        segments[l].append(QJsonArray{ encoded[l].data.size(),
+                                       static_cast<double>(encoded[l].checksum),
+                                       static_cast<double>(encoded[l].length) });
       } else {
-        blankChunk(scanlines, width * 4 + 1, cx - left);
+        encoders[l]->writeBand(files[l].data(), encoded[l]);
       }
     }
-    // write out scanlines to disk
-    strm.avail_in = insize;
-    strm.next_in = scanlines;
-    do {
-      strm.avail_out = outsize;
-      strm.next_out = compressed;
-      deflate(&strm, (cz == bottom) ? Z_FINISH : Z_NO_FLUSH);
-      writeChunk(&png, "IDAT", (const char *)compressed, (outsize - strm.avail_out));
-    } while (strm.avail_out == 0);
+
+    emit progress(tr("Rendering world"), (band - firstBand + 1) / maximum);
   }
-  deflateEnd(&strm);
-  delete [] scanlines;
-  delete [] compressed;
 
-  writeChunk(&png, "IEND", NULL, 0);
-  png.close();
+  QStringList statistics;
+  for (int l = 0; l < files.size(); l++) {
+    if (!sharded)
+      encoders[l]->end(files[l].data());
+    files[l]->close();
+    if (sharded)
+      writeShardInfo(layers[l], *encoders[l], width, height, bands, firstBand, lastBand,
+                     segments[l], segmentCrc[l]);
+    statistics << encoders[l]->statistics();
+    qInfo().noquote() << files[l]->fileName() << statistics.last();
+  }
+  encoders.clear();
+  emit progress(statistics.join("\n"), 1.0);
   emit finished();
 }
 
+// metadata of a segment, everything needed to validate and merge it
+void WorldSave::writeShardInfo(const Layer &layer, const ImageEncoder &encoder,
+                               int width, int height, int bands, int firstBand, int lastBand,
+                               const QJsonArray &segments, quint32 crc) const {
+  QJsonObject info;
+  info["version"]   = 1;
+  info["encoder"]   = encoder.name();
+  info["shard"]     = shardIndex + 1;
+  info["shards"]    = shardCount;
+  info["width"]     = width;
+  info["height"]    = height;
+  info["top"]       = top;
+  info["left"]      = left;
+  info["bottom"]    = bottom;
+  info["right"]     = right;
+  info["scale"]     = scale;
+  info["depth"]     = layer.depth;
+  info["flags"]     = layer.flags;
+  info["level"]     = encoding.level;
+  info["filter"]    = static_cast<int>(encoding.filter);
+  info["bands"]     = bands;
+  info["firstBand"] = firstBand;
+  info["lastBand"]  = lastBand;
+  info["crc"]       = static_cast<double>(crc);
+  info["segments"]  = segments;  // [size, checksum, length] per band
+
+  QFile file(shardFilename(layer.filename, shardIndex, shardCount) + ".json");
+  if (file.open(QIODevice::WriteOnly))
+    file.write(QJsonDocument(info).toJson(QJsonDocument::Compact));
+}
+
+bool WorldSave::mergeShards(QString filename, int count, QString *error) {
+  auto fail = [error](const QString &message) {
+    qWarning().noquote() << message;
+    if (error)
+      *error = message;
+    return false;
+  };
+
+  // validate all shards first, nothing is written for an incomplete set
+  static const char *common[] = { "version", "encoder", "shards", "width", "height",
+                                  "top", "left", "bottom", "right", "scale",
+                                  "level", "filter", "bands" };
+  QList<QJsonObject> infos;
+  int nextBand = 0;
+  for (int i = 0; i < count; i++) {
+    const QString segment = shardFilename(filename, i, count);
+    QFile json(segment + ".json");
+    if (!json.open(QIODevice::ReadOnly))
+      return fail(tr("Shard %1 of %2 is missing or incomplete").arg(i + 1).arg(count));
+    const QJsonObject info = QJsonDocument::fromJson(json.readAll()).object();
+    if ((info["version"].toInt() != 1) || (info["shards"].toInt() != count))
+      return fail(tr("Shard %1 of %2 has unknown format").arg(i + 1).arg(count));
+    const QJsonObject &reference = infos.isEmpty() ? info : infos.first();
+    for (const char *key : common) {
+      if (info.value(key) != reference.value(key))
+        return fail(tr("Shard %1 does not belong to the same export (%2 differs)")
+                    .arg(i + 1).arg(key));
+    }
+    if (info["firstBand"].toInt() != nextBand)
+      return fail(tr("Shard %1 does not continue shard %2").arg(i + 1).arg(i));
+    nextBand = info["lastBand"].toInt();
+
+    // size and crc of the segment data
+    qint64 size = 0;
+    for (const QJsonValue &band : info["segments"].toArray())
+      size += band.toArray().at(0).toInt();
+    QFile data(segment);
+    if (!data.open(QIODevice::ReadOnly) || (data.size() != size))
+      return fail(tr("Shard %1 has wrong size, run it again").arg(i + 1));
+    quint32 crc = crc32(0, Z_NULL, 0);
+    while (!data.atEnd()) {
+      const QByteArray block = data.read(1 << 20);
+      crc = crc32(crc, reinterpret_cast<const Bytef *>(block.constData()), block.size());
+    }
+    if (crc != static_cast<quint32>(info["crc"].toDouble()))
+      return fail(tr("Shard %1 is corrupt, run it again").arg(i + 1));
+
+    infos.append(info);
+  }
+  if (infos.isEmpty() || (nextBand != infos.first()["bands"].toInt()))
+    return fail(tr("Shards do not cover the complete image"));
+
+  // wrap the encoded bands into the image container
+  const QJsonObject &first = infos.first();
+  ImageEncoder::Options options(first["level"].toInt(),
+                                static_cast<ImageEncoder::FilterMode>(first["filter"].toInt()));
+  QScopedPointer<ImageEncoder> encoder(ImageEncoder::create(filename, options));
+  QFile image(filename);
+  if (!image.open(QIODevice::WriteOnly))
+    return fail(tr("Cannot write %1").arg(filename));
+  encoder->begin(&image, first["width"].toInt(), first["height"].toInt());
+  for (int i = 0; i < infos.size(); i++) {
+    QFile data(shardFilename(filename, i, count));
+    data.open(QIODevice::ReadOnly);
+    for (const QJsonValue &value : infos[i]["segments"].toArray()) {
+      const QJsonArray entry = value.toArray();
+      EncodedBand band;
+      band.data     = data.read(entry.at(0).toInt());
+      band.checksum = static_cast<quint32>(entry.at(1).toDouble());
+      band.length   = static_cast<qint64>(entry.at(2).toDouble());
+      encoder->writeBand(&image, band);
+    }
+  }
+  encoder->end(&image);
+  image.close();
+  return true;
+}
+
+// load one band of Chunk rows, render it into scanlines per layer and encode them
+QVector<EncodedBand> WorldSave::renderRow(int band) const {
+  const int width  = ((right + 1 - left) * 16 + scale - 1) / scale;
+  const int stride = width * 4;
+  const int first  = top + band * chunksPerBand;
+  const int last   = std::min(bottom, first + chunksPerBand - 1);
+
+  // initialized to transparent
+  QVector<QByteArray> scanlines(layers.size(), QByteArray(stride * linesPerBand, 0));
+  // accumulated color sums when downscaling
+  QVector<QVector<quint32>> sums;
+  if (scale > 1)
+    sums.fill(QVector<quint32>(width * linesPerBand * 4, 0), layers.size());
+
+  // Chunk data needed by any of the layers
+  int channels = 0;
+  for (const Layer &layer : layers)
+    channels |= ChunkRenderer::decodeChannels(layer.flags);
+
+  for (int cz = first; cz <= last; cz++) {
+    for (int cx = left; cx <= right; cx++) {
+      // create a temporary Chunk for PNG processing
+      QSharedPointer<Chunk> chunk(new Chunk());
+
+      if (ChunkLoader::loadNbt(path, cx, cz, chunk, false, channels)) {
+        for (int l = 0; l < layers.size(); l++) {
+          if (scale > 1) {
+            sampleChunk(sums[l].data(), width, cx - left, cz - first, chunk, layers[l]);
+          } else {
+            uchar *data = reinterpret_cast<uchar *>(scanlines[l].data());
+            drawChunk(data, stride, cx - left, chunk, layers[l]);
+          }
+        }
+      }
+    }
+  }
+
+  QVector<EncodedBand> encoded;
+  for (int l = 0; l < scanlines.size(); l++) {
+    uchar *data = reinterpret_cast<uchar *>(scanlines[l].data());
+    if (scale > 1)
+      resolveSums(sums[l].constData(), data, width, linesPerBand);
+    encoded.append(encoders[l]->timedEncodeBand(data, width, linesPerBand,
+                                                (last == bottom)));
+  }
+  return encoded;
+}
 
 typedef struct {
   int x, z;
@@ -256,27 +453,25 @@ void WorldSave::findWorldBounds(QString path,
   *right  = (edges[3].front().x * 32) + maxx;
 }
 
-// sets chunk to transparent
-void WorldSave::blankChunk(uchar *scanlines, int stride, int x) {
-  int offset = x * 16 * 4 + 1;
-  for (int y = 0; y < 16; y++, offset += stride)
-    memset(scanlines + offset, 0, 16 * 4);
-}
-
-void WorldSave::drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk) {
-  // calculate attenuation
+float WorldSave::chunkAttenuation(QSharedPointer<Chunk> chunk) const {
   float attenuation = 1.0f;
   if (this->regionChecker && static_cast<int>(floor(chunk->getChunkX() / 32.0f) +
                                               floor(chunk->getChunkZ() / 32.0f)) % 2 != 0)
     attenuation *= 0.9f;
   if (this->chunkChecker && ((chunk->getChunkX() + chunk->getChunkZ()) % 2) != 0)
     attenuation *= 0.9f;
+  return attenuation;
+}
+
+void WorldSave::drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk,
+                          const Layer &layer) const {
+  float attenuation = chunkAttenuation(chunk);
 
   // render chunk with current settings
-  ChunkRenderer renderer(chunk->getChunkX(), chunk->getChunkZ(), map->getDepth(), map->getFlags());
+  ChunkRenderer renderer(chunk->getChunkX(), chunk->getChunkZ(), layer.depth, layer.flags);
   renderer.renderChunk(chunk);
   // we can't memcpy each scanline because it's in BGRA format.
-  int offset = x * 16 * 4 + 1;
+  int offset = x * 16 * 4;
   int ioffset = 0;
   for (int y = 0; y < 16; y++, offset += stride) {
     int xofs = offset;
@@ -288,3 +483,47 @@ void WorldSave::drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Ch
     }
   }
 }
+
+// render Chunk and add its pixels to the sums of the covered output pixels
+// x: Chunk column inside the image, z: Chunk row inside the band
+void WorldSave::sampleChunk(quint32 *sums, int width, int x, int z, QSharedPointer<Chunk> chunk,
+                            const Layer &layer) const {
+  float attenuation = chunkAttenuation(chunk);
+
+  ChunkRenderer renderer(chunk->getChunkX(), chunk->getChunkZ(), layer.depth, layer.flags);
+  renderer.renderChunk(chunk);
+  const uchar *image = chunk->getImage();
+  for (int y = 0; y < 16; y++) {
+    const int line = (z * 16 + y) / scale;
+    quint32 *row = sums + line * width * 4;
+    for (int bx = 0; bx < 16; bx++, image += 4) {
+      // source is BGRA, colors are weighted by alpha
+      const quint32 a = attenuation * image[3];
+      if (a == 0)
+        continue;
+      quint32 *pixel = row + ((x * 16 + bx) / scale) * 4;
+      pixel[0] += a * static_cast<quint32>(attenuation * image[2]);
+      pixel[1] += a * static_cast<quint32>(attenuation * image[1]);
+      pixel[2] += a * static_cast<quint32>(attenuation * image[0]);
+      pixel[3] += a;
+    }
+  }
+}
+
+// convert accumulated sums into RGBA scanlines (box filter)
+// missing Chunks and partial pixels at the edges count as transparent
+void WorldSave::resolveSums(const quint32 *sums, uchar *scanlines, int width, int lines) const {
+  const quint32 samples = scale * scale;
+  for (int line = 0; line < lines; line++) {
+    uchar *out = scanlines + line * width * 4;
+    for (int px = 0; px < width; px++, sums += 4, out += 4) {
+      const quint32 a = sums[3];
+      if (a == 0)
+        continue;
+      out[0] = sums[0] / a;
+      out[1] = sums[1] / a;
+      out[2] = sums[2] / a;
+      out[3] = (a + samples / 2) / samples;
+    }
+  }
+}
@@ -4,18 +4,51 @@
 
 #include <QObject>
 #include <QRunnable>
+#include <QList>
+#include <QVector>
+#include <QSharedPointer>
+
+#include "imageencoder.h"
 
-class MapView;
 class Chunk;
+class QJsonArray;
 
 class WorldSave : public QObject, public QRunnable {
   Q_OBJECT
  public:
-  WorldSave(QString filename, MapView *map,
+  static const int MAX_SCALE = 64;
+
+  // one output image: rendered with its own depth and view flags
+  struct Layer {
+    Layer(QString filename = QString(), int depth = 0, int flags = 0)
+      : filename(filename), depth(depth), flags(flags) {}
+    QString filename;
+    int depth;
+    int flags;
+  };
+
+  // single image of the world (dimension) at path
+  WorldSave(QString filename, QString path, int depth, int flags,
             bool regionChecker = false, bool chunkChecker = false,
-            int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0);
+            int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0,
+            int scale = 1,
+            const ImageEncoder::Options &encoding = ImageEncoder::Options());
+  // several images from one pass over the world
+  WorldSave(const QList<Layer> &layers, QString path,
+            bool regionChecker = false, bool chunkChecker = false,
+            int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0,
+            int scale = 1,
+            const ImageEncoder::Options &encoding = ImageEncoder::Options());
   ~WorldSave();
 
+  // render only part index of count equal slices of band rows, into a segment
+  // file plus metadata per layer (see mergeShards)
+  void setShard(int index, int count);
+
+  // stitch all segments of one layer into the final image, without recompression
+  static bool mergeShards(QString filename, int count, QString *error = NULL);
+  static QString shardFilename(QString filename, int index, int count);
+
  signals:
   void progress(QString status, double amount);
   void finished();
@@ -24,17 +57,32 @@ class WorldSave : public QObject, public QRunnable {
   void run();
 
  private:
-  void blankChunk(uchar *scanlines, int stride, int x);
-  void drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk);
+  QVector<EncodedBand> renderRow(int band) const;
+  void drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk,
+                 const Layer &layer) const;
+  void sampleChunk(quint32 *sums, int width, int x, int z, QSharedPointer<Chunk> chunk,
+                   const Layer &layer) const;
+  void resolveSums(const quint32 *sums, uchar *scanlines, int width, int lines) const;
+  float chunkAttenuation(QSharedPointer<Chunk> chunk) const;
+  void writeShardInfo(const Layer &layer, const ImageEncoder &encoder,
+                      int width, int height, int bands, int firstBand, int lastBand,
+                      const QJsonArray &segments, quint32 crc) const;
 
-  QString filename;
-  MapView *map;
+  QList<Layer> layers;
+  QString path;
   int top;
   int left;
   int bottom;
   int right;
   bool regionChecker;
   bool chunkChecker;
+  int scale;          // Blocks per pixel edge, power of two
+  int chunksPerBand;  // Chunk rows combined into one output band
+  int linesPerBand;   // scanlines produced by one output band
+  ImageEncoder::Options encoding;
+  QVector<QSharedPointer<ImageEncoder>> encoders;  // one per layer, while running
+  int shardIndex;
+  int shardCount;     // 1 = complete image in one run
 
  public: // static
   static void findWorldBounds(QString path, int *top, int *left, int *bottom, int *right);